@@ -0,0 +1,251 @@
+//BoidsAlloc.hpp
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+/**
+ * Allocazione dei buffer di stato e della griglia. I buffer piccoli sono
+ * allineati a STATE_ALIGNMENT; quelli da HUGE_PAGE_SIZE in su (su Linux)
+ * sono mappature anonime allineate a 2 MB, con pagine scelte da PagePolicy:
+ * - hugetlb: MAP_HUGETLB dal pool di pagine riservate (vm.nr_hugepages);
+ *   se il pool non basta si ripiega su thp e si conta il fallback;
+ * - thp: pagine normali con madvise(MADV_HUGEPAGE), le transparent huge
+ *   page del kernel (in modalità "madvise" o "always");
+ * - smallpages: MADV_NOHUGEPAGE, pagine da 4 KB (per confronto).
+ * La memoria arriva sempre azzerata e non viene toccata all'allocazione:
+ * le pagine si materializzano sul nodo NUMA del thread che le scrive per
+ * primo, o su quello scelto da bindToOwnerNodes (BoidsNuma.hpp, con il
+ * report delle pagine).
+ */
+
+// Allineamento dei buffer piccoli: una linea di cache, cioè un vettore AVX-512
+constexpr std::size_t STATE_ALIGNMENT = 64;
+
+// Pagina grande (x86-64); da questa dimensione in su i buffer sono mappature
+constexpr std::size_t HUGE_PAGE_SIZE = std::size_t{2} << 20;
+
+enum class PagePolicy { HugeTlb, Transparent, Small };
+
+// Politica dei buffer grandi allocati da qui in poi; main la sceglie prima
+// di creare gli stati (vedi parsePagePolicy)
+inline PagePolicy& activePagePolicy() {
+    static PagePolicy policy = PagePolicy::HugeTlb;
+    return policy;
+}
+
+// "hugetlb", "thp" o "smallpages" da riga di comando; false per una parola diversa
+inline bool parsePagePolicy(const char* name, PagePolicy& policy) {
+    if (std::strcmp(name, "hugetlb") == 0) policy = PagePolicy::HugeTlb;
+    else if (std::strcmp(name, "thp") == 0) policy = PagePolicy::Transparent;
+    else if (std::strcmp(name, "smallpages") == 0) policy = PagePolicy::Small;
+    else return false;
+    return true;
+}
+
+inline const char* pagePolicyName(const PagePolicy policy) {
+    switch (policy) {
+        case PagePolicy::HugeTlb:     return "hugetlb";
+        case PagePolicy::Transparent: return "thp";
+        default:                      return "smallpages";
+    }
+}
+
+// Buffer grande vivo: serve a liberarlo e al report sui nodi
+struct StateMapping {
+    void* data;
+    std::size_t bytes;
+    PagePolicy pages; // quella ottenuta, non quella richiesta
+};
+
+// Statistiche dei buffer vivi, per printPageReport (BoidsNuma.hpp)
+struct PageStats {
+    std::atomic<std::size_t> hugeTlbBytes{0};
+    std::atomic<std::size_t> transparentBytes{0};
+    std::atomic<std::size_t> smallBytes{0};
+    std::atomic<int> hugeTlbFallbacks{0};
+    std::atomic<int> bindFailures{0};
+
+    std::mutex mutex;
+    std::vector<StateMapping> mappings;
+
+    std::atomic<std::size_t>& bytesFor(const PagePolicy pages) {
+        switch (pages) {
+            case PagePolicy::HugeTlb:     return hugeTlbBytes;
+            case PagePolicy::Transparent: return transparentBytes;
+            default:                      return smallBytes;
+        }
+    }
+};
+
+inline PageStats& pageStats() {
+    static PageStats stats;
+    return stats;
+}
+
+#if defined(__linux__)
+// Mappatura anonima di bytes (multiplo di HUGE_PAGE_SIZE) allineata a
+// HUGE_PAGE_SIZE: si mappa una pagina grande in più e si tagliano i bordi
+inline void* mapHugeAligned(const std::size_t bytes) {
+    const std::size_t mappedBytes = bytes + HUGE_PAGE_SIZE;
+    void* mapped = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED) throw std::bad_alloc();
+
+    const auto base = reinterpret_cast<std::uintptr_t>(mapped);
+    const std::uintptr_t aligned = (base + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    if (aligned > base) munmap(mapped, aligned - base);
+    if (const std::uintptr_t tail = base + mappedBytes - (aligned + bytes); tail > 0) {
+        munmap(reinterpret_cast<void*>(aligned + bytes), tail);
+    }
+    return reinterpret_cast<void*>(aligned);
+}
+#endif
+
+// bytes arrotondato per eccesso: al multiplo di HUGE_PAGE_SIZE per i buffer grandi
+inline std::size_t stateBufferBytes(const std::size_t bytes) {
+    const std::size_t alignment = bytes >= HUGE_PAGE_SIZE ? HUGE_PAGE_SIZE : STATE_ALIGNMENT;
+    return (bytes + alignment - 1) / alignment * alignment;
+}
+
+// Buffer azzerato di stateBufferBytes(bytes) byte
+inline void* allocateStateBuffer(std::size_t bytes) {
+    bytes = stateBufferBytes(bytes);
+    PageStats& stats = pageStats();
+
+#if defined(__linux__)
+    if (bytes >= HUGE_PAGE_SIZE) {
+        PagePolicy pages = activePagePolicy();
+        void* memory = nullptr;
+
+        if (pages == PagePolicy::HugeTlb) {
+            memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (memory == MAP_FAILED) {
+                memory = nullptr;
+                pages = PagePolicy::Transparent;
+                stats.hugeTlbFallbacks++;
+            }
+        }
+        if (memory == nullptr) {
+            memory = mapHugeAligned(bytes);
+            // Solo consigli: se il kernel non li accetta restano le pagine di default
+            madvise(memory, bytes, pages == PagePolicy::Transparent ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+        }
+
+        stats.bytesFor(pages) += bytes;
+        const std::lock_guard lock(stats.mutex);
+        stats.mappings.push_back({memory, bytes, pages});
+        return memory;
+    }
+#endif
+
+    void* memory = ::operator new(bytes, std::align_val_t{STATE_ALIGNMENT});
+    std::memset(memory, 0, bytes);
+    stats.smallBytes += bytes;
+    return memory;
+}
+
+inline void freeStateBuffer(void* memory, std::size_t bytes) noexcept {
+    bytes = stateBufferBytes(bytes);
+    PageStats& stats = pageStats();
+
+#if defined(__linux__)
+    if (bytes >= HUGE_PAGE_SIZE) {
+        const std::lock_guard lock(stats.mutex);
+        const auto mapping = std::find_if(stats.mappings.begin(), stats.mappings.end(),
+            [memory](const StateMapping& m) { return m.data == memory; });
+        // Una mappatura non registrata (non dovrebbe accadere) si libera
+        // comunque, senza toccare le statistiche
+        if (mapping != stats.mappings.end()) {
+            stats.bytesFor(mapping->pages) -= bytes;
+            stats.mappings.erase(mapping);
+        }
+        munmap(memory, bytes);
+        return;
+    }
+#endif
+
+    stats.smallBytes -= bytes;
+    ::operator delete(memory, bytes, std::align_val_t{STATE_ALIGNMENT});
+}
+
+// Vero solo dentro resizeUninitialized, sul thread che la chiama
+inline bool& skipDefaultConstruct() {
+    thread_local bool skip = false;
+    return skip;
+}
+
+/**
+ * Allocatore per std::vector sopra allocateStateBuffer, con la semantica di
+ * std::allocator: resize() e il costruttore con dimensione inizializzano gli
+ * elementi. Solo resizeUninitialized salta l'inizializzazione dei tipi
+ * banalmente copiabili.
+ */
+template<typename T>
+struct AlignedAllocator {
+    using value_type = T;
+
+    AlignedAllocator() noexcept = default;
+    template<typename U>
+    explicit AlignedAllocator(const AlignedAllocator<U>&) noexcept {}
+
+    template<typename U>
+    struct rebind { using other = AlignedAllocator<U>; };
+
+    T* allocate(const std::size_t n) { return static_cast<T*>(allocateStateBuffer(n * sizeof(T))); }
+    void deallocate(T* memory, const std::size_t n) noexcept { freeStateBuffer(memory, n * sizeof(T)); }
+
+    template<typename U>
+    void construct(U* p) noexcept(std::is_nothrow_default_constructible_v<U>) {
+        if constexpr (std::is_trivially_copyable_v<U>) {
+            if (skipDefaultConstruct()) return;
+        }
+        ::new (static_cast<void*>(p)) U();
+    }
+
+    template<typename U, typename... Args>
+    void construct(U* p, Args&&... args) { ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...); }
+
+    template<typename U>
+    bool operator==(const AlignedAllocator<U>&) const noexcept { return true; }
+    template<typename U>
+    bool operator!=(const AlignedAllocator<U>&) const noexcept { return false; }
+};
+
+// Array di indici per boid della griglia (cellIndices, boidCell, boidSlot)
+using IndexArray = std::vector<int, AlignedAllocator<int>>;
+
+
+/**
+ * resize() di un array di stato che non scrive i nuovi elementi: le pagine
+ * restano al first-touch dei cicli paralleli che li inizializzano (o a
+ * bindToOwnerNodes). I nuovi elementi valgono zero se il buffer è appena
+ * allocato (allocateStateBuffer lo azzera), altrimenti quello che restava
+ * nella capacità già usata: va seguito da una scrittura di tutto l'array.
+ */
+template<typename T>
+inline void resizeUninitialized(std::vector<T, AlignedAllocator<T>>& array, const std::size_t n) {
+    static_assert(std::is_trivially_copyable_v<T>, "solo per tipi banalmente copiabili");
+    struct SkipScope {
+        SkipScope() { skipDefaultConstruct() = true; }
+        ~SkipScope() { skipDefaultConstruct() = false; }
+    } scope;
+    array.resize(n);
+}
+
+// Array di n elementi non inizializzati (vedi resizeUninitialized)
+template<typename Array>
+inline Array uninitializedArray(const std::size_t n) {
+    Array array;
+    resizeUninitialized(array, n);
+    return array;
+}
@@ -0,0 +1,208 @@
+//BoidsAoSoA.hpp
+#pragma once
+
+#include "BoidsGrid.hpp"
+#include "BoidsCommon.hpp"
+#include "BoidsSimd.hpp"
+#include <algorithm>
+#include <vector>
+
+/**
+ * Layout a blocchi (AoSoA): B boid consecutivi stanno in un blocco allineato
+ * a 64 byte con i quattro campi uno dopo l'altro (posX[B], posY[B], velX[B],
+ * velY[B]). Come in SoA un campo di W boid si legge con un load vettoriale,
+ * ma un boid occupa una sola zona di memoria (4 * B * 4 byte: 2 linee di
+ * cache con B = 8, 4 con B = 16) invece di quattro flussi e quattro gruppi
+ * di pagine TLB.
+ */
+template<int B>
+struct alignas(64) BoidBlock {
+    static_assert(B == 8 || B == 16, "blocchi da 8 o 16 boid");
+    float posX[B];
+    float posY[B];
+    float velX[B];
+    float velY[B];
+};
+
+template<int B>
+struct BoidAoSoA {
+    std::vector<BoidBlock<B>, AlignedAllocator<BoidBlock<B>>> blocks; // l'ultimo blocco è completato da corsie a zero
+    int count = 0;
+
+    // Blocchi non scritti (azzerati da allocateStateBuffer): pagine al first-touch
+    explicit BoidAoSoA(const int n) : count{n} { resizeUninitialized(blocks, (n + B - 1) / B); }
+
+    [[nodiscard]] int size() const { return count; }
+
+    // I cicli paralleli scorrono i blocchi interi (schedule(static) su
+    // numBlocks()), così ogni blocco e le sue linee di cache hanno un solo
+    // thread; il blocco b copre i boid [b * B, blockEnd(b))
+    [[nodiscard]] int numBlocks() const { return static_cast<int>(blocks.size()); }
+    [[nodiscard]] int blockEnd(const int block) const { return std::min(count, (block + 1) * B); }
+
+    [[nodiscard]] Vector2 position(const int i) const {
+        const BoidBlock<B>& block = blocks[i / B];
+        return {block.posX[i % B], block.posY[i % B]};
+    }
+
+    [[nodiscard]] Boid get(const int i) const {
+        const BoidBlock<B>& block = blocks[i / B];
+        const int lane = i % B;
+        return {{block.posX[lane], block.posY[lane]}, {block.velX[lane], block.velY[lane]}};
+    }
+
+    void set(const int i, const Boid& b) {
+        BoidBlock<B>& block = blocks[i / B];
+        const int lane = i % B;
+        block.posX[lane] = b.position.x;
+        block.posY[lane] = b.position.y;
+        block.velX[lane] = b.velocity.x;
+        block.velY[lane] = b.velocity.y;
+    }
+
+    void swap(BoidAoSoA& other) noexcept {
+        blocks.swap(other.blocks);
+        std::swap(count, other.count);
+    }
+};
+
+// Preferenza NUMA dei blocchi, divisi tra i thread come nei cicli per blocchi
+template<int B>
+inline void bindToOwnerNodes(const BoidAoSoA<B>& state) {
+    bindToOwnerNodes(state.blocks);
+}
+
+/**
+ * Sorgenti [begin, end) traslate di (shiftX, shiftY) contro il boid self:
+ * si leggono i blocchi interi con load vettoriali (W corsie alla volta,
+ * B multiplo di W) e la maschera scarta le corsie fuori intervallo e il boid
+ * stesso, senza load parziali anche quando l'intervallo (una cella della
+ * griglia) inizia o finisce a metà blocco.
+ */
+template<int W, int B, bool Fast>
+[[gnu::always_inline]] inline void accumulateRangeAoSoA(FlockSumsSimd<W>& acc,
+                                                       const Vector2& self,
+                                                       const int selfIndex,
+                                                       const BoidAoSoA<B>& state,
+                                                       const int begin,
+                                                       const int end,
+                                                       const float shiftX = 0.0f,
+                                                       const float shiftY = 0.0f)
+{
+    static_assert(B % W == 0, "il blocco deve contenere un numero intero di vettori");
+    using V = Simd<W>;
+    const typename V::Float selfX = V::broadcast(self.x);
+    const typename V::Float selfY = V::broadcast(self.y);
+    const typename V::Mask lanes = V::lanes();
+
+    for (int first = begin - begin % W; first < end; first += W) {
+        const BoidBlock<B>& block = state.blocks[first / B];
+        const int offset = first % B;
+        const typename V::Mask index = lanes + first;
+        // begin <= index < end come segni delle differenze (vedi Simd::less)
+        const typename V::Mask valid = ~((index - begin) >> 31) & ((index - end) >> 31) & (index != selfIndex);
+
+        accumulateNeighborsSimd<W, Fast>(acc, selfX, selfY,
+            V::load(block.posX + offset) + shiftX, V::load(block.posY + offset) + shiftY,
+            V::load(block.velX + offset), V::load(block.velY + offset), valid);
+    }
+}
+
+// Chiude le regole del boid i (come computeNextBoid) e lo scrive in next
+template<int W, bool Fast>
+[[gnu::always_inline]] inline void finishBoidAoSoA(const FlockSumsSimd<W>& acc, const Boid& b, Boid& next) {
+    FlockSums sums;
+    acc.reduceInto(sums);
+    integrateBoid<Fast>(b, flockAcceleration<Fast>(sums, b), next);
+}
+
+// Brute force: il boid i contro tutti i blocchi
+template<int W, int B, bool Fast>
+[[gnu::always_inline]] inline void computeNextBoidAoSoA(const int i,
+                                                       const BoidAoSoA<B>& oldState,
+                                                       BoidAoSoA<B>& newState)
+{
+    const Boid b = oldState.get(i);
+    FlockSumsSimd<W> acc;
+    accumulateRangeAoSoA<W, B, Fast>(acc, b.position, i, oldState, 0, oldState.size());
+
+    Boid next;
+    finishBoidAoSoA<W, Fast>(acc, b, next);
+    newState.set(i, next);
+}
+
+/**
+ * Griglia: lo stato è ordinato per cella (vedi permuteByCellAoSoA), quindi
+ * ogni cella dello stencil è un intervallo contiguo di blocchi.
+ * Restituisce i candidati visitati.
+ */
+template<int W, int B, int Reach, bool Periodic, bool Fast>
+[[gnu::always_inline]] inline int computeNextBoidGridAoSoA(const int k,
+                                                          const BoidAoSoA<B>& sorted,
+                                                          BoidAoSoA<B>& newState,
+                                                          const UniformGrid& grid)
+{
+    const Boid b = sorted.get(k);
+    auto [cellX, cellY] = getCellCoords(b.position, grid);
+
+    FlockSumsSimd<W> acc;
+    int candidates = 0;
+    forEachStencilCell<Reach, Periodic>(b.position, cellX, cellY, grid, [&](const int cell, const Vector2& shift) __attribute__((always_inline)) {
+        accumulateRangeAoSoA<W, B, Fast>(acc, b.position, k, sorted, grid.cellBegin[cell], grid.cellEnd[cell], shift.x, shift.y);
+        candidates += grid.cellEnd[cell] - grid.cellBegin[cell];
+    });
+
+    Boid next;
+    finishBoidAoSoA<W, Fast>(acc, b, next);
+    newState.set(k, next);
+    return candidates;
+}
+
+// Kernel scelti all'avvio in base all'ISA e alla precisione. Con blocchi da
+// 8 su AVX-512 si usa l'istanza AVX2: vettori da 8 nel target avx512 fanno
+// le maschere a registri k e GCC spezza i confronti in corsie scalari
+template<int B>
+using StepKernelAoSoA = void (*)(int, const BoidAoSoA<B>&, BoidAoSoA<B>&);
+
+template<int B>
+using GridKernelAoSoA = int (*)(int, const BoidAoSoA<B>&, BoidAoSoA<B>&, const UniformGrid&);
+
+template<int B, bool Fast>
+inline StepKernelAoSoA<B> selectStepKernelAoSoA(const SimdIsa isa) {
+    switch (isa) {
+        case SimdIsa::Avx512:
+            if constexpr (B == 16) return SimdTargets<computeNextBoidAoSoA<16, B, Fast>>::avx512;
+            [[fallthrough]];
+        case SimdIsa::Avx2:   return SimdTargets<computeNextBoidAoSoA<8, B, Fast>>::avx2;
+        default:              return SimdTargets<computeNextBoidAoSoA<4, B, Fast>>::generic;
+    }
+}
+
+template<int B, int Reach, bool Periodic, bool Fast>
+inline GridKernelAoSoA<B> selectGridKernelAoSoA(const SimdIsa isa) {
+    switch (isa) {
+        case SimdIsa::Avx512:
+            if constexpr (B == 16) return SimdTargets<computeNextBoidGridAoSoA<16, B, Reach, Periodic, Fast>>::avx512;
+            [[fallthrough]];
+        case SimdIsa::Avx2:   return SimdTargets<computeNextBoidGridAoSoA<8, B, Reach, Periodic, Fast>>::avx2;
+        default:              return SimdTargets<computeNextBoidGridAoSoA<4, B, Reach, Periodic, Fast>>::generic;
+    }
+}
+
+/**
+ * Permuta lo stato nell'ordine delle celle: da chiamare da tutti i thread
+ * di una regione parallela già aperta, dopo parallelBuildGridFrom. Ogni
+ * blocco di destinazione è scritto da un solo thread.
+ */
+template<int B>
+inline void permuteByCellAoSoA(const BoidAoSoA<B>& state,
+                               BoidAoSoA<B>& sorted,
+                               const UniformGrid& grid)
+{
+    #pragma omp for schedule(static)
+    for (int block = 0; block < sorted.numBlocks(); ++block) {
+        for (int k = block * B; k < sorted.blockEnd(block); ++k) {
+            sorted.set(k, state.get(grid.cellIndices[k]));
+        }
+    }
+}
@@ -1,8 +1,15 @@
 // BoidsCommon.hpp
 #pragma once
+#include "BoidsAlloc.hpp"
 #include <vector>
+#include <algorithm>
+#include <cassert>
 #include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <random>
+#include <type_traits>
 
 constexpr float WIDTH = 1000.0f;
 constexpr float HEIGHT = 800.0f;
@@ -13,6 +20,16 @@ constexpr float SEPARATION_RADIUS = 20.0f;
 constexpr float SEPARATION_WEIGHT = 2.0f;
 constexpr float ALIGNMENT_WEIGHT  = 1.0f;
 constexpr float COHESION_WEIGHT   = 1.5f;
+constexpr float WRAP_MARGIN = 5.0f; // il mondo si avvolge in [-WRAP_MARGIN, size + WRAP_MARGIN]
+
+// Controlli interni ai kernel (invarianti della griglia, allineamento degli
+// intervalli): nelle build di misura NDEBUG non è definita, quindi assert
+// resterebbe nei cicli caldi. Si attivano compilando con -DBOIDS_DEBUG_CHECKS
+#ifdef BOIDS_DEBUG_CHECKS
+#define BOIDS_DEBUG_ASSERT(condition) assert(condition)
+#else
+#define BOIDS_DEBUG_ASSERT(condition) ((void)0)
+#endif
 
 struct Vector2 {
     float x, y;
@@ -44,4 +61,286 @@ struct Boid {
     Vector2 velocity;
 };
 
+// Stato AoS di tutti i motori, nei buffer di BoidsAlloc.hpp
+using BoidArray = std::vector<Boid, AlignedAllocator<Boid>>;
+
+/**
+ * Precisione delle regole. Exact fa un sqrt per coppia prima dei test e
+ * normalizza con divisioni esatte; Fast (opt-in, "fast" da riga di comando)
+ * scarta le coppie sulla distanza al quadrato, usa fastInvSqrt per quelle
+ * accettate e calcola la separazione come diff / dist^3 senza normalizzare.
+ * L'errore si misura con la deriva delle posizioni (vedi positionDrift).
+ */
+enum class Precision { Exact, Fast };
+
+inline Precision& activePrecision() {
+    static Precision precision = Precision::Exact;
+    return precision;
+}
+
+// "exact" o "fast" da riga di comando; false per una parola diversa
+inline bool parsePrecision(const char* name, Precision& precision) {
+    if (std::strcmp(name, "exact") == 0) precision = Precision::Exact;
+    else if (std::strcmp(name, "fast") == 0) precision = Precision::Fast;
+    else return false;
+    return true;
+}
+
+inline const char* precisionName(const Precision precision) {
+    return precision == Precision::Fast ? "fast" : "exact";
+}
+
+// Chiama body con std::true_type se la precisione attiva è Fast: i kernel
+// vengono specializzati su <Fast> come su Reach/Periodic. Va chiamata una
+// volta per simulazione, fuori dai cicli sui boid
+template<typename Body>
+inline auto dispatchPrecision(Body&& body) {
+    return activePrecision() == Precision::Fast ? body(std::true_type{}) : body(std::false_type{});
+}
+
+/**
+ * 1 / sqrt(x) per x > 0: stima sui bit (errore ~3e-2) e un passo di Newton,
+ * errore relativo <= 1.8e-3.
+ */
+inline float fastInvSqrt(const float x) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(float));
+    bits = 0x5f375a86u - (bits >> 1);
+    float y;
+    std::memcpy(&y, &bits, sizeof(float));
+    return y * (1.5f - 0.5f * x * y * y);
+}
+
+// normalized() e limit() con fastInvSqrt: le varianti Fast delle regole
+inline Vector2 fastNormalized(const Vector2& v) {
+    const float length2 = v.x * v.x + v.y * v.y;
+    return length2 > 0.0f ? v * fastInvSqrt(length2) : v;
+}
+
+inline void fastLimit(Vector2& v, const float max) {
+    if (const float length2 = v.x * v.x + v.y * v.y; length2 > max * max) {
+        v = v * (max * fastInvSqrt(length2));
+    }
+}
+
+// Accumulatori delle tre regole, riempiti in un'unica visita dei vicini
+struct FlockSums {
+    Vector2 separation{0, 0};
+    int separationCount = 0;
+    Vector2 alignment{0, 0};
+    Vector2 cohesion{0, 0};
+    int viewCount = 0; // vicini entro VIEW_RADIUS, comuni ad allineamento e coesione
+};
+
+// Un solo sqrt per coppia: la distanza serve a tutte e tre le regole.
+// Con Fast la coppia si scarta su dist^2 e la radice è fastInvSqrt.
+template<bool Fast = false>
+inline void accumulateNeighbor(FlockSums& sums,
+                               const Vector2& selfPosition,
+                               const Vector2& otherPosition,
+                               const Vector2& otherVelocity)
+{
+    const Vector2 diff = selfPosition - otherPosition;
+
+    if constexpr (Fast) {
+        const float dist2 = diff.x * diff.x + diff.y * diff.y;
+        if (!(dist2 < VIEW_RADIUS * VIEW_RADIUS)) return;
+
+        const float invDist = dist2 > 0.0f ? fastInvSqrt(dist2) : 0.0f;
+        sums.alignment = sums.alignment + otherVelocity * (1.0f - dist2 * invDist * (1.0f / VIEW_RADIUS));
+        sums.cohesion = sums.cohesion + otherPosition;
+        sums.viewCount++;
+
+        if (dist2 < SEPARATION_RADIUS * SEPARATION_RADIUS) {
+            sums.separation = sums.separation + diff * (invDist * invDist * invDist);
+            sums.separationCount++;
+        }
+        return;
+    }
+
+    const float dist = diff.magnitude();
+    if (!(dist < VIEW_RADIUS)) return;
+
+    const float weight = (VIEW_RADIUS - dist) / VIEW_RADIUS;
+    sums.alignment = sums.alignment + otherVelocity * weight;
+    sums.cohesion = sums.cohesion + otherPosition;
+    sums.viewCount++;
+
+    if (dist < SEPARATION_RADIUS) {
+        // diff / dist è diff.normalized() senza ricalcolare la radice
+        const Vector2 direction = dist > 0.0f ? diff / dist : diff;
+        sums.separation = sums.separation + direction / (dist * dist);
+        sums.separationCount++;
+    }
+}
+
+/**
+ * Variante simmetrica di accumulateNeighbor: una sola distanza per la coppia
+ * (a, b) e contributi a entrambi. otherShift porta b nell'immagine vicina ad
+ * a (nullo senza periodicità); la separazione è antisimmetrica, il peso
+ * dell'allineamento è lo stesso per i due boid.
+ */
+template<bool Fast = false>
+inline void accumulatePair(FlockSums& sumsA,
+                           FlockSums& sumsB,
+                           const Boid& a,
+                           const Boid& b,
+                           const Vector2& otherShift)
+{
+    const Vector2 otherPosition = b.position + otherShift;
+    const Vector2 diff = a.position - otherPosition;
+    const float dist2 = diff.x * diff.x + diff.y * diff.y;
+    float dist, invDist = 0.0f;
+    if constexpr (Fast) {
+        if (!(dist2 < VIEW_RADIUS * VIEW_RADIUS)) return;
+        invDist = dist2 > 0.0f ? fastInvSqrt(dist2) : 0.0f;
+        dist = dist2 * invDist;
+    } else {
+        dist = std::sqrt(dist2);
+        if (!(dist < VIEW_RADIUS)) return;
+    }
+
+    const float weight = (VIEW_RADIUS - dist) / VIEW_RADIUS;
+    sumsA.alignment = sumsA.alignment + b.velocity * weight;
+    sumsB.alignment = sumsB.alignment + a.velocity * weight;
+    sumsA.cohesion = sumsA.cohesion + otherPosition;
+    sumsB.cohesion = sumsB.cohesion + (a.position - otherShift);
+    sumsA.viewCount++;
+    sumsB.viewCount++;
+
+    if (Fast ? dist2 < SEPARATION_RADIUS * SEPARATION_RADIUS : dist < SEPARATION_RADIUS) {
+        Vector2 push;
+        if constexpr (Fast) {
+            push = diff * (invDist * invDist * invDist);
+        } else {
+            const Vector2 direction = dist > 0.0f ? diff / dist : diff;
+            push = direction / (dist * dist);
+        }
+        sumsA.separation = sumsA.separation + push;
+        sumsB.separation = sumsB.separation - push;
+        sumsA.separationCount++;
+        sumsB.separationCount++;
+    }
+}
+
+// Somma gli accumulatori parziali (es. quelli privati di un thread)
+inline void mergeFlockSums(FlockSums& into, const FlockSums& from) {
+    into.separation = into.separation + from.separation;
+    into.separationCount += from.separationCount;
+    into.alignment = into.alignment + from.alignment;
+    into.cohesion = into.cohesion + from.cohesion;
+    into.viewCount += from.viewCount;
+}
+
+// Chiude le tre regole (media, velocità desiderata, limite) e le pesa
+template<bool Fast = false>
+inline Vector2 flockAcceleration(const FlockSums& sums, const Boid& b) {
+    const auto normalized = [](const Vector2& v) { return Fast ? fastNormalized(v) : v.normalized(); };
+    const auto limit = [](Vector2& v, const float max) { if (Fast) fastLimit(v, max); else v.limit(max); };
+
+    Vector2 sep{0, 0};
+    Vector2 ali{0, 0};
+    Vector2 coh{0, 0};
+
+    // Media e normalizzazione: la divisione per il conteggio non cambia la
+    // direzione, Fast la salta (separazione e allineamento)
+    if (sums.separationCount > 0) {
+        sep = Fast ? sums.separation : sums.separation / static_cast<float>(sums.separationCount);
+        sep = normalized(sep) * MAX_SPEED;
+        sep = sep - b.velocity;
+        limit(sep, MAX_FORCE);
+    }
+
+    if (sums.viewCount > 0) {
+        const auto count = static_cast<float>(sums.viewCount);
+
+        ali = Fast ? sums.alignment : sums.alignment / count;
+        ali = normalized(ali) * MAX_SPEED;
+        ali = ali - b.velocity;
+        limit(ali, MAX_FORCE);
+
+        const Vector2 center = sums.cohesion / count;
+        coh = normalized(center - b.position) * MAX_SPEED;
+        coh = coh - b.velocity;
+        limit(coh, MAX_FORCE);
+    }
+
+    Vector2 acceleration = sep * SEPARATION_WEIGHT + ali * ALIGNMENT_WEIGHT + coh * COHESION_WEIGHT;
+    limit(acceleration, MAX_FORCE);
+    return acceleration;
+}
+
+// Integrazione e wrap-around, comuni a tutti i motori AoS; width e height
+// cambiano solo nel motore distribuito, che può simulare un mondo più grande
+template<bool Fast = false>
+inline void integrateBoid(const Boid& b, const Vector2& acceleration, Boid& next,
+                          const float width = WIDTH, const float height = HEIGHT) {
+    auto&[position, velocity] = next;
+
+    velocity = b.velocity + acceleration;
+    if constexpr (Fast) fastLimit(velocity, MAX_SPEED);
+    else velocity.limit(MAX_SPEED);
+    position = b.position + velocity;
+
+    constexpr float margin = WRAP_MARGIN;
+    if (position.x < -margin) position.x = width + margin;
+    else if (position.x > width + margin) position.x = -margin;
+    if (position.y < -margin) position.y = height + margin;
+    else if (position.y > height + margin) position.y = -margin;
+}
+
+// "drift [passi]" da riga di comando: a punta a "drift" e avanza sul numero
+// di passi se presente. Di default un solo passo, l'errore di un passo: il
+// flocking amplifica qualsiasi differenza di arrotondamento (anche exact
+// scalar contro exact avx2 diverge di decine di unità in 50-100 passi),
+// quindi su più passi il report va letto accanto alla deriva di riferimento
+// (exact contro exact con le somme in un altro ordine, vedi reorderedSumsIsa)
+constexpr int DEFAULT_DRIFT_STEPS = 1;
+
+inline bool parseDriftArg(const int argc, char* argv[], int& a, int& driftSteps) {
+    if (std::strcmp(argv[a], "drift") != 0) return false;
+    driftSteps = DEFAULT_DRIFT_STEPS;
+    if (a + 1 < argc) {
+        char* end;
+        if (const long val = std::strtol(argv[a + 1], &end, 10); *end == '\0' && val > 0) {
+            driftSteps = static_cast<int>(val);
+            ++a;
+        }
+    }
+    return true;
+}
+
+/**
+ * Deriva delle posizioni rispetto a una simulazione di riferimento (modo
+ * Exact dallo stesso stato iniziale, stessi passi): distanza per boid
+ * nell'immagine minima del mondo avvolto, massima e media.
+ */
+struct PositionDrift {
+    float max = 0.0f;
+    float mean = 0.0f;
+};
+
+inline std::vector<Vector2> boidPositions(const BoidArray& state) {
+    std::vector<Vector2> positions(state.size());
+    for (size_t i = 0; i < state.size(); ++i) positions[i] = state[i].position;
+    return positions;
+}
+
+inline PositionDrift positionDrift(const std::vector<Vector2>& reference, const std::vector<Vector2>& positions) {
+    constexpr float spanX = WIDTH + 2.0f * WRAP_MARGIN;
+    constexpr float spanY = HEIGHT + 2.0f * WRAP_MARGIN;
 
+    PositionDrift drift;
+    double sum = 0.0;
+    for (size_t i = 0; i < reference.size(); ++i) {
+        float dx = std::fabs(positions[i].x - reference[i].x);
+        float dy = std::fabs(positions[i].y - reference[i].y);
+        dx = std::min(dx, spanX - dx);
+        dy = std::min(dy, spanY - dy);
+        const float distance = std::sqrt(dx * dx + dy * dy);
+        drift.max = std::max(drift.max, distance);
+        sum += distance;
+    }
+    drift.mean = reference.empty() ? 0.0f : static_cast<float>(sum / static_cast<double>(reference.size()));
+    return drift;
+}
@@ -0,0 +1,322 @@
+//BoidsCompact.hpp
+#pragma once
+
+#include "BoidsNuma.hpp"
+#include "BoidsGridSOA.hpp"
+#include "BoidsCommon.hpp"
+#include "BoidsSimd.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/**
+ * Stato compatto: 8 byte per boid invece di 16. Le posizioni sono in
+ * virgola fissa a 16 bit senza segno sul toro del mondo
+ * [-WRAP_MARGIN, size + WRAP_MARGIN] (passo ~0.015 in x, ~0.012 in y), le
+ * velocità a 16 bit con segno in [-MAX_SPEED, MAX_SPEED] (passo ~9e-5).
+ * Gli array sono SoA e i kernel decodificano W boid alla volta in float
+ * (allargamento a 32 bit, conversione, scala), quindi le regole sono quelle
+ * di accumulateNeighborsSimd; la memoria letta per passo si dimezza.
+ * Il boid aggiornato viene ricodificato a fine passo: l'arrotondamento
+ * (al più mezzo passo) si accumula e si misura con il report drift.
+ * Finché lo stato SoA sta in cache la decodifica costa più della banda
+ * risparmiata e il motore compatto resta più lento di ParallelGridSoA.
+ */
+constexpr float COMPACT_POSITION_STEP_X = (WIDTH + 2.0f * WRAP_MARGIN) / 65535.0f;
+constexpr float COMPACT_POSITION_STEP_Y = (HEIGHT + 2.0f * WRAP_MARGIN) / 65535.0f;
+constexpr float COMPACT_VELOCITY_STEP = MAX_SPEED / 32767.0f;
+
+// Corsie in coda agli array: un load di 16 da qualsiasi indice < size() resta
+// nell'array (le corsie oltre size() sono scartate dalla maschera)
+constexpr int COMPACT_PADDING = 16;
+
+inline std::uint16_t encodePosition(const float value, const float step) {
+    const float level = std::round((value + WRAP_MARGIN) / step);
+    return static_cast<std::uint16_t>(std::clamp(level, 0.0f, 65535.0f));
+}
+
+inline std::int16_t encodeVelocity(const float value) {
+    const float level = std::round(value / COMPACT_VELOCITY_STEP);
+    return static_cast<std::int16_t>(std::clamp(level, -32767.0f, 32767.0f));
+}
+
+inline float decodePosition(const std::uint16_t level, const float step) {
+    return static_cast<float>(level) * step - WRAP_MARGIN;
+}
+
+inline float decodeVelocity(const std::int16_t level) {
+    return static_cast<float>(level) * COMPACT_VELOCITY_STEP;
+}
+
+using CompactPositionArray = std::vector<std::uint16_t, AlignedAllocator<std::uint16_t>>;
+using CompactVelocityArray = std::vector<std::int16_t, AlignedAllocator<std::int16_t>>;
+
+struct BoidCompact {
+    CompactPositionArray posX, posY;
+    CompactVelocityArray velX, velY;
+    int count = 0;
+
+    // Array non scritti (azzerati da allocateStateBuffer): pagine al first-touch
+    explicit BoidCompact(const int n) : count{n} {
+        for (CompactPositionArray* array : {&posX, &posY}) resizeUninitialized(*array, n + COMPACT_PADDING);
+        for (CompactVelocityArray* array : {&velX, &velY}) resizeUninitialized(*array, n + COMPACT_PADDING);
+    }
+
+    [[nodiscard]] int size() const { return count; }
+
+    [[nodiscard]] Vector2 position(const int i) const {
+        return {decodePosition(posX[i], COMPACT_POSITION_STEP_X), decodePosition(posY[i], COMPACT_POSITION_STEP_Y)};
+    }
+
+    [[nodiscard]] Boid get(const int i) const {
+        return {position(i), {decodeVelocity(velX[i]), decodeVelocity(velY[i])}};
+    }
+
+    void set(const int i, const Boid& b) {
+        posX[i] = encodePosition(b.position.x, COMPACT_POSITION_STEP_X);
+        posY[i] = encodePosition(b.position.y, COMPACT_POSITION_STEP_Y);
+        velX[i] = encodeVelocity(b.velocity.x);
+        velY[i] = encodeVelocity(b.velocity.y);
+    }
+
+    void swap(BoidCompact& other) noexcept {
+        posX.swap(other.posX);
+        posY.swap(other.posY);
+        velX.swap(other.velX);
+        velY.swap(other.velY);
+        std::swap(count, other.count);
+    }
+};
+
+// Preferenza NUMA dei quattro array per intervalli schedule(static) di boid
+inline void bindToOwnerNodes(const BoidCompact& state) {
+    bindToOwnerNodes(state.posX, state.size());
+    bindToOwnerNodes(state.posY, state.size());
+    bindToOwnerNodes(state.velX, state.size());
+    bindToOwnerNodes(state.velY, state.size());
+}
+
+// W livelli a 16 bit come vettori GCC, da allargare alle corsie di Simd<W>
+template<int W>
+struct CompactLevels {
+    typedef std::uint16_t Position __attribute__((vector_size(2 * W)));
+    typedef std::int16_t Velocity __attribute__((vector_size(2 * W)));
+};
+
+template<int W>
+[[gnu::always_inline]] inline typename Simd<W>::Float decodePositionsSimd(const std::uint16_t* source, const float step) {
+    using V = Simd<W>;
+    typename CompactLevels<W>::Position levels;
+    std::memcpy(&levels, source, sizeof(levels));
+    return V::toFloat({__builtin_convertvector(levels, typename V::RawMask)}) * step - WRAP_MARGIN;
+}
+
+template<int W>
+[[gnu::always_inline]] inline typename Simd<W>::Float decodeVelocitiesSimd(const std::int16_t* source) {
+    using V = Simd<W>;
+    typename CompactLevels<W>::Velocity levels;
+    std::memcpy(&levels, source, sizeof(levels));
+    return V::toFloat({__builtin_convertvector(levels, typename V::RawMask)}) * COMPACT_VELOCITY_STEP;
+}
+
+// Sorgenti [begin, end) traslate di (shiftX, shiftY) contro il boid self,
+// W per volta; la maschera scarta le corsie oltre end e il boid stesso
+template<int W, bool Fast>
+[[gnu::always_inline]] inline void accumulateRangeCompact(FlockSumsSimd<W>& acc,
+                                                         const Vector2& self,
+                                                         const int selfIndex,
+                                                         const BoidCompact& state,
+                                                         const int begin,
+                                                         const int end,
+                                                         const float shiftX = 0.0f,
+                                                         const float shiftY = 0.0f)
+{
+    using V = Simd<W>;
+    const typename V::Float selfX = V::broadcast(self.x);
+    const typename V::Float selfY = V::broadcast(self.y);
+    const typename V::Mask lanes = V::lanes();
+
+    for (int j = begin; j < end; j += W) {
+        const typename V::Mask index = lanes + j;
+        // index < end come segno di index - end (vedi Simd::less)
+        const typename V::Mask valid = ((index - end) >> 31) & (index != selfIndex);
+
+        accumulateNeighborsSimd<W, Fast>(acc, selfX, selfY,
+            decodePositionsSimd<W>(state.posX.data() + j, COMPACT_POSITION_STEP_X) + shiftX,
+            decodePositionsSimd<W>(state.posY.data() + j, COMPACT_POSITION_STEP_Y) + shiftY,
+            decodeVelocitiesSimd<W>(state.velX.data() + j), decodeVelocitiesSimd<W>(state.velY.data() + j), valid);
+    }
+}
+
+// Chiude le regole del boid (decodificato) e lo ricodifica in next all'indice i
+template<int W, bool Fast>
+[[gnu::always_inline]] inline void finishBoidCompact(const FlockSumsSimd<W>& acc, const Boid& b, const int i, BoidCompact& next) {
+    FlockSums sums;
+    acc.reduceInto(sums);
+    Boid updated;
+    integrateBoid<Fast>(b, flockAcceleration<Fast>(sums, b), updated);
+    next.set(i, updated);
+}
+
+// Brute force: il boid i contro tutti
+template<int W, bool Fast>
+[[gnu::always_inline]] inline void computeNextBoidCompact(const int i,
+                                                         const BoidCompact& oldState,
+                                                         BoidCompact& newState)
+{
+    const Boid b = oldState.get(i);
+    FlockSumsSimd<W> acc;
+    accumulateRangeCompact<W, Fast>(acc, b.position, i, oldState, 0, oldState.size());
+    finishBoidCompact<W, Fast>(acc, b, i, newState);
+}
+
+// Bersagli [targetBegin, targetBegin + W) decodificati su W corsie; le corsie
+// oltre count vanno in SENTINEL_POSITION, come in loadTargetsSoA
+template<int W>
+[[gnu::always_inline]] inline BoidLanes<W> loadTargetsCompact(const int targetBegin, const BoidCompact& state, const int count) {
+    using V = Simd<W>;
+    BoidLanes<W> targets{decodePositionsSimd<W>(state.posX.data() + targetBegin, COMPACT_POSITION_STEP_X),
+                         decodePositionsSimd<W>(state.posY.data() + targetBegin, COMPACT_POSITION_STEP_Y),
+                         decodeVelocitiesSimd<W>(state.velX.data() + targetBegin),
+                         decodeVelocitiesSimd<W>(state.velY.data() + targetBegin)};
+    if (count < W) {
+        const typename V::Mask active = V::lanes() < count;
+        targets.posX = V::select(active, targets.posX, V::broadcast(SENTINEL_POSITION));
+        targets.posY = V::select(active, targets.posY, V::broadcast(SENTINEL_POSITION));
+    }
+    return targets;
+}
+
+// Sorgenti [begin, end) traslate di (shiftX, shiftY) sulle corsie dei bersagli,
+// come accumulateTargetsSoA: ogni sorgente si decodifica una volta per blocco
+template<int W, bool Fast>
+[[gnu::always_inline]] inline void accumulateTargetsCompact(FlockSumsSimd<W>& acc,
+                                                           const BoidLanes<W>& targets,
+                                                           const int targetBegin,
+                                                           const BoidCompact& source,
+                                                           const int begin,
+                                                           const int end,
+                                                           const float shiftX,
+                                                           const float shiftY)
+{
+    using V = Simd<W>;
+    const typename V::Mask allValid = ~typename V::Mask{};
+    const typename V::Mask targetIndex = V::lanes() + targetBegin;
+
+    const auto visit = [&](const int from, const int to, const bool selfPossible) __attribute__((always_inline)) {
+        for (int j = from; j < to; ++j) {
+            accumulateNeighborsSimd<W, Fast>(acc, targets.posX, targets.posY,
+                V::broadcast(decodePosition(source.posX[j], COMPACT_POSITION_STEP_X) + shiftX),
+                V::broadcast(decodePosition(source.posY[j], COMPACT_POSITION_STEP_Y) + shiftY),
+                V::broadcast(decodeVelocity(source.velX[j])), V::broadcast(decodeVelocity(source.velY[j])),
+                selfPossible ? targetIndex != j : allValid);
+        }
+    };
+
+    const int blockBegin = std::clamp(targetBegin, begin, end);
+    const int blockEnd = std::clamp(targetBegin + W, begin, end);
+    visit(begin, blockBegin, false);
+    visit(blockBegin, blockEnd, true);
+    visit(blockEnd, end, false);
+}
+
+/**
+ * Passo della griglia per i boid della cella sullo stato ordinato (vedi
+ * permuteByCellCompact), W per volta come computeCellSoA: i bersagli si
+ * decodificano una volta su W corsie e ogni sorgente una volta per blocco,
+ * invece di W sorgenti per ogni bersaglio. Chiusura e integrazione sono
+ * vettoriali (integrateBoidsSimd); la ricodifica è per corsia.
+ * Restituisce i candidati visitati (coppie bersaglio-sorgente).
+ */
+template<int W, int Reach, bool Periodic, bool Fast>
+[[gnu::always_inline]] inline long long computeCellCompact(const int cell,
+                                                         const BoidCompact& sorted,
+                                                         BoidCompact& next,
+                                                         const UniformGrid& grid)
+{
+    const int cellX = cell % grid.cellCountX;
+    const int cellY = cell / grid.cellCountX;
+    const int end = grid.cellEnd[cell];
+
+    long long candidates = 0;
+    for (int targetBegin = grid.cellBegin[cell]; targetBegin < end; targetBegin += W) {
+        const int count = std::min(W, end - targetBegin);
+        const BoidLanes<W> targets = loadTargetsCompact<W>(targetBegin, sorted, count);
+
+        FlockSumsSimd<W> acc;
+        forEachCellStencil<Reach, Periodic>(cellX, cellY, grid,
+            [&](const int source, const float shiftX, const float shiftY) __attribute__((always_inline)) {
+                const int sourceBegin = grid.cellBegin[source];
+                const int sourceEnd = grid.cellEnd[source];
+                accumulateTargetsCompact<W, Fast>(acc, targets, targetBegin, sorted, sourceBegin, sourceEnd, shiftX, shiftY);
+                candidates += static_cast<long long>(count) * (sourceEnd - sourceBegin);
+            });
+
+        BoidLanes<W> lanes;
+        integrateBoidsSimd<W, Fast>(acc, targets, lanes);
+        for (int lane = 0; lane < count; ++lane) {
+            next.set(targetBegin + lane, {{lanes.posX[lane], lanes.posY[lane]}, {lanes.velX[lane], lanes.velY[lane]}});
+        }
+    }
+    return candidates;
+}
+
+// Kernel scelti all'avvio in base all'ISA e alla precisione
+using StepKernelCompact = void (*)(int, const BoidCompact&, BoidCompact&);
+using CellKernelCompact = long long (*)(int, const BoidCompact&, BoidCompact&, const UniformGrid&);
+
+template<bool Fast>
+inline StepKernelCompact selectStepKernelCompact(const SimdIsa isa) {
+    switch (isa) {
+        case SimdIsa::Avx512: return SimdTargets<computeNextBoidCompact<16, Fast>>::avx512;
+        case SimdIsa::Avx2:   return SimdTargets<computeNextBoidCompact<8, Fast>>::avx2;
+        default:              return SimdTargets<computeNextBoidCompact<4, Fast>>::generic;
+    }
+}
+
+inline StepKernelCompact selectStepKernelCompact(const SimdIsa isa, const Precision precision) {
+    return precision == Precision::Fast ? selectStepKernelCompact<true>(isa) : selectStepKernelCompact<false>(isa);
+}
+
+template<int Reach, bool Periodic, bool Fast>
+inline CellKernelCompact selectCellKernelCompact(const SimdIsa isa) {
+    switch (isa) {
+        case SimdIsa::Avx512: return SimdTargets<computeCellCompact<16, Reach, Periodic, Fast>>::avx512;
+        case SimdIsa::Avx2:   return SimdTargets<computeCellCompact<8, Reach, Periodic, Fast>>::avx2;
+        default:              return SimdTargets<computeCellCompact<4, Reach, Periodic, Fast>>::generic;
+    }
+}
+
+template<int Reach, bool Periodic>
+inline CellKernelCompact selectCellKernelCompact(const SimdIsa isa, const Precision precision) {
+    return precision == Precision::Fast ? selectCellKernelCompact<Reach, Periodic, true>(isa)
+                                        : selectCellKernelCompact<Reach, Periodic, false>(isa);
+}
+
+// Posizione decodificata del boid i, per parallelBuildGridFrom
+struct CompactPosition {
+    const BoidCompact& state;
+    Vector2 operator()(const int i) const { return state.position(i); }
+};
+
+/**
+ * Permuta lo stato (livelli a 16 bit, senza decodificare) nell'ordine delle
+ * celle: da chiamare da tutti i thread di una regione parallela già aperta,
+ * dopo parallelBuildGridFrom.
+ */
+inline void permuteByCellCompact(const BoidCompact& state,
+                                 BoidCompact& sorted,
+                                 const UniformGrid& grid,
+                                 const int numBoids)
+{
+    #pragma omp for schedule(static)
+    for (int k = 0; k < numBoids; ++k) {
+        const int src = grid.cellIndices[k];
+        sorted.posX[k] = state.posX[src];
+        sorted.posY[k] = state.posY[src];
+        sorted.velX[k] = state.velX[src];
+        sorted.velY[k] = state.velY[src];
+    }
+}
@@ -0,0 +1,656 @@
+//BoidsDistributed.hpp
+#pragma once
+
+#include "BoidsGrid.hpp"
+#include "BoidsCommon.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <omp.h>
+#ifdef BOIDS_WITH_MPI
+#include <mpi.h>
+#endif
+
+/**
+ * Motore distribuito: il mondo (anche più grande di WIDTH x HEIGHT) è diviso
+ * in ranksX x ranksY rettangoli, uno per processo (rank). Ogni rank tiene
+ * solo i propri boid; a ogni passo
+ * 1) manda ai rank vicini le copie dei boid entro VIEW_RADIUS dal bordo
+ *    (l'alone), già traslate sul toro se il mondo è periodico,
+ * 2) calcola i propri boid su una griglia locale che copre il rettangolo
+ *    più l'alone,
+ * 3) manda al nuovo proprietario i boid usciti dal rettangolo.
+ * I lati dei rettangoli sono almeno VIEW_RADIUS, quindi l'alone e le
+ * migrazioni (anche il salto del wrap-around) riguardano solo gli 8 vicini
+ * sul toro dei rank.
+ * Il trasporto è un parametro di template con rank(), size(),
+ * exchange(peers, outbox, inbox), sum(x), max(x) e barrier():
+ * ShmTransport (processi locali, memoria condivisa POSIX) o MpiTransport
+ * (compilato con BOIDS_WITH_MPI).
+ */
+struct DistributedLayout {
+    int ranksX = 1, ranksY = 1;
+    float worldWidth = WIDTH, worldHeight = HEIGHT;
+    float subWidth = 0.0f, subHeight = 0.0f; // lati dei rettangoli sul toro [-WRAP_MARGIN, size + WRAP_MARGIN]
+    bool periodic = false;
+
+    [[nodiscard]] int ranks() const { return ranksX * ranksY; }
+    [[nodiscard]] float spanX() const { return worldWidth + 2.0f * WRAP_MARGIN; }
+    [[nodiscard]] float spanY() const { return worldHeight + 2.0f * WRAP_MARGIN; }
+
+    [[nodiscard]] int rankOf(const Vector2& position) const {
+        const int rx = std::clamp(static_cast<int>(std::floor((position.x + WRAP_MARGIN) / subWidth)), 0, ranksX - 1);
+        const int ry = std::clamp(static_cast<int>(std::floor((position.y + WRAP_MARGIN) / subHeight)), 0, ranksY - 1);
+        return ry * ranksX + rx;
+    }
+
+    // Angolo in basso a sinistra del rettangolo del rank
+    [[nodiscard]] Vector2 origin(const int rank) const {
+        return {static_cast<float>(rank % ranksX) * subWidth - WRAP_MARGIN,
+                static_cast<float>(rank / ranksX) * subHeight - WRAP_MARGIN};
+    }
+};
+
+/**
+ * Sceglie ranksX x ranksY = ranks con i rettangoli più vicini al quadrato
+ * (meno alone a parità di area). Restituisce false se un lato scenderebbe
+ * sotto VIEW_RADIUS.
+ */
+inline bool makeDistributedLayout(const int ranks, const float worldWidth, const float worldHeight,
+                                  const bool periodic, DistributedLayout& layout)
+{
+    layout.worldWidth = worldWidth;
+    layout.worldHeight = worldHeight;
+    layout.periodic = periodic;
+
+    float bestRatio = 0.0f;
+    for (int rx = 1; rx <= ranks; ++rx) {
+        if (ranks % rx != 0) continue;
+        const float width = layout.spanX() / static_cast<float>(rx);
+        const float height = layout.spanY() / static_cast<float>(ranks / rx);
+        if (const float ratio = std::max(width, height) / std::min(width, height); bestRatio == 0.0f || ratio < bestRatio) {
+            bestRatio = ratio;
+            layout.ranksX = rx;
+            layout.ranksY = ranks / rx;
+        }
+    }
+    layout.subWidth = layout.spanX() / static_cast<float>(layout.ranksX);
+    layout.subHeight = layout.spanY() / static_cast<float>(layout.ranksY);
+    return layout.subWidth >= VIEW_RADIUS && layout.subHeight >= VIEW_RADIUS;
+}
+
+// Gli 8 vicini del rank sul toro dei rank, senza ripetizioni né il rank
+// stesso: con due rank per lato il vicino sinistro è anche quello destro
+inline std::vector<int> neighborRanks(const DistributedLayout& layout, const int rank) {
+    const int rx = rank % layout.ranksX;
+    const int ry = rank / layout.ranksX;
+    std::vector<int> peers;
+    for (int dy = -1; dy <= 1; ++dy) {
+        for (int dx = -1; dx <= 1; ++dx) {
+            const int peer = ((ry + dy + layout.ranksY) % layout.ranksY) * layout.ranksX
+                           + (rx + dx + layout.ranksX) % layout.ranksX;
+            if (peer != rank && std::find(peers.begin(), peers.end(), peer) == peers.end()) peers.push_back(peer);
+        }
+    }
+    return peers;
+}
+
+/**
+ * Copie d'alone di b (che sta nel rettangolo del rank in (rx, ry), con
+ * angolo origin): una per ogni vicino il cui rettangolo dista meno di
+ * VIEW_RADIUS, traslata del periodo quando il vicino è oltre il bordo del
+ * mondo (solo se periodico). Con un solo rank per lato il vicino è il rank
+ * stesso: la copia finisce in outbox[rank] ed è un alone locale.
+ */
+inline void routeHalo(const Boid& b, const DistributedLayout& layout, const int rx, const int ry,
+                      const Vector2& origin, std::vector<BoidArray>& outbox)
+{
+    const bool nearX[3] = {b.position.x - origin.x < VIEW_RADIUS, true,
+                           origin.x + layout.subWidth - b.position.x < VIEW_RADIUS};
+    const bool nearY[3] = {b.position.y - origin.y < VIEW_RADIUS, true,
+                           origin.y + layout.subHeight - b.position.y < VIEW_RADIUS};
+
+    for (int dy = -1; dy <= 1; ++dy) {
+        if (!nearY[dy + 1]) continue;
+        int ty = ry + dy;
+        float shiftY = 0.0f;
+        if (ty < 0 || ty >= layout.ranksY) {
+            if (!layout.periodic) continue;
+            shiftY = ty < 0 ? layout.spanY() : -layout.spanY();
+            ty = (ty + layout.ranksY) % layout.ranksY;
+        }
+        for (int dx = -1; dx <= 1; ++dx) {
+            if (!nearX[dx + 1] || (dx == 0 && dy == 0)) continue;
+            int tx = rx + dx;
+            float shiftX = 0.0f;
+            if (tx < 0 || tx >= layout.ranksX) {
+                if (!layout.periodic) continue;
+                shiftX = tx < 0 ? layout.spanX() : -layout.spanX();
+                tx = (tx + layout.ranksX) % layout.ranksX;
+            }
+            outbox[ty * layout.ranksX + tx].push_back({{b.position.x + shiftX, b.position.y + shiftY}, b.velocity});
+        }
+    }
+}
+
+/**
+ * Inizializzazione a reticolo come negli altri motori, sul mondo del
+ * layout: ogni rank genera solo i punti del reticolo che cadono nel suo
+ * rettangolo, senza mai materializzare lo stato globale.
+ */
+inline void initializeOwned(BoidArray& owned, const DistributedLayout& layout, const int rank, const long long numBoids) {
+    const int gridSize = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(numBoids))));
+    const float spacingX = layout.worldWidth / static_cast<float>(gridSize);
+    const float spacingY = layout.worldHeight / static_cast<float>(gridSize);
+    const float centerX = layout.worldWidth / 2.0f;
+    const float centerY = layout.worldHeight / 2.0f;
+    const int rx = rank % layout.ranksX;
+    const int ry = rank / layout.ranksX;
+
+    std::vector<int> cols;
+    for (int col = 0; col < gridSize; ++col) {
+        const float posX = static_cast<float>(col) * spacingX + spacingX / 2.0f;
+        if (layout.rankOf({posX, 0.0f}) % layout.ranksX == rx) cols.push_back(col);
+    }
+
+    owned.clear();
+    for (int row = 0; row < gridSize; ++row) {
+        const float posY = static_cast<float>(row) * spacingY + spacingY / 2.0f;
+        if (layout.rankOf({0.0f, posY}) / layout.ranksX != ry) continue;
+        for (const int col : cols) {
+            if (static_cast<long long>(row) * gridSize + col >= numBoids) break;
+            const float posX = static_cast<float>(col) * spacingX + spacingX / 2.0f;
+            const float angle = std::atan2(posY - centerY, posX - centerX);
+            owned.push_back({{posX, posY}, {std::cos(angle) * MAX_SPEED, std::sin(angle) * MAX_SPEED}});
+        }
+    }
+}
+
+/**
+ * Boid i di local (griglia locale, non periodica: l'alone è già traslato)
+ * con il wrap-around sul mondo del layout; restituisce i candidati visitati.
+ */
+template<int Reach, bool Fast>
+inline int computeNextBoidDistributed(const int i,
+                                      const BoidArray& local,
+                                      BoidArray& next,
+                                      const UniformGrid& grid,
+                                      const DistributedLayout& layout)
+{
+    const Boid& b = local[i];
+    FlockSums sums;
+    const int candidates = accumulateGridSums<Reach, false, false, Fast>(i, local, grid, sums);
+    integrateBoid<Fast>(b, flockAcceleration<Fast>(sums, b), next[i], layout.worldWidth, layout.worldHeight);
+    return candidates;
+}
+
+// Contatori di un rank, sommati su tutti i rank per il report
+struct DistributedStats {
+    double candidates = 0.0;
+    double haloBoids = 0.0;  // copie d'alone ricevute (anche da se stesso)
+    double migrations = 0.0; // boid passati a un altro rank
+};
+
+/**
+ * Simula steps passi dei boid di owned, partendo insieme agli altri rank
+ * del trasporto. grid è la griglia locale del rank, con origine e celle
+ * già fissate sul rettangolo più VIEW_RADIUS per lato.
+ */
+template<int Reach, bool Fast, typename Transport>
+inline void simulateRank(Transport& transport,
+                         const DistributedLayout& layout,
+                         BoidArray& owned,
+                         UniformGrid& grid,
+                         const int steps,
+                         DistributedStats& stats)
+{
+    const int rank = transport.rank();
+    const int rx = rank % layout.ranksX;
+    const int ry = rank / layout.ranksX;
+    const Vector2 origin = layout.origin(rank);
+    const std::vector<int> peers = neighborRanks(layout, rank);
+
+    std::vector<BoidArray> outbox(layout.ranks()), inbox(layout.ranks());
+    BoidArray local, next;
+    const int maxThreads = omp_get_max_threads();
+
+    for (int step = 0; step < steps; ++step) {
+        // 1) Alone: i propri boid seguiti dalle copie dei vicini
+        for (BoidArray& box : outbox) box.clear();
+        for (const Boid& b : owned) routeHalo(b, layout, rx, ry, origin, outbox);
+        transport.exchange(peers, outbox, inbox);
+
+        local.assign(owned.begin(), owned.end());
+        local.insert(local.end(), outbox[rank].begin(), outbox[rank].end());
+        for (const int peer : peers) local.insert(local.end(), inbox[peer].begin(), inbox[peer].end());
+        stats.haloBoids += static_cast<double>(local.size() - owned.size());
+
+        // 2) Forze sui boid propri, i primi di local
+        const int ownedCount = static_cast<int>(owned.size());
+        resizeUninitialized(next, ownedCount);
+        grid.prepareParallelBuild(static_cast<int>(local.size()), maxThreads);
+        long long candidates = 0;
+        #pragma omp parallel default(none) shared(local, next, grid, layout, ownedCount) reduction(+:candidates)
+        {
+            parallelBuildGrid(local, grid);
+
+            #pragma omp for schedule(static)
+            for (int i = 0; i < ownedCount; ++i) {
+                candidates += computeNextBoidDistributed<Reach, Fast>(i, local, next, grid, layout);
+            }
+        }
+        stats.candidates += static_cast<double>(candidates);
+
+        // 3) Migrazioni: chi è uscito dal rettangolo passa al nuovo rank
+        for (BoidArray& box : outbox) box.clear();
+        owned.clear();
+        for (const Boid& b : next) {
+            if (const int target = layout.rankOf(b.position); target == rank) owned.push_back(b);
+            else outbox[target].push_back(b);
+        }
+        transport.exchange(peers, outbox, inbox);
+        for (const int peer : peers) {
+            owned.insert(owned.end(), inbox[peer].begin(), inbox[peer].end());
+            stats.migrations += static_cast<double>(inbox[peer].size());
+        }
+    }
+}
+
+/**
+ * Trasporto tra processi dello stesso host in memoria condivisa POSIX.
+ * Ogni rank scrive i messaggi in uscita nel proprio segmento (una tabella
+ * offset/conteggio per destinatario seguita dai boid) e i destinatari li
+ * copiano dopo una barriera; una seconda barriera libera i segmenti.
+ * Un segmento cresce solo mentre nessuno lo legge: il proprietario lo
+ * allarga con ftruncate e pubblica la nuova dimensione nel segmento di
+ * controllo, i lettori rimappano alla lettura successiva.
+ * La barriera tra i rank è un contatore con generazione nel segmento di
+ * controllo; un rank che fallisce alza aborted e chi attende lancia invece
+ * di restare bloccato. Il lanciatore (launchLocalRanks) crea e rimuove gli
+ * oggetti shm.
+ */
+constexpr int SHM_MAX_RANKS = 256;
+constexpr std::size_t SHM_INITIAL_BYTES = std::size_t{1} << 20;
+constexpr int SHM_SPIN_POLLS = 1024; // controlli prima di cedere la CPU in barrier()
+
+struct ShmControl {
+    std::atomic<int> arrived{0};                          // rank arrivati alla barriera corrente
+    std::atomic<unsigned> generation{0};                  // barriere completate
+    std::atomic<bool> aborted{false};                     // un rank è fallito
+    std::atomic<std::size_t> segmentBytes[SHM_MAX_RANKS]; // dimensione del segmento di ogni rank
+    double reduceSlots[SHM_MAX_RANKS];
+};
+static_assert(std::atomic<int>::is_always_lock_free && std::atomic<std::size_t>::is_always_lock_free,
+              "atomici condivisi tra processi");
+
+struct ShmMailbox {
+    std::size_t offset[SHM_MAX_RANKS]; // in boid, dall'inizio dei dati
+    std::size_t count[SHM_MAX_RANKS];
+};
+
+constexpr std::size_t SHM_DATA_OFFSET = (sizeof(ShmMailbox) + 63) / 64 * 64;
+
+inline std::string shmName(const int session, const int rank) {
+    return "/boids-" + std::to_string(session) + (rank < 0 ? std::string("-ctl") : "-" + std::to_string(rank));
+}
+
+inline void* mapShm(const int fd, const std::size_t bytes) {
+    void* mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) throw std::system_error(errno, std::generic_category(), "mmap");
+    return mapped;
+}
+
+inline int openShm(const std::string& name, const int flags) {
+    const int fd = shm_open(name.c_str(), flags, 0600);
+    if (fd < 0) throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+    return fd;
+}
+
+class ShmTransport {
+public:
+    // Crea il controllo e i segmenti della sessione, prima di lanciare i rank
+    static void create(const int session, const int ranks) {
+        const int fd = openShm(shmName(session, -1), O_CREAT | O_EXCL | O_RDWR);
+        if (ftruncate(fd, sizeof(ShmControl)) != 0) {
+            close(fd);
+            throw std::system_error(errno, std::generic_category(), "ftruncate");
+        }
+        auto* control = new (mapShm(fd, sizeof(ShmControl))) ShmControl{};
+        close(fd);
+
+        for (int r = 0; r < ranks; ++r) {
+            const int segment = openShm(shmName(session, r), O_CREAT | O_EXCL | O_RDWR);
+            const bool sized = ftruncate(segment, SHM_INITIAL_BYTES) == 0;
+            close(segment);
+            if (!sized) throw std::system_error(errno, std::generic_category(), "ftruncate");
+            control->segmentBytes[r].store(SHM_INITIAL_BYTES);
+        }
+        munmap(control, sizeof(ShmControl));
+    }
+
+    // Segnala a tutti i rank della sessione che uno è fallito: le loro
+    // barriere lanciano. Non lancia (si chiama da un gestore d'errore).
+    static void abort(const int session) noexcept {
+        const int fd = shm_open(shmName(session, -1).c_str(), O_RDWR, 0600);
+        if (fd < 0) return;
+        void* mapped = mmap(nullptr, sizeof(ShmControl), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED) return;
+        static_cast<ShmControl*>(mapped)->aborted.store(true, std::memory_order_release);
+        munmap(mapped, sizeof(ShmControl));
+    }
+
+    static void unlink(const int session, const int ranks) {
+        shm_unlink(shmName(session, -1).c_str());
+        for (int r = 0; r < ranks; ++r) shm_unlink(shmName(session, r).c_str());
+    }
+
+    ShmTransport(const int session, const int rank, const int ranks)
+        : rank_{rank}, ranks_{ranks}, fds(ranks), segments(ranks, nullptr), mappedBytes(ranks, 0)
+    {
+        const int fd = openShm(shmName(session, -1), O_RDWR);
+        control = static_cast<ShmControl*>(mapShm(fd, sizeof(ShmControl)));
+        close(fd);
+        for (int r = 0; r < ranks; ++r) {
+            fds[r] = openShm(shmName(session, r), O_RDWR);
+            remap(r);
+        }
+    }
+
+    ~ShmTransport() {
+        for (int r = 0; r < ranks_; ++r) {
+            if (segments[r]) munmap(segments[r], mappedBytes[r]);
+            close(fds[r]);
+        }
+        munmap(control, sizeof(ShmControl));
+    }
+
+    ShmTransport(const ShmTransport&) = delete;
+    ShmTransport& operator=(const ShmTransport&) = delete;
+
+    [[nodiscard]] int rank() const { return rank_; }
+    [[nodiscard]] int size() const { return ranks_; }
+
+    // Barriera tra i rank; lancia std::runtime_error se un rank è fallito
+    void barrier() {
+        const unsigned generation = control->generation.load(std::memory_order_acquire);
+        if (control->arrived.fetch_add(1, std::memory_order_acq_rel) == ranks_ - 1) {
+            control->arrived.store(0, std::memory_order_relaxed);
+            control->generation.store(generation + 1, std::memory_order_release);
+            return;
+        }
+        for (int polls = 0; control->generation.load(std::memory_order_acquire) == generation; ++polls) {
+            if (control->aborted.load(std::memory_order_acquire)) throw std::runtime_error("un altro rank è fallito");
+            if (polls >= SHM_SPIN_POLLS) std::this_thread::yield();
+        }
+    }
+
+    // outbox[peer] va a peer, inbox[peer] riceve da peer; peers deve essere
+    // simmetrico (se a elenca b, b elenca a)
+    void exchange(const std::vector<int>& peers, const std::vector<BoidArray>& outbox, std::vector<BoidArray>& inbox) {
+        std::size_t total = 0;
+        for (const int peer : peers) total += outbox[peer].size();
+        if (const std::size_t bytes = SHM_DATA_OFFSET + total * sizeof(Boid); bytes > mappedBytes[rank_]) grow(bytes);
+
+        auto* mailbox = static_cast<ShmMailbox*>(segments[rank_]);
+        Boid* data = boidsOf(rank_);
+        std::size_t offset = 0;
+        for (const int peer : peers) {
+            mailbox->offset[peer] = offset;
+            mailbox->count[peer] = outbox[peer].size();
+            std::copy(outbox[peer].begin(), outbox[peer].end(), data + offset);
+            offset += outbox[peer].size();
+        }
+        barrier();
+
+        for (const int peer : peers) {
+            if (control->segmentBytes[peer].load(std::memory_order_acquire) > mappedBytes[peer]) remap(peer);
+            const auto* source = static_cast<const ShmMailbox*>(segments[peer]);
+            const Boid* first = boidsOf(peer) + source->offset[rank_];
+            inbox[peer].assign(first, first + source->count[rank_]);
+        }
+        barrier();
+    }
+
+    double sum(const double value) {
+        return reduce(value, [](const double a, const double b) { return a + b; });
+    }
+
+    double max(const double value) {
+        return reduce(value, [](const double a, const double b) { return std::max(a, b); });
+    }
+
+private:
+    int rank_, ranks_;
+    ShmControl* control = nullptr;
+    std::vector<int> fds;
+    std::vector<void*> segments;
+    std::vector<std::size_t> mappedBytes;
+
+    Boid* boidsOf(const int r) const {
+        return reinterpret_cast<Boid*>(static_cast<char*>(segments[r]) + SHM_DATA_OFFSET);
+    }
+
+    void remap(const int r) {
+        if (segments[r]) munmap(segments[r], mappedBytes[r]);
+        mappedBytes[r] = control->segmentBytes[r].load(std::memory_order_acquire);
+        segments[r] = mapShm(fds[r], mappedBytes[r]);
+    }
+
+    // Solo tra le due barriere di exchange, quando nessuno legge il segmento
+    void grow(const std::size_t bytes) {
+        const std::size_t newBytes = std::max(bytes, 2 * mappedBytes[rank_]);
+        if (ftruncate(fds[rank_], static_cast<off_t>(newBytes)) != 0) throw std::system_error(errno, std::generic_category(), "ftruncate");
+        control->segmentBytes[rank_].store(newBytes, std::memory_order_release);
+        remap(rank_);
+    }
+
+    template<typename Op>
+    double reduce(const double value, Op op) {
+        control->reduceSlots[rank_] = value;
+        barrier();
+        double result = control->reduceSlots[0];
+        for (int r = 1; r < ranks_; ++r) result = op(result, control->reduceSlots[r]);
+        barrier();
+        return result;
+    }
+};
+
+/**
+ * Restringe l'affinità del processo alla rank-esima di ranks fette
+ * disgiunte delle CPU concesse (con più rank che CPU, una CPU a testa
+ * modulo il loro numero). Da chiamare nel rank prima della prima regione
+ * OpenMP, i cui thread ereditano la maschera. Restituisce le CPU della
+ * fetta, 0 se l'affinità non è disponibile.
+ */
+inline int restrictToRankCpus(const int rank, const int ranks) {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return 0;
+    const int count = CPU_COUNT(&allowed);
+    if (count == 0) return 0;
+
+    const int first = count >= ranks ? static_cast<int>(static_cast<long long>(count) * rank / ranks) : rank % count;
+    const int last = count >= ranks ? static_cast<int>(static_cast<long long>(count) * (rank + 1) / ranks) : first + 1;
+    cpu_set_t slice;
+    CPU_ZERO(&slice);
+    for (int cpu = 0, index = 0; cpu < CPU_SETSIZE && index < last; ++cpu) {
+        if (!CPU_ISSET(cpu, &allowed)) continue;
+        if (index >= first) CPU_SET(cpu, &slice);
+        ++index;
+    }
+    return sched_setaffinity(0, sizeof(slice), &slice) == 0 ? last - first : 0;
+}
+
+/**
+ * Sessione shm del lanciatore: crea gli oggetti alla costruzione; alla
+ * distruzione, anche per un'eccezione del rank 0, interrompe le barriere
+ * dei figli rimasti, li attende e rimuove gli oggetti shm.
+ */
+class ShmSession {
+public:
+    ShmSession(const int session, const int ranks) : session_{session}, ranks_{ranks} {
+        try {
+            ShmTransport::create(session, ranks);
+        } catch (...) {
+            ShmTransport::unlink(session, ranks);
+            throw;
+        }
+    }
+
+    ~ShmSession() {
+        if (!children.empty()) {
+            ShmTransport::abort(session_);
+            waitChildren();
+        }
+        ShmTransport::unlink(session_, ranks_);
+    }
+
+    ShmSession(const ShmSession&) = delete;
+    ShmSession& operator=(const ShmSession&) = delete;
+
+    void addChild(const pid_t pid) { children.push_back(pid); }
+
+    // Attende i figli; true se tutti sono usciti con 0
+    bool waitChildren() {
+        bool succeeded = true;
+        for (const pid_t pid : children) {
+            int status = 0;
+            if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) succeeded = false;
+        }
+        children.clear();
+        return succeeded;
+    }
+
+private:
+    int session_, ranks_;
+    std::vector<pid_t> children;
+};
+
+/**
+ * Lancia ranks processi locali: crea la sessione shm ed esegue
+ * body(transport) nel processo corrente come rank 0 e con fork negli
+ * altri, ognuno con il proprio ShmTransport; attende i figli
+ * e rimuove gli oggetti shm. Un rank che fallisce interrompe gli altri
+ * (vedi ShmTransport::abort). Va chiamata prima di qualsiasi regione
+ * OpenMP (il runtime non sopravvive al fork). Restituisce 0 se tutti i
+ * rank terminano con 0.
+ */
+template<typename Body>
+inline int launchLocalRanks(const int ranks, Body&& body) {
+    const int session = static_cast<int>(getpid());
+    ShmSession shm(session, ranks);
+
+    for (int r = 1; r < ranks; ++r) {
+        const pid_t pid = fork();
+        if (pid == 0) {
+            int status = 1;
+            try {
+                ShmTransport transport(session, r, ranks);
+                status = body(transport);
+            } catch (const std::exception& error) {
+                std::cerr << "Rank " << r << ": " << error.what() << std::endl;
+                ShmTransport::abort(session);
+            }
+            std::_Exit(status);
+        }
+        if (pid < 0) throw std::system_error(errno, std::generic_category(), "fork");
+        shm.addChild(pid);
+    }
+
+    int result = 1;
+    try {
+        ShmTransport transport(session, 0, ranks);
+        result = body(transport);
+    } catch (const std::exception& error) {
+        std::cerr << "Rank 0: " << error.what() << std::endl;
+        ShmTransport::abort(session);
+    }
+    if (!shm.waitChildren()) result = 1;
+    return result;
+}
+
+#ifdef BOIDS_WITH_MPI
+/**
+ * Trasporto MPI (processi lanciati da mpirun, anche su più host): prima i
+ * conteggi e poi i boid, in messaggi non bloccanti con i soli vicini.
+ * MPI_Init/MPI_Finalize restano al chiamante.
+ */
+class MpiTransport {
+public:
+    MpiTransport() {
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank_);
+        MPI_Comm_size(MPI_COMM_WORLD, &ranks_);
+    }
+
+    [[nodiscard]] int rank() const { return rank_; }
+    [[nodiscard]] int size() const { return ranks_; }
+
+    void barrier() { MPI_Barrier(MPI_COMM_WORLD); }
+
+    void exchange(const std::vector<int>& peers, const std::vector<BoidArray>& outbox, std::vector<BoidArray>& inbox) {
+        const int numPeers = static_cast<int>(peers.size());
+        std::vector<long long> sendCounts(numPeers), recvCounts(numPeers);
+        std::vector<MPI_Request> requests(2 * numPeers);
+
+        for (int p = 0; p < numPeers; ++p) {
+            sendCounts[p] = static_cast<long long>(outbox[peers[p]].size());
+            MPI_Irecv(&recvCounts[p], 1, MPI_LONG_LONG, peers[p], 0, MPI_COMM_WORLD, &requests[p]);
+            MPI_Isend(&sendCounts[p], 1, MPI_LONG_LONG, peers[p], 0, MPI_COMM_WORLD, &requests[numPeers + p]);
+        }
+        MPI_Waitall(2 * numPeers, requests.data(), MPI_STATUSES_IGNORE);
+
+        for (int p = 0; p < numPeers; ++p) {
+            resizeUninitialized(inbox[peers[p]], recvCounts[p]);
+            MPI_Irecv(inbox[peers[p]].data(), static_cast<int>(recvCounts[p] * sizeof(Boid)), MPI_BYTE,
+                      peers[p], 1, MPI_COMM_WORLD, &requests[p]);
+            MPI_Isend(outbox[peers[p]].data(), static_cast<int>(sendCounts[p] * sizeof(Boid)), MPI_BYTE,
+                      peers[p], 1, MPI_COMM_WORLD, &requests[numPeers + p]);
+        }
+        MPI_Waitall(2 * numPeers, requests.data(), MPI_STATUSES_IGNORE);
+    }
+
+    double sum(double value) {
+        MPI_Allreduce(MPI_IN_PLACE, &value, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        return value;
+    }
+
+    double max(double value) {
+        MPI_Allreduce(MPI_IN_PLACE, &value, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+        return value;
+    }
+
+private:
+    int rank_ = 0, ranks_ = 1;
+};
+#endif
+
+// Riepilogo su tutti i rank, stampato dal rank 0
+inline void printDistributedReport(const char* transport, const DistributedLayout& layout,
+                                   const double haloBoids, const double migrations,
+                                   const double finalBoids, const int steps)
+{
+    std::cout << "DISTRIBUTED TRANSPORT=" << transport << " RANKS=" << layout.ranks()
+              << " LAYOUT=" << layout.ranksX << "x" << layout.ranksY
+              << " THREADS_PER_RANK=" << omp_get_max_threads()
+              << " WORLD=" << layout.worldWidth << "x" << layout.worldHeight
+              << " HALO_BOIDS_PER_STEP=" << haloBoids / steps
+              << " MIGRATIONS_PER_STEP=" << migrations / steps
+              << " BOIDS_END=" << static_cast<long long>(finalBoids) << std::endl;
+}
@@ -0,0 +1,276 @@
+//BoidsDomains.hpp
+#pragma once
+
+#include "BoidsAlloc.hpp"
+#include "BoidsGrid.hpp"
+#include "BoidsCommon.hpp"
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <vector>
+
+/**
+ * Decomposizione spaziale della griglia: ogni thread possiede un rettangolo
+ * di celle (un dominio) e i boid che vi si trovano, in buffer propri che
+ * alloca e tocca per primo (quindi sul nodo NUMA su cui è fissato).
+ * A ogni passo un thread legge dagli altri domini solo l'alone, cioè le
+ * celle entro Reach dal bordo del suo rettangolo; i boid che escono dal
+ * dominio passano al proprietario della nuova cella.
+ */
+struct CellRect {
+    int x0, x1; // colonne di celle [x0, x1)
+    int y0, y1; // righe di celle [y0, y1)
+
+    [[nodiscard]] int cells() const { return (x1 - x0) * (y1 - y0); }
+};
+
+struct DomainDecomposition {
+    std::vector<CellRect> domains;
+    std::vector<int> cellOwner;               // dominio di ogni cella
+    std::vector<std::vector<int>> haloCells;  // celle altrui lette da ogni dominio
+};
+
+// Strisce orizzontali di righe di celle, con lo stesso numero di righe (+-1);
+// con più domini che righe alcune strisce restano vuote
+inline void splitIntoStrips(const UniformGrid& grid, const int parts, std::vector<CellRect>& domains) {
+    domains.resize(parts);
+    for (int d = 0; d < parts; ++d) {
+        domains[d] = {0, grid.cellCountX,
+                      d * grid.cellCountY / parts, (d + 1) * grid.cellCountY / parts};
+    }
+}
+
+/**
+ * Peso di ogni cella per la bisezione: il costo stimato del loop delle
+ * forze, occupazione x occupazione dello stencil (vedi partitionByCost);
+ * countOf(cell) dà i boid della cella.
+ */
+template<int Reach, typename CountOf>
+inline void cellWeights(const UniformGrid& grid, CountOf&& countOf, std::vector<double>& weights) {
+    weights.resize(grid.numCells());
+    for (int cellY = 0; cellY < grid.cellCountY; ++cellY) {
+        for (int cellX = 0; cellX < grid.cellCountX; ++cellX) {
+            const int cell = grid.getCellIndex(cellX, cellY);
+            weights[cell] = static_cast<double>(countOf(cell)) * neighborhoodOccupancy<Reach>(grid, cellX, cellY, countOf);
+        }
+    }
+}
+
+/**
+ * Bisezione ricorsiva ortogonale (ORB): divide rect in parts rettangoli di
+ * peso quasi uguale. Ogni livello taglia il lato più lungo (in celle) tra
+ * due colonne o righe, dove il peso a sinistra è più vicino alla quota
+ * delle parts / 2 parti di sinistra. Un rettangolo di una sola cella va
+ * alla prima parte, le altre restano vuote.
+ */
+inline void bisectDomains(const UniformGrid& grid, const std::vector<double>& weights,
+                          const CellRect rect, const int parts, CellRect* out)
+{
+    const int width = rect.x1 - rect.x0;
+    const int height = rect.y1 - rect.y0;
+    if (parts == 1) {
+        out[0] = rect;
+        return;
+    }
+    if (width < 2 && height < 2) {
+        out[0] = rect;
+        for (int p = 1; p < parts; ++p) out[p] = {rect.x1, rect.x1, rect.y1, rect.y1};
+        return;
+    }
+
+    const bool alongX = width >= height;
+    const int begin = alongX ? rect.x0 : rect.y0;
+    const int end = alongX ? rect.x1 : rect.y1;
+
+    // Peso di ogni colonna (o riga) del rettangolo
+    std::vector<double> slices(end - begin, 0.0);
+    double total = 0.0;
+    for (int cellY = rect.y0; cellY < rect.y1; ++cellY) {
+        for (int cellX = rect.x0; cellX < rect.x1; ++cellX) {
+            const double weight = weights[grid.getCellIndex(cellX, cellY)];
+            slices[(alongX ? cellX : cellY) - begin] += weight;
+            total += weight;
+        }
+    }
+
+    const int leftParts = parts / 2;
+    const double target = total * leftParts / parts;
+    int cut = begin + 1;
+    double left = slices[0];
+    double bestError = std::abs(left - target);
+    for (int k = begin + 2; k < end; ++k) {
+        left += slices[k - 1 - begin];
+        if (const double error = std::abs(left - target); error < bestError) {
+            bestError = error;
+            cut = k;
+        }
+    }
+
+    CellRect first = rect, second = rect;
+    if (alongX) first.x1 = second.x0 = cut;
+    else first.y1 = second.y0 = cut;
+    bisectDomains(grid, weights, first, leftParts, out);
+    bisectDomains(grid, weights, second, parts - leftParts, out + leftParts);
+}
+
+inline void orbDomains(const UniformGrid& grid, const std::vector<double>& weights,
+                       const int parts, std::vector<CellRect>& domains)
+{
+    domains.resize(parts);
+    bisectDomains(grid, weights, {0, grid.cellCountX, 0, grid.cellCountY}, parts, domains.data());
+}
+
+/**
+ * Dai rettangoli di decomposition.domains (che coprono la griglia senza
+ * sovrapporsi) calcola il proprietario di ogni cella e l'alone di ogni
+ * dominio: le celle altrui a distanza di Chebyshev al più reach dal
+ * rettangolo, avvolte sul toro se la griglia è periodica.
+ */
+inline void assignDomains(const UniformGrid& grid, const int reach, DomainDecomposition& decomposition) {
+    const int numDomains = static_cast<int>(decomposition.domains.size());
+    decomposition.cellOwner.assign(grid.numCells(), 0);
+    for (int d = 0; d < numDomains; ++d) {
+        const CellRect& rect = decomposition.domains[d];
+        for (int cellY = rect.y0; cellY < rect.y1; ++cellY) {
+            for (int cellX = rect.x0; cellX < rect.x1; ++cellX) {
+                decomposition.cellOwner[grid.getCellIndex(cellX, cellY)] = d;
+            }
+        }
+    }
+
+    decomposition.haloCells.resize(numDomains);
+    std::vector<int> seenBy(grid.numCells(), -1);
+    for (int d = 0; d < numDomains; ++d) {
+        const CellRect& rect = decomposition.domains[d];
+        std::vector<int>& halo = decomposition.haloCells[d];
+        halo.clear();
+        if (rect.cells() == 0) continue;
+
+        for (int y = rect.y0 - reach; y < rect.y1 + reach; ++y) {
+            for (int x = rect.x0 - reach; x < rect.x1 + reach; ++x) {
+                int cellX = x, cellY = y;
+                if (grid.periodic) {
+                    cellX = (x % grid.cellCountX + grid.cellCountX) % grid.cellCountX;
+                    cellY = (y % grid.cellCountY + grid.cellCountY) % grid.cellCountY;
+                } else if (x < 0 || x >= grid.cellCountX || y < 0 || y >= grid.cellCountY) {
+                    continue;
+                }
+                const int cell = grid.getCellIndex(cellX, cellY);
+                if (decomposition.cellOwner[cell] == d || seenBy[cell] == d) continue;
+                seenBy[cell] = d;
+                halo.push_back(cell);
+            }
+        }
+    }
+}
+
+/**
+ * Stato di un dominio, usato solo dal suo thread salvo owned, cellBegin,
+ * cellEnd (letti dagli altri per l'alone) e outbox (letto dai destinatari).
+ * I vettori e la griglia nascono dentro la regione parallela, quindi le
+ * pagine sono toccate per prime dal proprietario.
+ */
+struct DomainState {
+    BoidArray owned;                // boid del dominio, ordinati per cella
+    std::vector<int> cellBegin;     // la cella c occupa owned[cellBegin[c] .. cellEnd[c])
+    std::vector<int> cellEnd;
+    BoidArray local;                // owned seguiti dall'alone copiato dagli altri domini
+    BoidArray next;                 // nuovo stato dei boid di owned
+    std::vector<int> nextCell;      // cella di ogni boid di next
+    std::vector<BoidArray> outbox;  // boid usciti, per dominio di destinazione
+    std::optional<UniformGrid> grid; // griglia locale su local, creata dal thread del dominio
+
+    // Contatori del dominio per il report
+    long long haloBoids = 0;
+    long long migrations = 0;
+    long long rebalanceMoves = 0;  // boid ceduti nelle ripartizioni
+    double windowStart = 0.0;      // lavoro del thread a inizio finestra (Orb)
+    int minOwned = 0;
+    int maxOwned = 0;
+
+    explicit DomainState(const int numDomains) : outbox(numDomains) {}
+};
+
+/**
+ * Riempie owned (ordinato per cella, counting sort) con i boid dati da
+ * forEachIncoming, che va chiamato due volte: forEachIncoming(callback)
+ * deve passare a callback(boid, cella) ogni boid del dominio.
+ */
+template<typename ForEachIncoming>
+inline void rebuildOwned(DomainState& state, const int numCells, ForEachIncoming&& forEachIncoming) {
+    state.cellBegin.assign(numCells, 0);
+    state.cellEnd.assign(numCells, 0);
+    forEachIncoming([&state](const Boid&, const int cell) { state.cellEnd[cell]++; });
+
+    int offset = 0;
+    for (int c = 0; c < numCells; ++c) {
+        state.cellBegin[c] = offset;
+        offset += state.cellEnd[c];
+        state.cellEnd[c] = state.cellBegin[c];
+    }
+
+    resizeUninitialized(state.owned, offset);
+    forEachIncoming([&state](const Boid& b, const int cell) { state.owned[state.cellEnd[cell]++] = b; });
+}
+
+/**
+ * Copia in state.local i boid propri seguiti da quelli delle celle
+ * dell'alone, letti dai domini che le possiedono; restituisce i boid propri
+ * (gli indici [0, owned) di local).
+ */
+inline int gatherHalo(DomainState& state, const std::vector<DomainState>& states,
+                      const std::vector<int>& haloCells, const std::vector<int>& cellOwner)
+{
+    const int ownedCount = static_cast<int>(state.owned.size());
+    int haloCount = 0;
+    for (const int cell : haloCells) {
+        const DomainState& owner = states[cellOwner[cell]];
+        haloCount += owner.cellEnd[cell] - owner.cellBegin[cell];
+    }
+
+    resizeUninitialized(state.local, ownedCount + haloCount);
+    std::copy(state.owned.begin(), state.owned.end(), state.local.begin());
+    int offset = ownedCount;
+    for (const int cell : haloCells) {
+        const DomainState& owner = states[cellOwner[cell]];
+        offset = static_cast<int>(std::copy(owner.owned.begin() + owner.cellBegin[cell],
+                                            owner.owned.begin() + owner.cellEnd[cell],
+                                            state.local.begin() + offset) - state.local.begin());
+    }
+    state.haloBoids += haloCount;
+    return ownedCount;
+}
+
+// Ripartizioni Orb eseguite e loro costo totale (dalla decisione alla fine
+// dello scambio dei boid)
+struct RebalanceStats {
+    int count = 0;
+    double time = 0.0;
+    long long moved = 0;
+};
+
+// Una riga per ripartizione, durante la simulazione
+inline void printRebalanceLog(const int step, const double imbalance, const long long moved, const double cost) {
+    std::cout << "REBALANCE STEP=" << step << " IMBALANCE=" << imbalance
+              << " MOVED_BOIDS=" << moved << " COST_MS=" << 1000.0 * cost << std::endl;
+}
+
+// Riepilogo della decomposizione: alone e migrazioni per passo, boid per dominio
+inline void printDomainReport(const char* name, const std::vector<DomainState>& states,
+                              const bool pinned, const int steps)
+{
+    long long haloBoids = 0, migrations = 0;
+    int minOwned = states.empty() ? 0 : states.front().minOwned;
+    int maxOwned = 0;
+    for (const DomainState& state : states) {
+        haloBoids += state.haloBoids;
+        migrations += state.migrations;
+        minOwned = std::min(minOwned, state.minOwned);
+        maxOwned = std::max(maxOwned, state.maxOwned);
+    }
+    std::cout << "DOMAINS=" << name << " COUNT=" << states.size()
+              << " PINNED=" << (pinned ? "yes" : "no")
+              << " HALO_BOIDS_PER_STEP=" << static_cast<double>(haloBoids) / steps
+              << " MIGRATIONS_PER_STEP=" << static_cast<double>(migrations) / steps
+              << " OWNED_MIN=" << minOwned << " OWNED_MAX=" << maxOwned << std::endl;
+}
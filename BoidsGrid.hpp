@@ -1,30 +1,310 @@
 #pragma once
 
 #include "BoidsCommon.hpp"
+#include "BoidsNuma.hpp"
+#include "BoidsSimd.hpp"
+#include <algorithm>
 #include <cmath>
-#include <functional>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
 #include <vector>
+#include <omp.h>
 
-constexpr float CELL_SIZE = VIEW_RADIUS * 2;
+/**
+ * Stencil della griglia: la dimensione della cella determina quante celle
+ * (Reach per lato) servono per coprire il cerchio di raggio VIEW_RADIUS.
+ * - Wide3x3:   cella = 2 * VIEW_RADIUS, 3x3 (layout storico, 36 R^2 di area)
+ * - Radius3x3: cella = VIEW_RADIUS, 3x3 (9 R^2)
+ * - Half5x5:   cella = VIEW_RADIUS / 2, 5x5 (al più 6.25 R^2); gli angoli
+ *   distano almeno R/sqrt(2) e vengono saltati solo se fuori dal raggio
+ */
+enum class GridStencil { Wide3x3, Radius3x3, Half5x5 };
+
+constexpr GridStencil DEFAULT_STENCIL = GridStencil::Radius3x3;
+
+constexpr float stencilCellSize(const GridStencil stencil) {
+    switch (stencil) {
+        case GridStencil::Wide3x3: return VIEW_RADIUS * 2;
+        case GridStencil::Half5x5: return VIEW_RADIUS / 2;
+        default:                   return VIEW_RADIUS;
+    }
+}
+
+constexpr int stencilReach(const GridStencil stencil) {
+    return stencil == GridStencil::Half5x5 ? 2 : 1;
+}
+
+// Nome da riga di comando ("wide", "3x3", "5x5") -> stencil
+inline bool parseGridStencil(const char* name, GridStencil& stencil) {
+    if (std::strcmp(name, "wide") == 0) stencil = GridStencil::Wide3x3;
+    else if (std::strcmp(name, "3x3") == 0) stencil = GridStencil::Radius3x3;
+    else if (std::strcmp(name, "5x5") == 0) stencil = GridStencil::Half5x5;
+    else return false;
+    return true;
+}
+
+inline const char* stencilName(const GridStencil stencil) {
+    switch (stencil) {
+        case GridStencil::Wide3x3: return "wide";
+        case GridStencil::Half5x5: return "5x5";
+        default:                   return "3x3";
+    }
+}
+
+// Sceglie a runtime la specializzazione <Reach, Periodic> del ciclo di
+// simulazione: simulation riceve due integral_constant con i parametri
+template<typename Simulation>
+inline auto dispatchGridStencil(const GridStencil stencil, const bool periodic, Simulation&& simulation) {
+    if (stencilReach(stencil) == 2) {
+        return periodic ? simulation(std::integral_constant<int, 2>{}, std::true_type{})
+                        : simulation(std::integral_constant<int, 2>{}, std::false_type{});
+    }
+    return periodic ? simulation(std::integral_constant<int, 1>{}, std::true_type{})
+                    : simulation(std::integral_constant<int, 1>{}, std::false_type{});
+}
+
+/**
+ * Ripartizione del loop delle forze tra i thread:
+ * - Static: schedule(static) sugli indici dei boid (default)
+ * - Cost:   un intervallo di boid per thread, in ordine di cella, con lo
+ *           stesso costo stimato (vedi partitionByCost)
+ * - Steal:  GRID_TASKS_PER_THREAD intervalli per thread di costo uguale,
+ *           presi dalla coda dinamica dai thread che si liberano
+ * - Strips: ogni thread possiede una striscia di righe di celle e i boid
+ *           che vi si trovano (vedi BoidsDomains.hpp)
+ * - Orb:    come Strips, ma con domini rettangolari da bisezione ricorsiva
+ *           sul costo stimato, ricalcolati quando lo sbilanciamento misurato
+ *           supera una soglia
+ */
+enum class GridSchedule { Static, Cost, Steal, Strips, Orb };
+
+constexpr int GRID_TASKS_PER_THREAD = 8;
+
+// Orb: sbilanciamento (massimo / media del lavoro dei thread) oltre il quale
+// si ripartisce, misurato su finestre di ORB_CHECK_PERIOD passi
+constexpr double ORB_IMBALANCE_THRESHOLD = 1.2;
+constexpr int ORB_CHECK_PERIOD = 10;
+
+// Nome da riga di comando ("static", "cost", "steal", "strips", "orb") -> ripartizione
+inline bool parseGridSchedule(const char* name, GridSchedule& schedule) {
+    if (std::strcmp(name, "static") == 0) schedule = GridSchedule::Static;
+    else if (std::strcmp(name, "cost") == 0) schedule = GridSchedule::Cost;
+    else if (std::strcmp(name, "steal") == 0) schedule = GridSchedule::Steal;
+    else if (std::strcmp(name, "strips") == 0) schedule = GridSchedule::Strips;
+    else if (std::strcmp(name, "orb") == 0) schedule = GridSchedule::Orb;
+    else return false;
+    return true;
+}
+
+inline const char* gridScheduleName(const GridSchedule schedule) {
+    switch (schedule) {
+        case GridSchedule::Cost:   return "cost";
+        case GridSchedule::Steal:  return "steal";
+        case GridSchedule::Strips: return "strips";
+        case GridSchedule::Orb:    return "orb";
+        default:                   return "static";
+    }
+}
+
+// Argomenti opzionali comuni ai motori a griglia, in qualsiasi ordine dopo
+// il numero di boid: uno stencil (wide, 3x3, 5x5), "periodic", "incremental",
+// la ripartizione ("static", "cost", "steal", "strips", "orb [soglia]",
+// solo dove il motore la supporta), l'ISA, la precisione ("exact", "fast"),
+// "drift [passi]" (deriva di fast rispetto a exact, solo dove il motore la
+// misura) e le pagine dei buffer grandi ("hugetlb", "thp", "smallpages")
+struct GridOptions {
+    GridStencil stencil = DEFAULT_STENCIL;
+    bool periodic = false;
+    bool incremental = false;
+    GridSchedule schedule = GridSchedule::Static;
+    double imbalanceThreshold = ORB_IMBALANCE_THRESHOLD;
+    int driftSteps = 0; // 0: nessun report
+    SimdIsa isa = detectSimdIsa();
+    bool explicitIsa = false; // ISA scelta sulla riga di comando
+    Precision precision = Precision::Exact;
+    PagePolicy pages = activePagePolicy();
+};
+
+// Un'ISA non supportata dalla CPU è un errore come una parola sconosciuta
+inline bool parseGridArgs(const int argc, char* argv[], GridOptions& options) {
+    for (int a = 2; a < argc; ++a) {
+        if (std::strcmp(argv[a], "periodic") == 0) options.periodic = true;
+        else if (std::strcmp(argv[a], "incremental") == 0) options.incremental = true;
+        else if (parseDriftArg(argc, argv, a, options.driftSteps)) continue;
+        else if (parsePrecision(argv[a], options.precision)) continue;
+        else if (parsePagePolicy(argv[a], options.pages)) continue;
+        else if (parseGridSchedule(argv[a], options.schedule)) {
+            // "orb" può essere seguito dalla soglia di sbilanciamento (> 1)
+            if (options.schedule != GridSchedule::Orb || a + 1 >= argc) continue;
+            char* end;
+            if (const double val = std::strtod(argv[a + 1], &end); *end == '\0' && val > 1.0) {
+                options.imbalanceThreshold = val;
+                ++a;
+            }
+        }
+        else if (parseSimdIsa(argv[a], options.isa)) {
+            if (!simdIsaSupported(options.isa)) return false;
+            options.explicitIsa = true;
+        }
+        else if (!parseGridStencil(argv[a], options.stencil)) return false;
+    }
+    // La deriva si misura solo per la precisione approssimata
+    return options.driftSteps == 0 || options.precision == Precision::Fast;
+}
+
+// Riepilogo per confrontare gli stencil a parità di densità
+inline void printStencilReport(const GridStencil stencil,
+                               const bool periodic,
+                               const long long candidates,
+                               const int numBoids,
+                               const int steps,
+                               const double elapsed)
+{
+    const double boidSteps = static_cast<double>(numBoids) * steps;
+    std::cout << "STENCIL=" << stencilName(stencil)
+              << (periodic ? " PERIODIC" : "")
+              << " CELL=" << stencilCellSize(stencil)
+              << " ISA=" << simdIsaName(activeSimdIsa())
+              << " PRECISION=" << precisionName(activePrecision())
+              << " CANDIDATES_PER_BOID=" << static_cast<double>(candidates) / boidSteps
+              << " THROUGHPUT=" << boidSteps / elapsed << " boid-steps/s" << std::endl;
+}
+
+// Cella dello stencil precalcolata per la griglia periodica
+struct StencilNeighbor {
+    int cell;
+    float shiftX, shiftY; // immagine minima: offset da sommare alle posizioni dei boid della cella
+    float rectX, rectY;   // angolo della cella già traslato, per il test sugli angoli del 5x5
+    bool corner;
+};
+
+// Manutenzione incrementale: spazio libero riservato in coda a ogni cella
+// e ricostruzione completa periodica di sicurezza
+constexpr int INCREMENTAL_SLACK_DIVISOR = 4;
+constexpr int INCREMENTAL_MIN_SLACK = 8;
+constexpr int INCREMENTAL_REBUILD_PERIOD = 50;
+
+// Boid che durante l'integrazione è passato in un'altra cella
+struct GridMigration {
+    int boid;
+    int cell;
+};
 
 struct UniformGrid {
     int cellCountX;
     int cellCountY;
+    float cellSize;
+    float cellSizeX, cellSizeY; // uguali a cellSize salvo nella griglia periodica
+    float originX = 0.0f, originY = 0.0f;
+
+    // Griglia periodica: per ogni cella le (2 * reach + 1)^2 celle dello
+    // stencil, già avvolte sul toro, così il loop non ha controlli di bordo
+    bool periodic = false;
+    int stencilSize = 0;
+    std::vector<StencilNeighbor> stencilTable;
+
+    // Layout compresso (CSR): gli indici dei boid sono contigui per cella,
+    // la cella c occupa cellIndices[cellBegin[c] .. cellEnd[c])
+    std::vector<int> cellBegin;
+    std::vector<int> cellEnd;
+    IndexArray cellIndices;
+    IndexArray boidCell; // cella di ogni boid, calcolata nel passo di conteggio
+
+    // Modalità incrementale: la cella c può crescere fino a cellLimit[c]
+    // (cellEnd .. cellLimit è spazio libero) e boidSlot[i] è la posizione
+    // di i in cellIndices, per spostare un boid in O(1)
+    bool incremental = false;
+    std::vector<int> cellLimit;
+    IndexArray boidSlot;
+
+    // Scratch per parallelBuildGrid: un istogramma per thread (threads x celle)
+    // e le somme parziali della prefix sum, allocati una volta sola
+    std::vector<int> threadCounts;
+    std::vector<int> blockSums;
+
+    /**
+     * Con periodic = true la griglia copre il toro [-WRAP_MARGIN, size + WRAP_MARGIN)
+     * su cui si avvolgono i boid: le celle sono larghe almeno cellSize e
+     * dividono esattamente il periodo (quindi non sono per forza quadrate).
+     * Il mondo deve contenere almeno 2 * reach + 1 celle per lato.
+     */
+    UniformGrid(const float width, const float height, const float cellSize,
+                const bool periodic = false, const int reach = 1)
+        : cellSize{cellSize}, cellSizeX{cellSize}, cellSizeY{cellSize}, periodic{periodic}
+    {
+        if (periodic) {
+            const float periodX = width + 2 * WRAP_MARGIN;
+            const float periodY = height + 2 * WRAP_MARGIN;
+            cellCountX = std::max(1, static_cast<int>(std::floor(periodX / cellSize)));
+            cellCountY = std::max(1, static_cast<int>(std::floor(periodY / cellSize)));
+            cellSizeX = periodX / static_cast<float>(cellCountX);
+            cellSizeY = periodY / static_cast<float>(cellCountY);
+            originX = -WRAP_MARGIN;
+            originY = -WRAP_MARGIN;
+            buildStencilTable(reach, periodX, periodY);
+        } else {
+            cellCountX = static_cast<int>(std::ceil(width / cellSize));
+            cellCountY = static_cast<int>(std::ceil(height / cellSize));
+        }
+        cellBegin.resize(cellCountX * cellCountY);
+        cellEnd.resize(cellCountX * cellCountY);
+        cellLimit.resize(cellCountX * cellCountY);
+    }
+
+    void buildStencilTable(const int reach, const float periodX, const float periodY) {
+        const int side = 2 * reach + 1;
+        stencilSize = side * side;
+        stencilTable.resize(static_cast<size_t>(numCells()) * stencilSize);
+
+        for (int cellY = 0; cellY < cellCountY; ++cellY) {
+            for (int cellX = 0; cellX < cellCountX; ++cellX) {
+                StencilNeighbor* entry = &stencilTable[static_cast<size_t>(getCellIndex(cellX, cellY)) * stencilSize];
+                for (int dy = -reach; dy <= reach; ++dy) {
+                    for (int dx = -reach; dx <= reach; ++dx, ++entry) {
+                        int nx = cellX + dx;
+                        int ny = cellY + dy;
+                        float shiftX = 0.0f, shiftY = 0.0f;
+                        if (nx < 0) { nx += cellCountX; shiftX = -periodX; }
+                        else if (nx >= cellCountX) { nx -= cellCountX; shiftX = periodX; }
+                        if (ny < 0) { ny += cellCountY; shiftY = -periodY; }
+                        else if (ny >= cellCountY) { ny -= cellCountY; shiftY = periodY; }
+
+                        entry->cell = getCellIndex(nx, ny);
+                        entry->shiftX = shiftX;
+                        entry->shiftY = shiftY;
+                        entry->rectX = originX + static_cast<float>(nx) * cellSizeX + shiftX;
+                        entry->rectY = originY + static_cast<float>(ny) * cellSizeY + shiftY;
+                        entry->corner = reach == 2 && (dx == -2 || dx == 2) && (dy == -2 || dy == 2);
+                    }
+                }
+            }
+        }
+    }
 
-    std::vector<std::vector<int>> cells;
-    std::vector<int> usedCells; // <-- AGGIUNTO per clear selettivo
+    // Da chiamare fuori dalla regione parallela: dimensiona tutti i buffer
+    // usati da parallelBuildGrid, che così non alloca durante i passi
+    void prepareParallelBuild(const int numBoids, const int maxThreads, const bool incrementalMode = false) {
+        incremental = incrementalMode;
+        // Indici scritti da parallelBuildGrid: le pagine restano al suo first-touch
+        resizeUninitialized(boidCell, numBoids);
+        resizeUninitialized(cellIndices, incremental
+            ? numBoids + numBoids / INCREMENTAL_SLACK_DIVISOR + numCells() * INCREMENTAL_MIN_SLACK
+            : numBoids);
+        if (incremental) resizeUninitialized(boidSlot, numBoids);
+        threadCounts.assign(static_cast<size_t>(maxThreads) * numCells(), 0);
+        blockSums.assign(maxThreads, 0);
+    }
 
-    UniformGrid(const float width, const float height, const float cellSize) {
-        cellCountX = static_cast<int>(std::ceil(width / cellSize));
-        cellCountY = static_cast<int>(std::ceil(height / cellSize));
-        cells.resize(cellCountX * cellCountY);
+    // Posti riservati a una cella con count boid
+    [[nodiscard]] int cellCapacity(const int count) const {
+        return incremental
+            ? count + std::max(INCREMENTAL_MIN_SLACK, count / INCREMENTAL_SLACK_DIVISOR)
+            : count;
     }
 
-    void clear() {
-        for (const int idx : usedCells) {
-            cells[idx].clear();
-        }
-        usedCells.clear();
+    [[nodiscard]] int numCells() const {
+        return cellCountX * cellCountY;
     }
 
     [[nodiscard]] int getCellIndex(const int cellX, const int cellY) const {
@@ -32,9 +312,19 @@ struct UniformGrid {
     }
 };
 
-inline std::pair<int, int> getCellCoords(const Vector2& pos, const float cellSize, const int maxX, const int maxY) {
-    int cellX = static_cast<int>(std::floor(pos.x / cellSize));
-    int cellY = static_cast<int>(std::floor(pos.y / cellSize));
+// Preferenza NUMA degli array per boid della griglia, dopo
+// prepareParallelBuild; gli array per cella sono piccoli
+inline void bindToOwnerNodes(const UniformGrid& grid) {
+    bindToOwnerNodes(grid.boidCell);
+    bindToOwnerNodes(grid.cellIndices);
+    bindToOwnerNodes(grid.boidSlot);
+}
+
+inline std::pair<int, int> getCellCoords(const Vector2& pos, const UniformGrid& grid) {
+    const int maxX = grid.cellCountX;
+    const int maxY = grid.cellCountY;
+    int cellX = static_cast<int>(std::floor((pos.x - grid.originX) / grid.cellSizeX));
+    int cellY = static_cast<int>(std::floor((pos.y - grid.originY) / grid.cellSizeY));
 
     if (cellX < 0) cellX = 0;
     if (cellX >= maxX) cellX = maxX - 1;
@@ -44,184 +334,472 @@ inline std::pair<int, int> getCellCoords(const Vector2& pos, const float cellSiz
     return {cellX, cellY};
 }
 
-inline void buildGrid(const std::vector<Boid>& oldState,
-                      UniformGrid& grid,
-                      const float cellSize)
+/**
+ * Counting sort degli indici per cella, a partire da grid.boidCell:
+ * 1) conteggio (cellEnd fa da istogramma)
+ * 2) prefix sum esclusiva -> cellBegin
+ * 3) scatter: cellEnd avanza fino a diventare la fine della cella
+ * Nessuna allocazione a regime: i vettori vengono solo ridimensionati.
+ */
+inline void fillCellsFromBoidCells(UniformGrid& grid)
 {
-    grid.clear();
+    const int N = static_cast<int>(grid.boidCell.size());
+    const int numCells = grid.numCells();
+    grid.cellIndices.resize(N);
 
-    for (int i = 0; i < static_cast<int>(oldState.size()); ++i) {
-        auto [cellX, cellY] = getCellCoords(oldState[i].position, cellSize,
-            grid.cellCountX, grid.cellCountY);
-        const int cellIndex = grid.getCellIndex(cellX, cellY);
-        grid.cells[cellIndex].push_back(i);
-        grid.usedCells.push_back(cellIndex);
+    std::fill(grid.cellEnd.begin(), grid.cellEnd.end(), 0);
+    for (int i = 0; i < N; ++i) {
+        grid.cellEnd[grid.boidCell[i]]++;
+    }
+
+    int offset = 0;
+    for (int c = 0; c < numCells; ++c) {
+        grid.cellBegin[c] = offset;
+        offset += grid.cellEnd[c];
+        grid.cellEnd[c] = grid.cellBegin[c];
     }
+
+    for (int i = 0; i < N; ++i) {
+        grid.cellIndices[grid.cellEnd[grid.boidCell[i]]++] = i;
+    }
+    std::copy(grid.cellEnd.begin(), grid.cellEnd.end(), grid.cellLimit.begin());
 }
 
-inline void forEachNeighborBoid(
-    const int cellX, const int cellY,
-    const UniformGrid& grid,
-    const std::function<void(int otherIndex)>& callback)
+inline void buildGrid(const BoidArray& oldState,
+                      UniformGrid& grid)
 {
-    for (int dx = -1; dx <= 1; dx++) {
-        for (int dy = -1; dy <= 1; dy++) {
-            const int nx = cellX + dx;
-            const int ny = cellY + dy;
-
-            if (nx < 0 || nx >= grid.cellCountX) continue;
-            if (ny < 0 || ny >= grid.cellCountY) continue;
+    const int N = static_cast<int>(oldState.size());
+    grid.boidCell.resize(N);
 
-            for (const int neighborCellIndex = grid.getCellIndex(nx, ny);
-                const int otherIdx : grid.cells[neighborCellIndex]) {
-                callback(otherIdx);
-            }
-        }
+    for (int i = 0; i < N; ++i) {
+        auto [cellX, cellY] = getCellCoords(oldState[i].position, grid);
+        grid.boidCell[i] = grid.getCellIndex(cellX, cellY);
     }
+
+    fillCellsFromBoidCells(grid);
 }
 
 /**
- * Esempio di "separation" usando la griglia:
- * - sai in quale cella (cellX, cellY) si trova il boid 'b'
- * - scorri solo la cella e quelle adiacenti
+ * Versione parallela di buildGrid, da chiamare da TUTTI i thread di una
+ * regione parallela già aperta (usa solo costrutti orfani di work-sharing,
+ * niente parallelismo annidato). Richiede grid.prepareParallelBuild().
+ * 1) ogni thread conta i propri boid in un istogramma privato
+ * 2) per ogni cella, prefix sum sui thread -> offset del thread nella cella
+ * 3) prefix sum sulle celle a blocchi (un blocco per thread)
+ * 4) scatter: ogni thread rivisita gli stessi boid (schedule static) e li
+ *    scrive nella propria porzione di cella, l'ordine resta quello sequenziale
+ * positionOf(i) restituisce la posizione del boid i, così la stessa
+ * costruzione serve lo stato AoS e quello SoA.
  */
-
-inline Vector2 separationGrid(const Boid& b,
-                              const int boidIndex,
-                              const std::vector<Boid>& current,
-                              const UniformGrid& grid,
-                              const int cellX, const int cellY)
+template<typename PositionOf>
+inline void parallelBuildGridFrom(const int N,
+                                  PositionOf&& positionOf,
+                                  UniformGrid& grid)
 {
-    Vector2 steer{0, 0};
-    int count = 0;
-
-    forEachNeighborBoid(cellX, cellY, grid, [&](const int otherIdx){
-        if (otherIdx == boidIndex) return;
-        const auto&[position, velocity] = current[otherIdx];
-        if (const float dist = (b.position - position).magnitude();
-            dist < SEPARATION_RADIUS) {
-            Vector2 diff = (b.position - position).normalized();
-            diff = diff / (dist * dist);
-            steer = steer + diff;
-            count++;
+    const int numCells = grid.numCells();
+    const int threadId = omp_get_thread_num();
+    const int numThreads = omp_get_num_threads();
+    int* localCounts = grid.threadCounts.data() + static_cast<size_t>(threadId) * numCells;
+
+    std::fill(localCounts, localCounts + numCells, 0);
+
+    #pragma omp for schedule(static)
+    for (int i = 0; i < N; ++i) {
+        auto [cellX, cellY] = getCellCoords(positionOf(i), grid);
+        const int cellIndex = grid.getCellIndex(cellX, cellY);
+        grid.boidCell[i] = cellIndex;
+        localCounts[cellIndex]++;
+    }
+
+    // Offset di ogni thread dentro la cella; cellEnd tiene il totale della cella
+    #pragma omp for schedule(static)
+    for (int c = 0; c < numCells; ++c) {
+        int running = 0;
+        for (int t = 0; t < numThreads; ++t) {
+            int& count = grid.threadCounts[static_cast<size_t>(t) * numCells + c];
+            const int value = count;
+            count = running;
+            running += value;
         }
-    });
+        grid.cellEnd[c] = running;
+    }
 
-    if (count > 0) {
-        steer = steer / static_cast<float>(count);
-        steer = steer.normalized() * MAX_SPEED;
-        steer = steer - b.velocity;
-        steer.limit(MAX_FORCE);
+    // Prefix sum sulle celle: ogni thread somma il proprio blocco...
+    const int blockSize = (numCells + numThreads - 1) / numThreads;
+    const int blockBegin = std::min(numCells, threadId * blockSize);
+    const int blockEnd = std::min(numCells, blockBegin + blockSize);
+
+    int blockSum = 0;
+    for (int c = blockBegin; c < blockEnd; ++c) blockSum += grid.cellCapacity(grid.cellEnd[c]);
+    grid.blockSums[threadId] = blockSum;
+
+    #pragma omp barrier
+
+    // ...e poi lo scandisce partendo dalla somma dei blocchi precedenti
+    int offset = 0;
+    for (int t = 0; t < threadId; ++t) offset += grid.blockSums[t];
+    for (int c = blockBegin; c < blockEnd; ++c) {
+        const int count = grid.cellEnd[c];
+        grid.cellBegin[c] = offset;
+        grid.cellEnd[c] = offset + count;
+        offset += grid.cellCapacity(count);
+        grid.cellLimit[c] = offset;
     }
-    return steer;
+
+    #pragma omp barrier
+
+    #pragma omp for schedule(static)
+    for (int i = 0; i < N; ++i) {
+        const int cellIndex = grid.boidCell[i];
+        const int slot = grid.cellBegin[cellIndex] + localCounts[cellIndex]++;
+        grid.cellIndices[slot] = i;
+        if (grid.incremental) grid.boidSlot[i] = slot;
+    }
+}
+
+inline void parallelBuildGrid(const BoidArray& oldState,
+                              UniformGrid& grid)
+{
+    parallelBuildGridFrom(static_cast<int>(oldState.size()),
+                          [&oldState](const int i) -> const Vector2& { return oldState[i].position; }, grid);
 }
 
 /**
- * Alignment usando la griglia
+ * Applica le migrazioni raccolte dai thread durante l'integrazione:
+ * il boid esce dalla vecchia cella (l'ultimo della cella prende il suo
+ * posto) ed entra nello spazio libero della nuova. Restituisce false se
+ * una cella ha esaurito lo spazio riservato: la griglia è allora
+ * incoerente e va ricostruita per intero prima del prossimo uso.
  */
-inline Vector2 alignmentGrid(const Boid& b,
-                             const int boidIndex,
-                             const std::vector<Boid>& current,
-                             const UniformGrid& grid,
-                             const int cellX, const int cellY)
+inline bool applyGridMigrations(UniformGrid& grid,
+                                const std::vector<std::vector<GridMigration>>& migrations)
 {
-    Vector2 sum{0, 0};
-    int count = 0;
-
-    forEachNeighborBoid(cellX, cellY, grid, [&](const int otherIdx){
-        if (otherIdx == boidIndex) return;
-        const auto&[position, velocity] = current[otherIdx];
-        if (const float dist = (b.position - position).magnitude(); dist < VIEW_RADIUS) {
-            const float weight = (VIEW_RADIUS - dist) / VIEW_RADIUS;
-            sum = sum + velocity * weight;
-            count++;
+    for (const auto& threadMigrations : migrations) {
+        for (const auto& [boid, cell] : threadMigrations) {
+            const int oldCell = grid.boidCell[boid];
+            const int slot = grid.boidSlot[boid];
+            const int last = --grid.cellEnd[oldCell];
+            const int moved = grid.cellIndices[last];
+            grid.cellIndices[slot] = moved;
+            grid.boidSlot[moved] = slot;
+
+            if (grid.cellEnd[cell] == grid.cellLimit[cell]) return false;
+            const int newSlot = grid.cellEnd[cell]++;
+            grid.cellIndices[newSlot] = boid;
+            grid.boidSlot[boid] = newSlot;
+            grid.boidCell[boid] = cell;
         }
-    });
+    }
+    return true;
+}
 
-    if (count > 0) {
-        sum = sum / static_cast<float>(count);
-        sum = sum.normalized() * MAX_SPEED;
-        Vector2 steer = sum - b.velocity;
-        steer.limit(MAX_FORCE);
-        return steer;
+// Boid nelle celle entro Reach celle da (cellX, cellY), cella compresa;
+// countOf(cell) dà i boid di una cella (di default quelli della griglia)
+template<int Reach, typename CountOf>
+inline int neighborhoodOccupancy(const UniformGrid& grid, const int cellX, const int cellY, CountOf&& countOf) {
+    int occupancy = 0;
+    if (grid.periodic) {
+        const StencilNeighbor* entry = grid.stencilTable.data()
+            + static_cast<size_t>(grid.getCellIndex(cellX, cellY)) * grid.stencilSize;
+        for (int s = 0; s < grid.stencilSize; ++s, ++entry) occupancy += countOf(entry->cell);
+        return occupancy;
     }
-    return Vector2{0, 0};
+    for (int ny = std::max(0, cellY - Reach); ny <= std::min(grid.cellCountY - 1, cellY + Reach); ++ny) {
+        for (int nx = std::max(0, cellX - Reach); nx <= std::min(grid.cellCountX - 1, cellX + Reach); ++nx) {
+            occupancy += countOf(grid.getCellIndex(nx, ny));
+        }
+    }
+    return occupancy;
 }
 
+template<int Reach>
+inline int neighborhoodOccupancy(const UniformGrid& grid, const int cellX, const int cellY) {
+    return neighborhoodOccupancy<Reach>(grid, cellX, cellY,
+        [&grid](const int cell) { return grid.cellEnd[cell] - grid.cellBegin[cell]; });
+}
+
+// Taglio nella sequenza dei boid in ordine di cella: i primi offset boid
+// della cella stanno prima del taglio
+struct GridSplit {
+    int cell;
+    int offset;
+};
+
+// Parti di costo stimato uguale: la parte p va da splits[p] a splits[p + 1]
+struct GridCostPartition {
+    std::vector<int> neighborhood;   // occupazione dello stencil di ogni cella
+    std::vector<long long> cumulative; // costo delle celle fino a quella compresa
+    std::vector<GridSplit> splits;
+    int parts = 0;
+};
+
 /**
- * Cohesion usando la griglia
+ * Divide i boid, in ordine di cella, in parts intervalli di costo stimato
+ * uguale. Il costo di un boid è l'occupazione dello stencil della sua cella
+ * nella griglia attuale (i candidati che visiterà), quindi una cella costa
+ * occupazione x occupazione del vicinato; una cella densa può essere divisa
+ * tra più parti. Lavoro seriale O(celle x stencil + parti).
  */
-inline Vector2 cohesionGrid(const Boid& b,
-                            const int boidIndex,
-                            const std::vector<Boid>& current,
-                            const UniformGrid& grid,
-                            const int cellX, const int cellY)
-{
-    Vector2 center{0, 0};
-    int count = 0;
-
-    forEachNeighborBoid(cellX, cellY, grid, [&](const int otherIdx){
-        if (otherIdx == boidIndex) return;
-        const auto&[position, velocity] = current[otherIdx];
-        if (const float dist = (b.position - position).magnitude(); dist < VIEW_RADIUS) {
-            center = center + position;
-            count++;
+template<int Reach>
+inline void partitionByCost(const UniformGrid& grid, const int parts, GridCostPartition& partition) {
+    const int numCells = grid.numCells();
+    partition.neighborhood.resize(numCells);
+    partition.cumulative.resize(numCells);
+    partition.splits.resize(parts + 1);
+    partition.parts = parts;
+
+    long long total = 0;
+    for (int cellY = 0; cellY < grid.cellCountY; ++cellY) {
+        for (int cellX = 0; cellX < grid.cellCountX; ++cellX) {
+            const int cell = grid.getCellIndex(cellX, cellY);
+            const int occupancy = neighborhoodOccupancy<Reach>(grid, cellX, cellY);
+            partition.neighborhood[cell] = occupancy;
+            total += static_cast<long long>(grid.cellEnd[cell] - grid.cellBegin[cell]) * occupancy;
+            partition.cumulative[cell] = total;
         }
-    });
+    }
 
-    if (count > 0) {
-        center = center / static_cast<float>(count);
-        const Vector2 desired = (center - b.position).normalized() * MAX_SPEED;
-        Vector2 steer = desired - b.velocity;
-        steer.limit(MAX_FORCE);
-        return steer;
+    // Taglio p: primo boid il cui costo cumulato supera total * p / parts
+    int cell = 0;
+    for (int p = 0; p <= parts; ++p) {
+        const long long target = total * p / parts;
+        while (cell < numCells && partition.cumulative[cell] <= target) ++cell;
+        if (cell == numCells) {
+            partition.splits[p] = {numCells, 0};
+            continue;
+        }
+        const long long before = cell > 0 ? partition.cumulative[cell - 1] : 0;
+        const long long perBoid = partition.neighborhood[cell];
+        partition.splits[p] = {cell, static_cast<int>((target - before + perBoid - 1) / perBoid)};
+    }
+}
+
+// Visita i boid (indici nello stato) della parte part, in ordine di cella
+template<typename Callback>
+inline void forEachBoidInPart(const UniformGrid& grid, const GridCostPartition& partition,
+                              const int part, Callback&& callback)
+{
+    const GridSplit first = partition.splits[part];
+    const GridSplit last = partition.splits[part + 1];
+    for (int cell = first.cell; cell <= last.cell && cell < grid.numCells(); ++cell) {
+        const int begin = grid.cellBegin[cell] + (cell == first.cell ? first.offset : 0);
+        const int end = cell == last.cell ? grid.cellBegin[cell] + last.offset : grid.cellEnd[cell];
+        for (int k = begin; k < end; ++k) callback(grid.cellIndices[k]);
+    }
+}
+
+// Tempi per thread del loop delle forze: lavoro e attesa alla barriera di fine passo
+struct ThreadBalanceStats {
+    std::vector<double> busy;
+    std::vector<double> idle;
+
+    explicit ThreadBalanceStats(const int threads) : busy(threads, 0.0), idle(threads, 0.0) {}
+};
+
+// Millisecondi per passo di ogni thread e sbilanciamento (massimo / media del lavoro)
+inline void printBalanceReport(const GridSchedule schedule, const ThreadBalanceStats& stats, const int steps) {
+    const auto printTimes = [steps](const char* label, const std::vector<double>& times) {
+        std::cout << " " << label << "=";
+        for (size_t t = 0; t < times.size(); ++t) std::cout << (t > 0 ? "," : "") << 1000.0 * times[t] / steps;
+    };
+    double maxBusy = 0.0, sumBusy = 0.0;
+    for (const double busy : stats.busy) {
+        maxBusy = std::max(maxBusy, busy);
+        sumBusy += busy;
+    }
+    const double meanBusy = sumBusy / static_cast<double>(stats.busy.size());
+
+    std::cout << "SCHEDULE=" << gridScheduleName(schedule) << " THREADS=" << stats.busy.size();
+    printTimes("BUSY_MS", stats.busy);
+    printTimes("IDLE_MS", stats.idle);
+    std::cout << " IMBALANCE=" << (meanBusy > 0.0 ? maxBusy / meanBusy : 1.0) << std::endl;
+}
+
+// Vero se il rettangolo di una cella con angolo (x0, y0) ha punti entro VIEW_RADIUS da position
+inline bool cellWithinViewRadius(const Vector2& position, const float x0, const float y0,
+                                 const UniformGrid& grid)
+{
+    const float dx = std::max({x0 - position.x, 0.0f, position.x - (x0 + grid.cellSizeX)});
+    const float dy = std::max({y0 - position.y, 0.0f, position.y - (y0 + grid.cellSizeY)});
+    return dx * dx + dy * dy < VIEW_RADIUS * VIEW_RADIUS;
+}
+
+// Visita i boid di una cella passando l'indice del boid e l'offset di immagine minima
+template<bool SortedState, typename Callback>
+inline void forEachBoidInCell(const UniformGrid& grid, const int cell,
+                              const Vector2& shift, Callback&& callback)
+{
+    const int end = grid.cellEnd[cell];
+    for (int k = grid.cellBegin[cell]; k < end; ++k) {
+        if constexpr (SortedState) {
+            callback(k, shift);
+        } else {
+            callback(grid.cellIndices[k], shift);
+        }
     }
-    return Vector2{0, 0};
 }
 
 /**
- * computeNextBoidGrid:
- * Calcola la nuova posizione/velocità di boid "i" usando la GRIGLIA.
+ * Visita le celle entro Reach celle da (cellX, cellY), cioè lo stencil
+ * (2 * Reach + 1)^2: Reach è un parametro template, così i loop sullo
+ * stencil vengono specializzati e srotolati dal compilatore.
+ * Il callback riceve la cella e lo shift da sommare alle posizioni dei suoi
+ * boid. Con Periodic = true le celle vengono dalla tabella precalcolata
+ * della griglia periodica: nessun controllo di bordo, e lo shift porta il
+ * vicino nella sua immagine minima sul toro; altrimenti lo shift è nullo.
  */
-inline void computeNextBoidGrid(const int i,
-                                const std::vector<Boid>& oldState,
-                                std::vector<Boid>& newState,
-                                const UniformGrid& grid,
-                                const float cellSize)
+template<int Reach = 1, bool Periodic = false, typename CellCallback>
+inline void forEachStencilCell(
+    const Vector2& position,
+    const int cellX, const int cellY,
+    const UniformGrid& grid,
+    CellCallback&& callback)
 {
-    const Boid& b = oldState[i];
+    constexpr int StencilSize = (2 * Reach + 1) * (2 * Reach + 1);
 
-    auto [cellX, cellY] = getCellCoords(b.position, cellSize, grid.cellCountX, grid.cellCountY);
+    if constexpr (Periodic) {
+        BOIDS_DEBUG_ASSERT(grid.periodic && grid.stencilSize == StencilSize);
+        const StencilNeighbor* entry = grid.stencilTable.data()
+            + static_cast<size_t>(grid.getCellIndex(cellX, cellY)) * StencilSize;
 
-    // Calcolo forze (usando le versioni "Grid"!)
-    const Vector2 sep = separationGrid(b, i, oldState, grid, cellX, cellY) * SEPARATION_WEIGHT;
-    const Vector2 ali = alignmentGrid(b, i, oldState, grid, cellX, cellY)   * ALIGNMENT_WEIGHT;
-    const Vector2 coh = cohesionGrid(b, i, oldState, grid, cellX, cellY)    * COHESION_WEIGHT;
+        for (int s = 0; s < StencilSize; ++s, ++entry) {
+            if constexpr (Reach == 2) {
+                if (entry->corner && !cellWithinViewRadius(position, entry->rectX, entry->rectY, grid)) continue;
+            }
+            callback(entry->cell, Vector2{entry->shiftX, entry->shiftY});
+        }
+    } else {
+        const Vector2 noShift{0.0f, 0.0f};
 
-    // Somma delle forze = accelerazione
-    Vector2 acceleration = sep + ali + coh;
-    acceleration.limit(MAX_FORCE);
+        // Righe esterne, colonne interne: le celle di una riga sono adiacenti
+        // in cellIndices, quindi la scansione procede in memoria contigua
+        for (int dy = -Reach; dy <= Reach; dy++) {
+            const int ny = cellY + dy;
+            if (ny < 0 || ny >= grid.cellCountY) continue;
 
-    // Nuova velocità
-    Vector2 newVelocity = b.velocity + acceleration;
-    newVelocity.limit(MAX_SPEED);
+            for (int dx = -Reach; dx <= Reach; dx++) {
+                const int nx = cellX + dx;
+                if (nx < 0 || nx >= grid.cellCountX) continue;
 
-    // Nuova posizione
-    Vector2 newPosition = b.position + newVelocity;
+                if constexpr (Reach == 2) {
+                    if ((dx == -2 || dx == 2) && (dy == -2 || dy == 2) &&
+                        !cellWithinViewRadius(position,
+                            grid.originX + static_cast<float>(nx) * grid.cellSizeX,
+                            grid.originY + static_cast<float>(ny) * grid.cellSizeY, grid)) continue;
+                }
 
-    // Wrap-around
-    constexpr float margin = 5.0f;
-    if (newPosition.x < -margin)       newPosition.x = WIDTH + margin;
-    else if (newPosition.x > WIDTH + margin)   newPosition.x = -margin;
-    if (newPosition.y < -margin)       newPosition.y = HEIGHT + margin;
-    else if (newPosition.y > HEIGHT + margin)  newPosition.y = -margin;
+                callback(grid.getCellIndex(nx, ny), noShift);
+            }
+        }
+    }
+}
 
-    // Salvo nello stato "futuro"
-    newState[i].position = newPosition;
-    newState[i].velocity = newVelocity;
+/**
+ * Visita i boid delle celle dello stencil (vedi forEachStencilCell); il
+ * callback riceve l'indice del boid e lo shift di immagine minima.
+ * Con SortedState = true lo stato è stato riordinato per cella (vedi
+ * boids_parallel_grid_sorted.cpp): la posizione k in cellIndices coincide
+ * con l'indice del boid, quindi si legge lo stato in modo contiguo senza
+ * passare dall'indirezione.
+ */
+template<int Reach = 1, bool SortedState = false, bool Periodic = false, typename Callback>
+inline void forEachNeighborBoid(
+    const Vector2& position,
+    const int cellX, const int cellY,
+    const UniformGrid& grid,
+    Callback&& callback)
+{
+    forEachStencilCell<Reach, Periodic>(position, cellX, cellY, grid,
+        [&](const int cell, const Vector2& shift) {
+            forEachBoidInCell<SortedState>(grid, cell, shift, callback);
+        });
 }
 
+/**
+ * Somme delle regole per il boid i con le regole SIMD (vedi BoidsSimd.hpp):
+ * i boid di ogni cella dello stencil vengono caricati W alla volta nelle
+ * corsie, con lo shift della cella. Restituisce i candidati visitati.
+ */
+template<int W, int Reach, bool SortedState, bool Periodic, bool Fast>
+[[gnu::always_inline]] inline int accumulateGridSimd(const int i,
+                                                     const BoidArray& oldState,
+                                                     const UniformGrid& grid,
+                                                     FlockSums& sums)
+{
+    const Boid& b = oldState[i];
+    auto [cellX, cellY] = getCellCoords(b.position, grid);
+
+    FlockSumsSimd<W> acc;
+    int candidates = 0;
+    // Lambda always_inline: flatten non le espande, e compilate fuori dal
+    // target del chiamante userebbero vettori emulati
+    forEachStencilCell<Reach, Periodic>(b.position, cellX, cellY, grid, [&](const int cell, const Vector2& shift) __attribute__((always_inline)) {
+        const int end = grid.cellEnd[cell];
+        for (int k = grid.cellBegin[cell]; k < end; k += W) {
+            accumulateBoidsSimd<W, Fast>(acc, b.position, i, oldState, std::min(W, end - k), [&](const int lane) __attribute__((always_inline)) {
+                if constexpr (SortedState) return k + lane;
+                else return grid.cellIndices[k + lane];
+            }, shift);
+        }
+        candidates += end - grid.cellBegin[cell];
+    });
+    acc.reduceInto(sums);
+    return candidates;
+}
 
+/**
+ * Separazione, allineamento e coesione del boid i in un'unica visita della
+ * griglia, con il kernel dell'ISA attiva ("scalar" resta il riferimento).
+ * Restituisce il numero di candidati visitati nello stencil.
+ */
+template<int Reach, bool SortedState, bool Periodic, bool Fast>
+inline int accumulateGridSums(const int i,
+                              const BoidArray& oldState,
+                              const UniformGrid& grid,
+                              FlockSums& sums)
+{
+    switch (activeSimdIsa()) {
+        case SimdIsa::Avx512:
+            return SimdTargets<accumulateGridSimd<16, Reach, SortedState, Periodic, Fast>>::avx512(i, oldState, grid, sums);
+        case SimdIsa::Avx2:
+            return SimdTargets<accumulateGridSimd<8, Reach, SortedState, Periodic, Fast>>::avx2(i, oldState, grid, sums);
+        case SimdIsa::Sse:
+            return SimdTargets<accumulateGridSimd<4, Reach, SortedState, Periodic, Fast>>::generic(i, oldState, grid, sums);
+        default: {
+            const Boid& b = oldState[i];
+            auto [cellX, cellY] = getCellCoords(b.position, grid);
+            int candidates = 0;
+            forEachNeighborBoid<Reach, SortedState, Periodic>(b.position, cellX, cellY, grid,
+                [&](const int otherIdx, const Vector2& shift){
+                    candidates++;
+                    if (otherIdx == i) return;
+                    const auto&[position, velocity] = oldState[otherIdx];
+                    accumulateNeighbor<Fast>(sums, b.position, Periodic ? position + shift : position, velocity);
+                });
+            return candidates;
+        }
+    }
+}
 
+/**
+ * computeNextBoidGrid:
+ * Calcola la nuova posizione/velocità di boid "i" usando la GRIGLIA.
+ * Restituisce il numero di candidati visitati nello stencil.
+ * Le somme usano il kernel dell'ISA attiva; Fast è la precisione (vedi
+ * Precision), scelta una volta fuori dal ciclo con dispatchPrecision.
+ */
+template<int Reach = 1, bool SortedState = false, bool Periodic = false, bool Fast = false>
+inline int computeNextBoidGrid(const int i,
+                               const BoidArray& oldState,
+                               BoidArray& newState,
+                               const UniformGrid& grid)
+{
+    const Boid& b = oldState[i];
 
+    FlockSums sums;
+    const int candidates = accumulateGridSums<Reach, SortedState, Periodic, Fast>(i, oldState, grid, sums);
 
+    // Salvo nello stato "futuro"
+    integrateBoid<Fast>(b, flockAcceleration<Fast>(sums, b), newState[i]);
+    return candidates;
+}
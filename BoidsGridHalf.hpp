@@ -0,0 +1,217 @@
+//BoidsGridHalf.hpp
+#pragma once
+
+#include "BoidsGrid.hpp"
+#include <algorithm>
+#include <vector>
+
+/**
+ * Valutazione simmetrica delle coppie sulla griglia: la relazione "entro
+ * VIEW_RADIUS" è simmetrica, quindi ogni coppia viene valutata una volta
+ * sola e i contributi vanno a entrambi i boid (vedi accumulatePair).
+ * Per ogni cella si visitano le coppie interne (j dopo i) e le celle della
+ * metà "in avanti" dello stencil: dy > 0, oppure dy == 0 e dx > 0.
+ *
+ * Ogni thread possiede una fascia di righe di celle (bilanciata sui boid,
+ * vedi assignHalfPairBand) e ne visita le coppie. La metà in avanti scrive
+ * solo nelle Reach righe dopo la fascia, quindi gli accumulatori privati
+ * coprono la fascia più quell'alone, indicizzati per slot di cellIndices:
+ * la memoria è N più T alone invece di T x N. Nella riduzione il
+ * proprietario somma ai propri solo gli aloni dei thread che lo coprono.
+ */
+struct alignas(64) HalfPairBand {
+    int rowBegin = 0, rowEnd = 0;   // righe di celle possedute
+    int slotBegin = 0, slotEnd = 0; // i loro slot in cellIndices
+    int span = 0;                   // slot scritti: [slotBegin, slotBegin + span) modulo slotCount
+    int slotCount = 0;
+    std::vector<FlockSums> sums;    // uno per slot scritto: allocati e azzerati dal thread
+    std::vector<int> contributors;  // thread il cui alone cade nella fascia
+
+    [[nodiscard]] int offset(const int slot) const {
+        const int local = slot - slotBegin;
+        return local < 0 ? local + slotCount : local;
+    }
+    [[nodiscard]] bool covers(const int slot) const { return offset(slot) < span; }
+};
+
+struct HalfPairAccumulators {
+    std::vector<HalfPairBand> bands; // una per thread
+
+    explicit HalfPairAccumulators(const int maxThreads) : bands(maxThreads) {}
+};
+
+// Primo slot della riga di celle row (numBoids oltre l'ultima)
+inline int rowFirstSlot(const UniformGrid& grid, const int row, const int numBoids) {
+    return row < grid.cellCountY ? grid.cellBegin[static_cast<size_t>(row) * grid.cellCountX] : numBoids;
+}
+
+// Prima riga della fascia k di numThreads: circa k * N / T boid prima di lei
+inline int bandFirstRow(const UniformGrid& grid, const int k, const int numThreads, const int numBoids) {
+    if (k >= numThreads) return grid.cellCountY;
+    const int target = static_cast<int>(static_cast<long long>(numBoids) * k / numThreads);
+    int low = 0, high = grid.cellCountY;
+    while (low < high) {
+        const int mid = (low + high) / 2;
+        if (rowFirstSlot(grid, mid, numBoids) < target) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+/**
+ * Fascia del thread sulla griglia appena costruita: righe, slot posseduti,
+ * alone (le Reach righe successive, avvolte sul toro se Periodic) e
+ * accumulatori azzerati. Va chiamata da ogni thread per la propria fascia;
+ * contributors richiede le fasce di tutti (dopo una barriera).
+ */
+template<int Reach = 1, bool Periodic = false>
+inline void assignHalfPairBand(const UniformGrid& grid, const int numBoids,
+                               const int thread, const int numThreads,
+                               HalfPairBand& band)
+{
+    band.rowBegin = bandFirstRow(grid, thread, numThreads, numBoids);
+    band.rowEnd = bandFirstRow(grid, thread + 1, numThreads, numBoids);
+    band.slotBegin = rowFirstSlot(grid, band.rowBegin, numBoids);
+    band.slotEnd = rowFirstSlot(grid, band.rowEnd, numBoids);
+    band.slotCount = numBoids;
+
+    int haloEnd;
+    if (band.rowBegin == band.rowEnd) {
+        haloEnd = band.slotBegin;
+    } else if (Periodic && band.rowEnd + Reach > grid.cellCountY) {
+        haloEnd = rowFirstSlot(grid, band.rowEnd + Reach - grid.cellCountY, numBoids) + numBoids;
+    } else {
+        haloEnd = rowFirstSlot(grid, std::min(band.rowEnd + Reach, grid.cellCountY), numBoids);
+    }
+    band.span = std::min(haloEnd - band.slotBegin, numBoids);
+    band.sums.assign(band.span, FlockSums{});
+}
+
+// Thread (diversi da thread) il cui alone copre almeno uno slot della fascia
+inline void collectHalfPairContributors(HalfPairAccumulators& accumulators, const int thread, const int numThreads) {
+    HalfPairBand& band = accumulators.bands[thread];
+    band.contributors.clear();
+    if (band.slotBegin == band.slotEnd) return;
+    for (int u = 0; u < numThreads; ++u) {
+        const HalfPairBand& other = accumulators.bands[u];
+        if (u == thread || other.span == 0) continue;
+        if (other.covers(band.slotBegin) || band.offset(other.slotBegin) < band.slotEnd - band.slotBegin) {
+            band.contributors.push_back(u);
+        }
+    }
+}
+
+/**
+ * Visita la metà in avanti dello stencil di (cellX, cellY), centro escluso.
+ * Nella tabella periodica le celle sono ordinate per riga a partire da
+ * dy = -Reach, quindi la metà in avanti sono le voci dopo il centro.
+ * Gli angoli del 5x5 non si possono scartare per cella (distano R/sqrt(2)
+ * dal bordo della cella centrale) e vengono visitati: decide la distanza.
+ */
+template<int Reach = 1, bool Periodic = false, typename CellCallback>
+inline void forEachHalfStencilCell(const int cellX, const int cellY,
+                                   const UniformGrid& grid,
+                                   CellCallback&& callback)
+{
+    constexpr int StencilSize = (2 * Reach + 1) * (2 * Reach + 1);
+
+    if constexpr (Periodic) {
+        BOIDS_DEBUG_ASSERT(grid.periodic && grid.stencilSize == StencilSize);
+        const StencilNeighbor* entry = grid.stencilTable.data()
+            + static_cast<size_t>(grid.getCellIndex(cellX, cellY)) * StencilSize;
+
+        for (int s = StencilSize / 2 + 1; s < StencilSize; ++s) {
+            callback(entry[s].cell, Vector2{entry[s].shiftX, entry[s].shiftY});
+        }
+    } else {
+        const Vector2 noShift{0.0f, 0.0f};
+
+        for (int dy = 0; dy <= Reach; dy++) {
+            const int ny = cellY + dy;
+            if (ny >= grid.cellCountY) break;
+
+            for (int dx = dy == 0 ? 1 : -Reach; dx <= Reach; dx++) {
+                const int nx = cellX + dx;
+                if (nx < 0 || nx >= grid.cellCountX) continue;
+                callback(grid.getCellIndex(nx, ny), noShift);
+            }
+        }
+    }
+}
+
+/**
+ * Accumula negli accumulatori della fascia (che contiene cell) tutte le
+ * coppie che hanno il primo boid nella cella cell. Una cella non attraversa
+ * mai l'avvolgimento degli slot, quindi i suoi accumulatori sono contigui.
+ * Restituisce il numero di coppie valutate.
+ */
+template<int Reach = 1, bool Periodic = false, bool Fast = false>
+inline long long accumulateCellPairs(const int cell,
+                                     const BoidArray& state,
+                                     const UniformGrid& grid,
+                                     HalfPairBand& band)
+{
+    const int begin = grid.cellBegin[cell];
+    const int end = grid.cellEnd[cell];
+    if (begin == end) return 0;
+
+    const Vector2 noShift{0.0f, 0.0f};
+    // sums[base + a]: lo slot a della fascia, senza puntatori fuori da sums
+    const int base = band.offset(begin) - begin;
+    long long pairs = 0;
+
+    // Coppie interne alla cella
+    for (int a = begin; a < end; ++a) {
+        const int i = grid.cellIndices[a];
+        for (int b = a + 1; b < end; ++b) {
+            const int j = grid.cellIndices[b];
+            accumulatePair<Fast>(band.sums[base + a], band.sums[base + b], state[i], state[j], noShift);
+        }
+        pairs += end - a - 1;
+    }
+
+    // Coppie con le celle della metà in avanti dello stencil
+    const int cellX = cell % grid.cellCountX;
+    const int cellY = cell / grid.cellCountX;
+    forEachHalfStencilCell<Reach, Periodic>(cellX, cellY, grid, [&](const int other, const Vector2& shift) {
+        const int otherBegin = grid.cellBegin[other];
+        const int otherEnd = grid.cellEnd[other];
+        if (otherBegin == otherEnd) return;
+        BOIDS_DEBUG_ASSERT(band.covers(otherBegin) && band.covers(otherEnd - 1));
+        const int otherBase = band.offset(otherBegin) - otherBegin;
+        for (int a = begin; a < end; ++a) {
+            const int i = grid.cellIndices[a];
+            for (int b = otherBegin; b < otherEnd; ++b) {
+                const int j = grid.cellIndices[b];
+                accumulatePair<Fast>(band.sums[base + a], band.sums[otherBase + b], state[i], state[j], shift);
+            }
+        }
+        pairs += static_cast<long long>(end - begin) * (otherEnd - otherBegin);
+    });
+    return pairs;
+}
+
+/**
+ * Riduzione della fascia del thread: per ogni slot posseduto somma ai
+ * propri accumulatori quelli dei contributori che lo coprono, chiude le
+ * tre regole e integra il boid dello slot.
+ */
+template<bool Fast = false>
+inline void finishBandHalfPair(const int thread,
+                               const BoidArray& oldState,
+                               BoidArray& newState,
+                               const UniformGrid& grid,
+                               const HalfPairAccumulators& accumulators)
+{
+    const HalfPairBand& band = accumulators.bands[thread];
+    for (int slot = band.slotBegin; slot < band.slotEnd; ++slot) {
+        FlockSums sums = band.sums[slot - band.slotBegin];
+        for (const int u : band.contributors) {
+            const HalfPairBand& other = accumulators.bands[u];
+            if (other.covers(slot)) mergeFlockSums(sums, other.sums[other.offset(slot)]);
+        }
+
+        const int i = grid.cellIndices[slot];
+        integrateBoid<Fast>(oldState[i], flockAcceleration<Fast>(sums, oldState[i]), newState[i]);
+    }
+}
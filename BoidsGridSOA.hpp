@@ -0,0 +1,133 @@
+//BoidsGridSOA.hpp
+#pragma once
+
+#include "BoidsGrid.hpp"
+#include "BoidsSOA.hpp"
+#include "BoidsUpdateSOA.hpp"
+
+/**
+ * Griglia sullo stato SoA ordinato per cella: dopo parallelBuildGridFrom lo
+ * stato viene permutato nell'ordine di cellIndices, così la cella c occupa
+ * gli indici [cellBegin[c], cellEnd[c]) di ogni array e le sue sorgenti
+ * sono un intervallo contiguo. Il passo vettorizza sui bersagli come la
+ * variante outer di ParSOAHeadless (accumulateTargetsSoA): W boid della
+ * stessa cella per volta, ognuno su una corsia, contro gli intervalli delle
+ * celle dello stencil traslati dello shift di immagine minima.
+ */
+
+// Posizione del boid i nello stato SoA, per parallelBuildGridFrom
+struct SoAPosition {
+    const BoidSoA& state;
+    Vector2 operator()(const int i) const { return {state.posX[i], state.posY[i]}; }
+};
+
+/**
+ * Visita tutte le celle dello stencil di (cellX, cellY), centro compreso.
+ * I bersagli di un blocco condividono la cella ma non la posizione, quindi
+ * gli angoli del 5x5 non si scartano: decide la distanza (come in
+ * forEachHalfStencilCell).
+ */
+template<int Reach = 1, bool Periodic = false, typename CellCallback>
+[[gnu::always_inline]] inline void forEachCellStencil(const int cellX, const int cellY,
+                                                     const UniformGrid& grid,
+                                                     CellCallback&& callback)
+{
+    constexpr int StencilSize = (2 * Reach + 1) * (2 * Reach + 1);
+
+    if constexpr (Periodic) {
+        BOIDS_DEBUG_ASSERT(grid.periodic && grid.stencilSize == StencilSize);
+        const StencilNeighbor* entry = grid.stencilTable.data()
+            + static_cast<size_t>(grid.getCellIndex(cellX, cellY)) * StencilSize;
+
+        for (int s = 0; s < StencilSize; ++s) {
+            callback(entry[s].cell, entry[s].shiftX, entry[s].shiftY);
+        }
+    } else {
+        for (int dy = -Reach; dy <= Reach; dy++) {
+            const int ny = cellY + dy;
+            if (ny < 0 || ny >= grid.cellCountY) continue;
+
+            for (int dx = -Reach; dx <= Reach; dx++) {
+                const int nx = cellX + dx;
+                if (nx < 0 || nx >= grid.cellCountX) continue;
+                callback(grid.getCellIndex(nx, ny), 0.0f, 0.0f);
+            }
+        }
+    }
+}
+
+/**
+ * Passo completo per i boid della cella, W per volta: somme contro le celle
+ * dello stencil, chiusura e integrazione vettoriali (integrateBoidsSimd),
+ * scrittura in next agli stessi indici ordinati. Il boid stesso si esclude
+ * per indice, come in accumulateTargetsSoA: nello stato ordinato l'indice
+ * della sorgente coincide con quello del bersaglio.
+ * Restituisce i candidati visitati (coppie bersaglio-sorgente).
+ */
+template<int W, int Reach, bool Periodic, bool Fast>
+[[gnu::always_inline]] inline long long computeCellSoA(const int cell,
+                                                     const BoidSoA& sorted,
+                                                     BoidSoA& next,
+                                                     const UniformGrid& grid)
+{
+    const int cellX = cell % grid.cellCountX;
+    const int cellY = cell / grid.cellCountX;
+    const int end = grid.cellEnd[cell];
+
+    long long candidates = 0;
+    for (int targetBegin = grid.cellBegin[cell]; targetBegin < end; targetBegin += W) {
+        const int count = std::min(W, end - targetBegin);
+        const BoidLanes<W> targets = loadTargetsSoA<W>(targetBegin, sorted, count);
+
+        FlockSumsSimd<W> acc;
+        forEachCellStencil<Reach, Periodic>(cellX, cellY, grid,
+            [&](const int source, const float shiftX, const float shiftY) __attribute__((always_inline)) {
+                const int sourceBegin = grid.cellBegin[source];
+                const int sourceEnd = grid.cellEnd[source];
+                accumulateTargetsSoA<W, Fast>(acc, targets, targetBegin, sorted, sourceBegin, sourceEnd, shiftX, shiftY);
+                candidates += static_cast<long long>(count) * (sourceEnd - sourceBegin);
+            });
+
+        BoidLanes<W> lanes;
+        integrateBoidsSimd<W, Fast>(acc, targets, lanes);
+        storeTargetsSoA<W>(targetBegin, next, lanes, count);
+    }
+    return candidates;
+}
+
+// Kernel per cella, scelto all'avvio in base all'ISA e alla precisione
+using CellKernelSoA = long long (*)(int, const BoidSoA&, BoidSoA&, const UniformGrid&);
+
+template<int Reach, bool Periodic, bool Fast>
+inline CellKernelSoA selectCellKernelSoA(const SimdIsa isa) {
+    switch (isa) {
+        case SimdIsa::Avx512: return SimdTargets<computeCellSoA<16, Reach, Periodic, Fast>>::avx512;
+        case SimdIsa::Avx2:   return SimdTargets<computeCellSoA<8, Reach, Periodic, Fast>>::avx2;
+        default:              return SimdTargets<computeCellSoA<4, Reach, Periodic, Fast>>::generic;
+    }
+}
+
+template<int Reach, bool Periodic>
+inline CellKernelSoA selectCellKernelSoA(const SimdIsa isa, const Precision precision) {
+    return precision == Precision::Fast ? selectCellKernelSoA<Reach, Periodic, true>(isa)
+                                        : selectCellKernelSoA<Reach, Periodic, false>(isa);
+}
+
+/**
+ * Permuta lo stato nell'ordine delle celle: da chiamare da tutti i thread
+ * di una regione parallela già aperta, dopo parallelBuildGridFrom.
+ */
+inline void permuteByCellSoA(const BoidSoA& state,
+                             BoidSoA& sorted,
+                             const UniformGrid& grid,
+                             const int numBoids)
+{
+    #pragma omp for schedule(static)
+    for (int k = 0; k < numBoids; ++k) {
+        const int src = grid.cellIndices[k];
+        sorted.posX[k] = state.posX[src];
+        sorted.posY[k] = state.posY[src];
+        sorted.velX[k] = state.velX[src];
+        sorted.velY[k] = state.velY[src];
+    }
+}
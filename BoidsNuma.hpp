@@ -0,0 +1,192 @@
+//BoidsNuma.hpp
+#pragma once
+#include "BoidsAlloc.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <omp.h>
+#if defined(__linux__)
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Nodi NUMA e affinità dei thread per i buffer di BoidsAlloc.hpp, e il
+// riepilogo delle pagine ottenute
+
+// Nodo NUMA della CPU del thread chiamante (0 se non disponibile)
+inline int currentNumaNode() {
+#if defined(__linux__) && defined(SYS_getcpu)
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) return static_cast<int>(node);
+#endif
+    return 0;
+}
+
+/**
+ * Fissa il thread chiamante sulla index-esima CPU (modulo il loro numero)
+ * tra quelle concesse al thread, che eredita la maschera del processo.
+ * Da chiamare una volta per thread, prima di allocare i suoi buffer, se
+ * OpenMP non lega già i thread (OMP_PROC_BIND). Restituisce false se
+ * l'affinità non è disponibile.
+ */
+inline bool pinCurrentThread(const int index) {
+#if defined(__linux__)
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return false;
+    const int count = CPU_COUNT(&allowed);
+    if (count == 0) return false;
+
+    int target = index % count;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &allowed) || target-- > 0) continue;
+        cpu_set_t pinned;
+        CPU_ZERO(&pinned);
+        CPU_SET(cpu, &pinned);
+        return sched_setaffinity(0, sizeof(pinned), &pinned) == 0;
+    }
+#else
+    (void)index;
+#endif
+    return false;
+}
+
+// Vero se il thread chiamante può girare su una sola CPU
+inline bool currentThreadPinned() {
+#if defined(__linux__)
+    cpu_set_t allowed;
+    return sched_getaffinity(0, sizeof(allowed), &allowed) == 0 && CPU_COUNT(&allowed) == 1;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Preferenza NUMA per le pagine di [0, count) elementi di data (allocated
+ * elementi allocati, padding compreso): ogni thread
+ * prende l'intervallo che gli assegna schedule(static) (con il riparto di
+ * libgomp) e lega al proprio nodo le pagine il cui primo byte cade lì, con
+ * MPOL_PREFERRED (un nodo pieno ripiega sugli altri invece di fallire) e
+ * MPOL_MF_MOVE per quelle già presenti. Apre una regione parallela: va
+ * chiamata dal main, prima dei cicli di first-touch. Lega solo le pagine
+ * dei thread che non possono migrare (OMP_PROC_BIND o pinCurrentThread):
+ * il nodo di un thread libero è casuale, e per i suoi intervalli e per i
+ * buffer piccoli resta il first-touch.
+ */
+template<typename T>
+inline void bindToOwnerNodes(const T* data, const int count, const std::size_t allocated) {
+#if defined(__linux__) && defined(SYS_mbind)
+    const std::size_t bytes = stateBufferBytes(allocated * sizeof(T));
+    if (bytes < HUGE_PAGE_SIZE) return;
+
+    const auto base = reinterpret_cast<std::uintptr_t>(data);
+    const auto roundToPage = [base](const std::uintptr_t address) {
+        return base + (address - base + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    };
+
+    const bool bound = omp_get_proc_bind() != omp_proc_bind_false;
+    #pragma omp parallel default(none) shared(count, bytes, base, roundToPage, bound)
+    {
+        const int threads = omp_get_num_threads();
+        const int thread = omp_get_thread_num();
+        const int chunk = count / threads;
+        const int extra = count % threads;
+        const int begin = thread * chunk + std::min(thread, extra);
+        const int end = begin + chunk + (thread < extra ? 1 : 0);
+
+        const std::uintptr_t first = roundToPage(base + static_cast<std::size_t>(begin) * sizeof(T));
+        const std::uintptr_t last = thread == threads - 1
+            ? base + bytes
+            : roundToPage(base + static_cast<std::size_t>(end) * sizeof(T));
+        if (const int node = currentNumaNode(); last > first && node < 64 && (bound || currentThreadPinned())) {
+            const unsigned long nodeMask = 1UL << node;
+            if (syscall(SYS_mbind, first, last - first, MPOL_PREFERRED, &nodeMask, 64, MPOL_MF_MOVE) != 0) {
+                pageStats().bindFailures++;
+            }
+        }
+    }
+#else
+    (void)data;
+    (void)count;
+    (void)allocated;
+#endif
+}
+
+template<typename T>
+inline void bindToOwnerNodes(const std::vector<T, AlignedAllocator<T>>& array, const int count) {
+    bindToOwnerNodes(array.data(), count, array.capacity());
+}
+
+template<typename T>
+inline void bindToOwnerNodes(const std::vector<T, AlignedAllocator<T>>& array) {
+    bindToOwnerNodes(array, static_cast<int>(array.size()));
+}
+
+/**
+ * Riepilogo all'avvio, da chiamare dopo l'inizializzazione degli stati: la
+ * politica, i MB vivi per tipo di pagina e i fallback da hugetlb, le
+ * AnonHugePages del processo (le THP davvero ottenute) e il numero di
+ * pagine dei buffer grandi su ciascun nodo, campionate con move_pages.
+ */
+inline void printPageReport() {
+    PageStats& stats = pageStats();
+    constexpr double MB = 1024.0 * 1024.0;
+
+    std::cout << "PAGES=" << pagePolicyName(activePagePolicy())
+              << " HUGETLB_MB=" << static_cast<double>(stats.hugeTlbBytes) / MB
+              << " THP_MB=" << static_cast<double>(stats.transparentBytes) / MB
+              << " SMALL_MB=" << static_cast<double>(stats.smallBytes) / MB
+              << " HUGETLB_FALLBACKS=" << stats.hugeTlbFallbacks;
+
+#if defined(__linux__)
+    std::ifstream smaps("/proc/self/smaps_rollup");
+    for (std::string line; std::getline(smaps, line);) {
+        if (line.rfind("AnonHugePages:", 0) == 0) {
+            std::cout << " ANON_HUGE_MB=" << std::stod(line.substr(14)) / 1024.0;
+        }
+    }
+
+#if defined(SYS_move_pages)
+    // Al più 64 pagine campionate per buffer, senza spostarle (nodes = nullptr)
+    constexpr int MAX_NODES = 64;
+    constexpr std::size_t SAMPLES = 64;
+    long long pagesOnNode[MAX_NODES] = {};
+    long long untouched = 0;
+    {
+        const std::lock_guard lock(stats.mutex);
+        for (const StateMapping& mapping : stats.mappings) {
+            const std::size_t pageBytes = mapping.pages == PagePolicy::Small ? static_cast<std::size_t>(sysconf(_SC_PAGESIZE)) : HUGE_PAGE_SIZE;
+            const std::size_t pageCount = mapping.bytes / pageBytes;
+            const std::size_t stride = std::max<std::size_t>(1, pageCount / SAMPLES);
+
+            std::vector<void*> pages;
+            for (std::size_t p = 0; p < pageCount; p += stride) pages.push_back(static_cast<char*>(mapping.data) + p * pageBytes);
+            std::vector<int> status(pages.size());
+            if (syscall(SYS_move_pages, 0, pages.size(), pages.data(), nullptr, status.data(), 0) != 0) continue;
+
+            for (const int node : status) {
+                if (node >= 0 && node < MAX_NODES) pagesOnNode[node]++;
+                else untouched++;
+            }
+        }
+    }
+    std::cout << " NODES=";
+    bool first = true;
+    for (int node = 0; node < MAX_NODES; ++node) {
+        if (pagesOnNode[node] == 0) continue;
+        std::cout << (first ? "" : ",") << node << ":" << pagesOnNode[node];
+        first = false;
+    }
+    if (first) std::cout << "-";
+    std::cout << " UNTOUCHED_PAGES=" << untouched;
+#endif
+    std::cout << " BIND_FAILURES=" << stats.bindFailures;
+#endif
+    std::cout << std::endl;
+}
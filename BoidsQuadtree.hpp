@@ -0,0 +1,183 @@
+//BoidsQuadtree.hpp
+#pragma once
+
+#include "BoidsGrid.hpp"
+#include <algorithm>
+#include <vector>
+
+/**
+ * Quadtree adattivo per flock fortemente raggruppati: la griglia uniforme
+ * (celle = VIEW_RADIUS, stencil 3x3) fa da radice, e ogni cella con più di
+ * leafCapacity boid viene suddivisa ricorsivamente in quadranti finché le
+ * foglie rispettano la capacità (o si raggiunge MAX_QUAD_DEPTH).
+ * Gli alberi delle celle sono indipendenti: la ricostruzione è parallela
+ * sulle celle e gli indici vengono partizionati sul posto in cellIndices,
+ * così ogni nodo è un intervallo contiguo [begin, end).
+ */
+
+constexpr int DEFAULT_LEAF_CAPACITY = 16;
+constexpr int MAX_QUAD_DEPTH = 12;
+
+struct QuadNode {
+    float minX, minY, maxX, maxY;
+    int begin, end;
+    int firstChild; // -1 per le foglie, altrimenti 4 figli consecutivi
+};
+
+struct QuadtreeForest {
+    UniformGrid grid;
+    int leafCapacity;
+    std::vector<std::vector<QuadNode>> trees; // un albero per cella, capacità riusata tra i passi
+
+    QuadtreeForest(const float width, const float height, const int leafCapacity, const bool periodic)
+        : grid(width, height, VIEW_RADIUS, periodic, 1), leafCapacity{leafCapacity}
+    {
+        trees.resize(grid.numCells());
+    }
+
+    [[nodiscard]] size_t nodeCount() const {
+        size_t count = 0;
+        for (const auto& tree : trees) count += tree.size();
+        return count;
+    }
+};
+
+// Suddivide il nodo nodeIndex (già inserito in tree) finché serve
+inline void subdivideQuadNode(std::vector<QuadNode>& tree,
+                              const int nodeIndex,
+                              IndexArray& indices,
+                              const BoidArray& state,
+                              const int leafCapacity,
+                              const int depth)
+{
+    const QuadNode node = tree[nodeIndex];
+    if (node.end - node.begin <= leafCapacity || depth >= MAX_QUAD_DEPTH) return;
+
+    const float midX = 0.5f * (node.minX + node.maxX);
+    const float midY = 0.5f * (node.minY + node.maxY);
+    int* const first = indices.data() + node.begin;
+    int* const last = indices.data() + node.end;
+
+    // Prima per y, poi ciascuna metà per x: quadranti SW, SE, NW, NE
+    int* const splitY = std::partition(first, last, [&](const int k) { return state[k].position.y < midY; });
+    int* const splitBottom = std::partition(first, splitY, [&](const int k) { return state[k].position.x < midX; });
+    int* const splitTop = std::partition(splitY, last, [&](const int k) { return state[k].position.x < midX; });
+
+    const int bounds[5] = {
+        node.begin,
+        static_cast<int>(splitBottom - indices.data()),
+        static_cast<int>(splitY - indices.data()),
+        static_cast<int>(splitTop - indices.data()),
+        node.end
+    };
+
+    const int firstChild = static_cast<int>(tree.size());
+    tree[nodeIndex].firstChild = firstChild;
+    for (int q = 0; q < 4; ++q) {
+        const bool right = (q & 1) != 0;
+        const bool top = (q & 2) != 0;
+        tree.push_back(QuadNode{
+            right ? midX : node.minX, top ? midY : node.minY,
+            right ? node.maxX : midX, top ? node.maxY : midY,
+            bounds[q], bounds[q + 1], -1});
+    }
+    for (int q = 0; q < 4; ++q) {
+        subdivideQuadNode(tree, firstChild + q, indices, state, leafCapacity, depth + 1);
+    }
+}
+
+// Radice della cella: bounding box stretta dei suoi boid (quelli oltre il
+// bordo del mondo vengono assegnati alle celle estreme e restano inclusi)
+inline void buildCellQuadtree(QuadtreeForest& forest, const int cell, const BoidArray& state) {
+    std::vector<QuadNode>& tree = forest.trees[cell];
+    tree.clear();
+
+    const int begin = forest.grid.cellBegin[cell];
+    const int end = forest.grid.cellEnd[cell];
+    if (begin == end) return;
+
+    float minX = state[forest.grid.cellIndices[begin]].position.x, maxX = minX;
+    float minY = state[forest.grid.cellIndices[begin]].position.y, maxY = minY;
+    for (int k = begin + 1; k < end; ++k) {
+        const Vector2& p = state[forest.grid.cellIndices[k]].position;
+        minX = std::min(minX, p.x); maxX = std::max(maxX, p.x);
+        minY = std::min(minY, p.y); maxY = std::max(maxY, p.y);
+    }
+
+    tree.push_back(QuadNode{minX, minY, maxX, maxY, begin, end, -1});
+    subdivideQuadNode(tree, 0, forest.grid.cellIndices, state, forest.leafCapacity, 0);
+}
+
+/**
+ * Ricostruzione parallela, da chiamare da tutti i thread della regione:
+ * griglia radice condivisa, poi un albero per cella con schedule dinamico
+ * (le celle dense costano molto più di quelle vuote).
+ */
+inline void parallelBuildQuadtree(const BoidArray& state, QuadtreeForest& forest) {
+    parallelBuildGrid(state, forest.grid);
+
+    #pragma omp for schedule(dynamic, 1)
+    for (int c = 0; c < forest.grid.numCells(); ++c) {
+        buildCellQuadtree(forest, c, state);
+    }
+}
+
+// Distanza al quadrato tra il punto (x, y) e il rettangolo del nodo
+inline float quadNodeDistance2(const QuadNode& node, const float x, const float y) {
+    const float dx = std::max({node.minX - x, 0.0f, x - node.maxX});
+    const float dy = std::max({node.minY - y, 0.0f, y - node.maxY});
+    return dx * dx + dy * dy;
+}
+
+/**
+ * computeNextBoidQuadtree:
+ * come computeNextBoidGrid, ma dentro ogni cella dello stencil si scende
+ * solo nei nodi che intersecano il cerchio di raggio VIEW_RADIUS.
+ * Restituisce il numero di candidati visitati nelle foglie.
+ */
+template<bool Periodic = false, bool Fast = false>
+inline int computeNextBoidQuadtree(const int i,
+                                   const BoidArray& oldState,
+                                   BoidArray& newState,
+                                   const QuadtreeForest& forest)
+{
+    const Boid& b = oldState[i];
+    const UniformGrid& grid = forest.grid;
+    auto [cellX, cellY] = getCellCoords(b.position, grid);
+
+    FlockSums sums;
+    int candidates = 0;
+    int stack[4 * MAX_QUAD_DEPTH + 1];
+
+    forEachStencilCell<1, Periodic>(b.position, cellX, cellY, grid, [&](const int cell, const Vector2& shift) {
+        const std::vector<QuadNode>& tree = forest.trees[cell];
+        if (tree.empty()) return;
+
+        // Il test sui nodi si fa nello spazio della cella: centro traslato di -shift
+        const float queryX = b.position.x - shift.x;
+        const float queryY = b.position.y - shift.y;
+
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const QuadNode& node = tree[stack[--top]];
+            if (quadNodeDistance2(node, queryX, queryY) >= VIEW_RADIUS * VIEW_RADIUS) continue;
+
+            if (node.firstChild >= 0) {
+                for (int q = 0; q < 4; ++q) stack[top++] = node.firstChild + q;
+                continue;
+            }
+
+            for (int k = node.begin; k < node.end; ++k) {
+                const int otherIdx = grid.cellIndices[k];
+                candidates++;
+                if (otherIdx == i) continue;
+                const auto&[position, velocity] = oldState[otherIdx];
+                accumulateNeighbor<Fast>(sums, b.position, Periodic ? position + shift : position, velocity);
+            }
+        }
+    });
+
+    integrateBoid<Fast>(b, flockAcceleration<Fast>(sums, b), newState[i]);
+    return candidates;
+}
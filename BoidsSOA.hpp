@@ -1,69 +1,61 @@
 //BoidsSOA.hpp
 #pragma once
+#include "BoidsNuma.hpp"
+#include "BoidsCommon.hpp"
 #include <vector>
-#include <cmath>
-#include <random>
 
-constexpr float WIDTH = 1000.0f;
-constexpr float HEIGHT = 800.0f;
-constexpr float MAX_SPEED = 3.0f;
-constexpr float MAX_FORCE = 0.1f;
-constexpr float VIEW_RADIUS = 100.0f;
-constexpr float SEPARATION_RADIUS = 20.0f;
-constexpr float SEPARATION_WEIGHT = 2.0f;
-constexpr float ALIGNMENT_WEIGHT  = 1.0f;
-constexpr float COHESION_WEIGHT   = 1.5f;
-
-struct Vector2 {
-    float x, y;
-    Vector2() : x{0}, y{0} {}
-    Vector2(const float x_, const float y_) : x{x_}, y{y_} {}
-
-    Vector2 operator+(const Vector2& other) const { return {x + other.x, y + other.y}; }
-    Vector2 operator-(const Vector2& other) const { return {x - other.x, y - other.y}; }
-    Vector2 operator*(const float scalar) const  { return {x * scalar, y * scalar}; }
-    Vector2 operator/(const float scalar) const { return {x / scalar, y / scalar}; }
-
-    [[nodiscard]] float magnitude() const {
-        return std::sqrt(x * x + y * y);
-    }
-
-    [[nodiscard]] Vector2 normalized() const {
-        const float mag = magnitude();
-        return mag > 0.0f ? *this / mag : *this;
-    }
-
-    void limit(const float max) {
-        if (const float mag = magnitude(); mag > max) {
-            *this = (*this / mag) * max;
+// Corsie di padding in coda agli array SoA: la larghezza SIMD massima (AVX-512)
+constexpr int SOA_PADDING = 16;
+
+// Posizione dei boid sentinella nel padding: lontana dal mondo (anche con
+// lo shift periodico) più di qualsiasi raggio, quindi non è mai un vicino
+constexpr float SENTINEL_POSITION = -1.0e6f;
+
+using StateArray = std::vector<float, AlignedAllocator<float>>;
+
+/**
+ * Structure of Arrays (SoA). Gli array sono allineati a 64 byte e allungati
+ * di SOA_PADDING .. 2 * SOA_PADDING - 1 boid sentinella (fermi in
+ * SENTINEL_POSITION), fino al multiplo di SOA_PADDING successivo a
+ * size() + SOA_PADDING - 1: un load di 16 corsie da qualsiasi indice
+ * < size() resta nell'array e le corsie oltre size() non superano mai il
+ * test del raggio, quindi i kernel
+ * SIMD leggono vettori interi senza load parziali né maschere di coda.
+ * I boid reali partono a zero senza toccare le pagine (vedi resizeUninitialized).
+ */
+struct BoidSoA {
+    StateArray posX, posY;
+    StateArray velX, velY;
+    int count = 0;
+
+    explicit BoidSoA(const int n) : count{n} {
+        const int padded = paddedSize(n);
+        for (StateArray* array : {&posX, &posY, &velX, &velY}) resizeUninitialized(*array, padded);
+
+        for (int i = n; i < padded; ++i) {
+            posX[i] = SENTINEL_POSITION;
+            posY[i] = SENTINEL_POSITION;
+            velX[i] = 0.0f;
+            velY[i] = 0.0f;
         }
     }
-};
-
-    // Standard AoS (Array of Structures)
-    struct Boid {
-        Vector2 position;
-        Vector2 velocity;
-    };
-
-    // Structure of Arrays (SoA)
-    struct BoidSoA {
-        std::vector<float> posX, posY;
-        std::vector<float> velX, velY;
 
-    explicit BoidSoA(const int n) {
-        posX.resize(n);
-        posY.resize(n);
-        velX.resize(n);
-        velY.resize(n);
-    }
+    static int paddedSize(const int n) { return (n + 2 * SOA_PADDING - 1) / SOA_PADDING * SOA_PADDING; }
 
-    [[nodiscard]] int size() const { return static_cast<int>(posX.size()); }
+    [[nodiscard]] int size() const { return count; }
 
     void swap(BoidSoA& other) noexcept {
         posX.swap(other.posX);
         posY.swap(other.posY);
         velX.swap(other.velX);
         velY.swap(other.velY);
+        std::swap(count, other.count);
     }
 };
+
+// Preferenza NUMA dei quattro array per intervalli schedule(static) di boid
+inline void bindToOwnerNodes(const BoidSoA& state) {
+    for (const StateArray* array : {&state.posX, &state.posY, &state.velX, &state.velY}) {
+        bindToOwnerNodes(*array, state.size());
+    }
+}
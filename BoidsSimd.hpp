@@ -0,0 +1,511 @@
+//BoidsSimd.hpp
+#pragma once
+#include "BoidsCommon.hpp"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/**
+ * Strato SIMD portabile, nello stile di std::experimental::simd ma costruito
+ * sui vector extension di GCC/Clang: Simd<W> è un vettore di W float, con
+ * operatori aritmetici, confronti che producono maschere (-1 / 0 per corsia)
+ * e selezione. Niente intrinsic: lo stesso codice delle regole compila in
+ * SSE (W = 4), AVX2 (8) o AVX-512 (16) a seconda di W e del target della
+ * funzione in cui viene espanso; l'ISA "scalar" usa le funzioni di
+ * riferimento (accumulateNeighbor, accumulateRangeSoA). I kernel di ogni
+ * motore vengono istanziati dentro funzioni __attribute__((target, flatten))
+ * (vedi SimdTargets) e scelti all'avvio con CPUID (vedi activeSimdIsa).
+ * Il brute force SoA usa invece i kernel intrinsic di BoidsSimdSOA.hpp.
+ *
+ * Con Precision::Exact le distanze e le norme usano sqrt e divisioni vere
+ * (Simd::sqrt) come il riferimento scalare; solo Precision::Fast usa la
+ * stima rsqrt con un passo di Newton.
+ *
+ * I vettori grezzi (SimdTypes) restano dentro funzioni always_inline: tra
+ * una funzione e l'altra passano avvolti in SimdFloat / SimdMask, aggregati
+ * che l'ABI passa in memoria con qualsiasi ISA, quindi nessuna firma cambia
+ * tra SSE e AVX e non serve -Wno-psabi.
+ */
+
+enum class SimdIsa { Scalar, Sse, Avx2, Avx512 };
+
+/**
+ * Tolleranza rispetto al kernel di riferimento (test sulle distanze): i
+ * test qui avvengono su dist^2 e le somme hanno un altro ordine, quindi le
+ * somme di ogni boid differiscono di al più
+ * SIMD_TOLERANCE in termini relativi (misurato ~6e-6 fino a 20000 boid) e
+ * i conteggi coincidono salvo coppie a distanza esattamente VIEW_RADIUS.
+ * Le velocità non sono un buon metro: nello stato iniziale a reticolo le
+ * somme si annullano e la normalizzazione amplifica ogni arrotondamento.
+ */
+constexpr float SIMD_TOLERANCE = 1e-4f;
+
+inline SimdIsa detectSimdIsa() {
+    // Le maschere come vettori di interi richiedono anche DQ/BW/VL (Skylake-X in poi)
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")
+        && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl")) return SimdIsa::Avx512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SimdIsa::Avx2;
+    if (__builtin_cpu_supports("sse2")) return SimdIsa::Sse;
+    return SimdIsa::Scalar;
+}
+
+// ISA usata dai kernel dei motori; di default la migliore supportata,
+// main può forzarne una più bassa (vedi parseSimdIsa)
+inline SimdIsa& activeSimdIsa() {
+    static SimdIsa isa = detectSimdIsa();
+    return isa;
+}
+
+// Nome da riga di comando ("scalar", "sse", "avx2", "avx512") -> ISA
+inline bool parseSimdIsa(const char* name, SimdIsa& isa) {
+    if (std::strcmp(name, "scalar") == 0) isa = SimdIsa::Scalar;
+    else if (std::strcmp(name, "sse") == 0) isa = SimdIsa::Sse;
+    else if (std::strcmp(name, "avx2") == 0) isa = SimdIsa::Avx2;
+    else if (std::strcmp(name, "avx512") == 0) isa = SimdIsa::Avx512;
+    else return false;
+    return true;
+}
+
+inline const char* simdIsaName(const SimdIsa isa) {
+    switch (isa) {
+        case SimdIsa::Sse:    return "sse";
+        case SimdIsa::Avx2:   return "avx2";
+        case SimdIsa::Avx512: return "avx512";
+        default:              return "scalar";
+    }
+}
+
+// Corsie di un vettore float dell'ISA (1 per scalar)
+inline int simdIsaWidth(const SimdIsa isa) {
+    switch (isa) {
+        case SimdIsa::Sse:    return 4;
+        case SimdIsa::Avx2:   return 8;
+        case SimdIsa::Avx512: return 16;
+        default:              return 1;
+    }
+}
+
+// Vero se la CPU corrente può eseguire i kernel dell'ISA richiesta
+inline bool simdIsaSupported(const SimdIsa isa) {
+    return static_cast<int>(isa) <= static_cast<int>(detectSimdIsa());
+}
+
+// ISA della deriva di riferimento nel report drift: le stesse regole exact
+// con le somme in un altro ordine (scalar, oppure sse se isa è già scalar)
+inline SimdIsa reorderedSumsIsa(const SimdIsa isa) {
+    if (isa != SimdIsa::Scalar) return SimdIsa::Scalar;
+    return simdIsaSupported(SimdIsa::Sse) ? SimdIsa::Sse : SimdIsa::Scalar;
+}
+
+/**
+ * Istanze di un kernel compilate per ciascun target: SimdTargets<&k<16>>::avx512
+ * ha la stessa firma di k<16> ed espande k (e tutto ciò che chiama, flatten)
+ * con le istruzioni AVX-512. Le larghezze 8 e 16 vanno usate solo con
+ * avx2 / avx512, e solo se la CPU le supporta.
+ */
+template<auto Kernel>
+struct SimdTargets;
+
+template<typename Result, typename... Args, Result (*Kernel)(Args...)>
+struct SimdTargets<Kernel> {
+    __attribute__((flatten))
+    static Result generic(Args... args) { return Kernel(args...); }
+
+    __attribute__((target("avx2,fma"), flatten))
+    static Result avx2(Args... args) { return Kernel(args...); }
+
+    __attribute__((target("avx512f,avx512dq,avx512bw,avx512vl,fma"), flatten))
+    static Result avx512(Args... args) { return Kernel(args...); }
+};
+
+// Tipi vettoriali per larghezza (vector_size deve essere una costante non dipendente)
+template<int W>
+struct SimdTypes;
+
+template<>
+struct SimdTypes<4> {
+    typedef float Float __attribute__((vector_size(16)));
+    typedef std::int32_t Mask __attribute__((vector_size(16)));
+};
+
+template<>
+struct SimdTypes<8> {
+    typedef float Float __attribute__((vector_size(32)));
+    typedef std::int32_t Mask __attribute__((vector_size(32)));
+};
+
+template<>
+struct SimdTypes<16> {
+    typedef float Float __attribute__((vector_size(64)));
+    typedef std::int32_t Mask __attribute__((vector_size(64)));
+};
+
+/**
+ * Maschera di W corsie (-1 / 0) o vettore di W interi, con gli operatori
+ * dei vector extension: aritmetica, shift, confronti e logica bit a bit.
+ */
+template<int W>
+struct SimdMask {
+    using Raw = typename SimdTypes<W>::Mask;
+    Raw raw;
+
+    [[gnu::always_inline]] std::int32_t operator[](const int lane) const { return raw[lane]; }
+
+    [[gnu::always_inline]] friend SimdMask operator~(const SimdMask& a) { return {~a.raw}; }
+    [[gnu::always_inline]] friend SimdMask operator&(const SimdMask& a, const SimdMask& b) { return {a.raw & b.raw}; }
+    [[gnu::always_inline]] friend SimdMask operator|(const SimdMask& a, const SimdMask& b) { return {a.raw | b.raw}; }
+    [[gnu::always_inline]] friend SimdMask operator+(const SimdMask& a, const SimdMask& b) { return {a.raw + b.raw}; }
+    [[gnu::always_inline]] friend SimdMask operator-(const SimdMask& a, const SimdMask& b) { return {a.raw - b.raw}; }
+    [[gnu::always_inline]] friend SimdMask operator+(const SimdMask& a, const std::int32_t b) { return {a.raw + b}; }
+    [[gnu::always_inline]] friend SimdMask operator-(const SimdMask& a, const std::int32_t b) { return {a.raw - b}; }
+    [[gnu::always_inline]] friend SimdMask operator>>(const SimdMask& a, const int bits) { return {a.raw >> bits}; }
+    [[gnu::always_inline]] friend SimdMask operator<(const SimdMask& a, const std::int32_t b) { return {a.raw < b}; }
+    [[gnu::always_inline]] friend SimdMask operator==(const SimdMask& a, const std::int32_t b) { return {a.raw == b}; }
+    [[gnu::always_inline]] friend SimdMask operator!=(const SimdMask& a, const std::int32_t b) { return {a.raw != b}; }
+    [[gnu::always_inline]] SimdMask& operator+=(const SimdMask& b) { raw += b.raw; return *this; }
+    [[gnu::always_inline]] SimdMask& operator-=(const SimdMask& b) { raw -= b.raw; return *this; }
+};
+
+// Vettore di W float, con aritmetica e confronti (che danno una SimdMask)
+template<int W>
+struct SimdFloat {
+    using Raw = typename SimdTypes<W>::Float;
+    Raw raw;
+
+    [[gnu::always_inline]] float operator[](const int lane) const { return raw[lane]; }
+
+    [[gnu::always_inline]] friend SimdFloat operator-(const SimdFloat& a) { return {-a.raw}; }
+    [[gnu::always_inline]] friend SimdFloat operator+(const SimdFloat& a, const SimdFloat& b) { return {a.raw + b.raw}; }
+    [[gnu::always_inline]] friend SimdFloat operator-(const SimdFloat& a, const SimdFloat& b) { return {a.raw - b.raw}; }
+    [[gnu::always_inline]] friend SimdFloat operator*(const SimdFloat& a, const SimdFloat& b) { return {a.raw * b.raw}; }
+    [[gnu::always_inline]] friend SimdFloat operator/(const SimdFloat& a, const SimdFloat& b) { return {a.raw / b.raw}; }
+    [[gnu::always_inline]] friend SimdFloat operator+(const SimdFloat& a, const float b) { return {a.raw + b}; }
+    [[gnu::always_inline]] friend SimdFloat operator-(const SimdFloat& a, const float b) { return {a.raw - b}; }
+    [[gnu::always_inline]] friend SimdFloat operator*(const SimdFloat& a, const float b) { return {a.raw * b}; }
+    [[gnu::always_inline]] friend SimdFloat operator/(const SimdFloat& a, const float b) { return {a.raw / b}; }
+    [[gnu::always_inline]] friend SimdFloat operator+(const float a, const SimdFloat& b) { return {a + b.raw}; }
+    [[gnu::always_inline]] friend SimdFloat operator-(const float a, const SimdFloat& b) { return {a - b.raw}; }
+    [[gnu::always_inline]] friend SimdFloat operator*(const float a, const SimdFloat& b) { return {a * b.raw}; }
+    [[gnu::always_inline]] friend SimdFloat operator/(const float a, const SimdFloat& b) { return {a / b.raw}; }
+    [[gnu::always_inline]] friend SimdMask<W> operator<(const SimdFloat& a, const float b) { return {a.raw < b}; }
+    [[gnu::always_inline]] friend SimdMask<W> operator>(const SimdFloat& a, const float b) { return {a.raw > b}; }
+    [[gnu::always_inline]] SimdFloat& operator+=(const SimdFloat& b) { raw += b.raw; return *this; }
+    [[gnu::always_inline]] SimdFloat& operator-=(const SimdFloat& b) { raw -= b.raw; return *this; }
+    [[gnu::always_inline]] SimdFloat& operator*=(const SimdFloat& b) { raw *= b.raw; return *this; }
+};
+
+template<int W>
+struct Simd {
+    static constexpr int width = W;
+
+    using Float = SimdFloat<W>;
+    using Mask = SimdMask<W>;
+    using RawFloat = typename SimdTypes<W>::Float;
+    using RawMask = typename SimdTypes<W>::Mask;
+
+    [[gnu::always_inline]] static Float broadcast(const float value) { return {RawFloat{} + value}; }
+
+    [[gnu::always_inline]] static Float load(const float* source) {
+        Float result;
+        std::memcpy(&result, source, sizeof(Float));
+        return result;
+    }
+
+    // source allineato a sizeof(Float) (array SoA da indici multipli di W)
+    [[gnu::always_inline]] static Float loadAligned(const float* source) {
+        Float result;
+        std::memcpy(&result, __builtin_assume_aligned(source, sizeof(Float)), sizeof(Float));
+        return result;
+    }
+
+    // Le corsie oltre count restano a zero
+    [[gnu::always_inline]] static Float loadPartial(const float* source, const int count) {
+        Float result{};
+        std::memcpy(&result, source, static_cast<size_t>(count) * sizeof(float));
+        return result;
+    }
+
+    [[gnu::always_inline]] static void store(float* destination, const Float& value) {
+        std::memcpy(destination, &value, sizeof(Float));
+    }
+
+    [[gnu::always_inline]] static void storePartial(float* destination, const Float& value, const int count) {
+        std::memcpy(destination, &value, static_cast<size_t>(count) * sizeof(float));
+    }
+
+    // 0, 1, ..., W - 1
+    [[gnu::always_inline]] static Mask lanes() {
+        RawMask result;
+        for (int lane = 0; lane < W; ++lane) result[lane] = lane;
+        return {result};
+    }
+
+    [[gnu::always_inline]] static Float select(const Mask& mask, const Float& a, const Float& b) { return {mask.raw ? a.raw : b.raw}; }
+    [[gnu::always_inline]] static Float zeroUnless(const Mask& mask, const Float& a) { return {mask.raw ? a.raw : RawFloat{}}; }
+
+    /**
+     * a < b come segno di a - b (esatto per float finiti): una maschera
+     * senza confronti. GCC 12 scalarizza l'AND di due confronti a 16 corsie
+     * (maschere k di AVX-512), quindi le maschere che si combinano tra loro
+     * passano da qui.
+     */
+    [[gnu::always_inline]] static Mask less(const Float& a, const Float& b) { return {(RawMask)(a.raw - b.raw) >> 31}; }
+
+    [[gnu::always_inline]] static Float max(const Float& a, const Float& b) { return {a.raw > b.raw ? a.raw : b.raw}; }
+
+    [[gnu::always_inline]] static Float toFloat(const Mask& value) { return {__builtin_convertvector(value.raw, RawFloat)}; }
+
+    [[gnu::always_inline]] static bool any(const Mask& mask) {
+        std::int32_t merged = 0;
+        for (int lane = 0; lane < W; ++lane) merged |= mask[lane];
+        return merged != 0;
+    }
+
+    [[gnu::always_inline]] static float reduceAdd(const Float& value) {
+        float sum = 0.0f;
+        for (int lane = 0; lane < W; ++lane) sum += value[lane];
+        return sum;
+    }
+
+    /**
+     * sqrt esatta per corsia: senza errno (-fno-math-errno, vedi
+     * CMakeLists.txt) GCC la compila in una sqrtps del target del chiamante;
+     * altrimenti resta corretta, con una sqrt scalare per corsia.
+     */
+    [[gnu::always_inline]] static Float sqrt(const Float& x) {
+        RawFloat result;
+        for (int lane = 0; lane < W; ++lane) result[lane] = __builtin_sqrtf(x.raw[lane]);
+        return {result};
+    }
+
+    [[gnu::always_inline]] static int reduceAdd(const Mask& value) {
+        int sum = 0;
+        for (int lane = 0; lane < W; ++lane) sum += value[lane];
+        return sum;
+    }
+
+    /**
+     * 1 / sqrt(x) per x > 0 con operazioni portabili: stima sui bit
+     * (errore ~3e-2) e Steps passi di Newton (1.8e-3 dopo uno, ~5e-6 dopo
+     * due, come per fastInvSqrt).
+     */
+    template<int Steps = 2>
+    [[gnu::always_inline]] static Float rsqrt(const Float& x) {
+        const RawMask guessBits = 0x5f375a86 - ((RawMask)x.raw >> 1);
+        RawFloat y = (RawFloat)guessBits;
+        const RawFloat halfX = x.raw * 0.5f;
+        for (int iteration = 0; iteration < Steps; ++iteration) {
+            y = y * (1.5f - halfX * y * y);
+        }
+        return {y};
+    }
+
+    // 1 / sqrt(x) per x > 0: sqrt e divisione, oppure rsqrt<1> con Fast
+    template<bool Fast>
+    [[gnu::always_inline]] static Float invSqrt(const Float& x) {
+        if constexpr (Fast) return rsqrt<1>(x);
+        else return 1.0f / sqrt(x);
+    }
+};
+
+// Accumulatori delle tre regole per corsia, ridotti a fine visita
+template<int W>
+struct FlockSumsSimd {
+    using V = Simd<W>;
+    typename V::Float sepX{}, sepY{};
+    typename V::Float aliX{}, aliY{};
+    typename V::Float cohX{}, cohY{};
+    typename V::Mask sepCount{};
+    typename V::Mask viewCount{};
+
+    // Somme della sola corsia lane (una corsia per boid bersaglio)
+    [[gnu::always_inline]] void laneInto(const int lane, FlockSums& sums) const {
+        sums.separation = sums.separation + Vector2{sepX[lane], sepY[lane]};
+        sums.separationCount += sepCount[lane];
+        sums.alignment = sums.alignment + Vector2{aliX[lane], aliY[lane]};
+        sums.cohesion = sums.cohesion + Vector2{cohX[lane], cohY[lane]};
+        sums.viewCount += viewCount[lane];
+    }
+
+    [[gnu::always_inline]] void reduceInto(FlockSums& sums) const {
+        sums.separation = sums.separation + Vector2{V::reduceAdd(sepX), V::reduceAdd(sepY)};
+        sums.separationCount += V::reduceAdd(sepCount);
+        sums.alignment = sums.alignment + Vector2{V::reduceAdd(aliX), V::reduceAdd(aliY)};
+        sums.cohesion = sums.cohesion + Vector2{V::reduceAdd(cohX), V::reduceAdd(cohY)};
+        sums.viewCount += V::reduceAdd(viewCount);
+    }
+};
+
+/**
+ * Le regole per W vicini alla volta, unica copia condivisa dai motori:
+ * test dei raggi sulle distanze al quadrato, una sqrt e una divisione per
+ * coppia, la separazione (dx, dy) / dist^3 solo oltre la distanza minima
+ * 1e-4 (come nel kernel SoA). valid esclude le corsie vuote e il boid
+ * stesso. Con Fast (Precision::Fast) una rsqrt con un passo di Newton.
+ */
+template<int W, bool Fast = false>
+[[gnu::always_inline]] inline void accumulateNeighborsSimd(FlockSumsSimd<W>& acc,
+                                    const typename Simd<W>::Float& selfX,
+                                    const typename Simd<W>::Float& selfY,
+                                    const typename Simd<W>::Float& posX,
+                                    const typename Simd<W>::Float& posY,
+                                    const typename Simd<W>::Float& velX,
+                                    const typename Simd<W>::Float& velY,
+                                    const typename Simd<W>::Mask& valid)
+{
+    using V = Simd<W>;
+    constexpr float minDistance2 = 0.0001f * 0.0001f;
+
+    const typename V::Float dx = selfX - posX;
+    const typename V::Float dy = selfY - posY;
+    const typename V::Float dist2 = dx * dx + dy * dy;
+
+    const typename V::Mask inView = valid & V::less(dist2, V::broadcast(VIEW_RADIUS * VIEW_RADIUS));
+    if (!V::any(inView)) return;
+
+    // dist2 = 0 (boid sovrapposti) dà dist = 0 e peso pieno, come sqrt
+    typename V::Float dist, factor;
+    if constexpr (Fast) {
+        const typename V::Float invDist = V::template rsqrt<1>(V::max(dist2, V::broadcast(1e-30f)));
+        dist = dist2 * invDist;
+        factor = invDist * invDist * invDist;
+    } else {
+        dist = V::sqrt(dist2);
+        factor = 1.0f / (dist2 * dist); // infinito solo sotto minDistance2, scartato
+    }
+
+    const typename V::Float weight = V::zeroUnless(inView, (VIEW_RADIUS - dist) / VIEW_RADIUS);
+    acc.aliX += velX * weight;
+    acc.aliY += velY * weight;
+    acc.cohX += V::zeroUnless(inView, posX);
+    acc.cohY += V::zeroUnless(inView, posY);
+    acc.viewCount -= inView;
+
+    const typename V::Mask inSeparation = inView
+        & V::less(V::broadcast(minDistance2), dist2)
+        & V::less(dist2, V::broadcast(SEPARATION_RADIUS * SEPARATION_RADIUS));
+    factor = V::zeroUnless(inSeparation, factor);
+    acc.sepX += dx * factor;
+    acc.sepY += dy * factor;
+    acc.sepCount -= inSeparation;
+}
+
+/**
+ * Come accumulateNeighborsSimd, ma con i vicini letti da uno stato AoS:
+ * count (<= W) boid dati da indexOf(lane), con uno shift di immagine minima
+ * comune. I boid vengono copiati in array sullo stack e caricati con
+ * load (inserire le corsie una a una nei registri costa di più del calcolo);
+ * le corsie oltre count e quella del boid self restano non valide.
+ */
+template<int W, bool Fast = false, typename IndexOf>
+[[gnu::always_inline]] inline void accumulateBoidsSimd(FlockSumsSimd<W>& acc,
+                                const Vector2& self,
+                                const int selfIndex,
+                                const BoidArray& state,
+                                const int count,
+                                IndexOf&& indexOf,
+                                const Vector2& shift)
+{
+    using V = Simd<W>;
+    alignas(64) float posX[W] = {}, posY[W] = {}, velX[W] = {}, velY[W] = {};
+    alignas(64) std::int32_t valid[W] = {};
+    for (int lane = 0; lane < count; ++lane) {
+        const int index = indexOf(lane);
+        const Boid& other = state[index];
+        posX[lane] = other.position.x;
+        posY[lane] = other.position.y;
+        velX[lane] = other.velocity.x;
+        velY[lane] = other.velocity.y;
+        valid[lane] = index == selfIndex ? 0 : -1;
+    }
+
+    typename V::Mask validMask;
+    std::memcpy(&validMask, valid, sizeof(validMask));
+    accumulateNeighborsSimd<W, Fast>(acc, V::broadcast(self.x), V::broadcast(self.y),
+                                     V::load(posX) + shift.x, V::load(posY) + shift.y,
+                                     V::load(velX), V::load(velY), validMask);
+}
+
+/**
+ * Chiusura delle regole e integrazione con una corsia per boid bersaglio:
+ * le stesse operazioni di flockAcceleration e integrateBoid, con i rami
+ * trasformati in selezioni e le norme calcolate con sqrt (rsqrt con un
+ * passo di Newton con Fast). Con un conteggio positivo un vettore nullo dà la sola
+ * -velocità, come in flockAcceleration (steerSoA invece lo lascia nullo);
+ * la variante outer di ParSOAHeadless confronta lo stato dopo un passo.
+ */
+template<int W>
+struct BoidLanes {
+    typename Simd<W>::Float posX, posY, velX, velY;
+};
+
+// Scala (x, y) a modulo maxLength se lo supera (Vector2::limit)
+template<int W, bool Fast = false>
+[[gnu::always_inline]] inline void limitSimd(typename Simd<W>::Float& x,
+                                             typename Simd<W>::Float& y,
+                                             const float maxLength)
+{
+    using V = Simd<W>;
+    const typename V::Float length2 = x * x + y * y;
+    const typename V::Float scale = V::select(length2 > maxLength * maxLength,
+        maxLength * V::template invSqrt<Fast>(V::max(length2, V::broadcast(1e-30f))), V::broadcast(1.0f));
+    x *= scale;
+    y *= scale;
+}
+
+// Porta (x, y) a MAX_SPEED, sottrae la velocità e limita a MAX_FORCE come
+// flockAcceleration: un vettore nullo (vicini simmetrici) dà la sola
+// -velocità limitata. Le corsie con count nullo restano a zero
+template<int W, bool Fast = false>
+[[gnu::always_inline]] inline void steerSimd(typename Simd<W>::Float& x,
+                                             typename Simd<W>::Float& y,
+                                             const typename Simd<W>::Float& velX,
+                                             const typename Simd<W>::Float& velY,
+                                             const typename Simd<W>::Mask& count)
+{
+    using V = Simd<W>;
+    const typename V::Float length2 = x * x + y * y;
+    const typename V::Float toSpeed = MAX_SPEED * V::template invSqrt<Fast>(V::max(length2, V::broadcast(1e-30f)));
+    typename V::Float steerX = x * toSpeed - velX;
+    typename V::Float steerY = y * toSpeed - velY;
+    limitSimd<W, Fast>(steerX, steerY, MAX_FORCE);
+
+    x = V::zeroUnless(count, steerX);
+    y = V::zeroUnless(count, steerY);
+}
+
+template<int W, bool Fast = false>
+[[gnu::always_inline]] inline void integrateBoidsSimd(const FlockSumsSimd<W>& sums,
+                                                      const BoidLanes<W>& current,
+                                                      BoidLanes<W>& next)
+{
+    using V = Simd<W>;
+    constexpr float margin = WRAP_MARGIN;
+
+    // Conteggi nulli: la divisione per 1 lascia le somme (nulle) a zero
+    const typename V::Float sepCount = V::max(V::toFloat(sums.sepCount), V::broadcast(1.0f));
+    const typename V::Float viewCount = V::max(V::toFloat(sums.viewCount), V::broadcast(1.0f));
+
+    typename V::Float sepX = sums.sepX / sepCount, sepY = sums.sepY / sepCount;
+    typename V::Float aliX = sums.aliX / viewCount, aliY = sums.aliY / viewCount;
+    typename V::Float cohX = V::zeroUnless(sums.viewCount, sums.cohX / viewCount - current.posX);
+    typename V::Float cohY = V::zeroUnless(sums.viewCount, sums.cohY / viewCount - current.posY);
+    steerSimd<W, Fast>(sepX, sepY, current.velX, current.velY, sums.sepCount);
+    steerSimd<W, Fast>(aliX, aliY, current.velX, current.velY, sums.viewCount);
+    steerSimd<W, Fast>(cohX, cohY, current.velX, current.velY, sums.viewCount);
+
+    typename V::Float accX = sepX * SEPARATION_WEIGHT + aliX * ALIGNMENT_WEIGHT + cohX * COHESION_WEIGHT;
+    typename V::Float accY = sepY * SEPARATION_WEIGHT + aliY * ALIGNMENT_WEIGHT + cohY * COHESION_WEIGHT;
+    limitSimd<W, Fast>(accX, accY, MAX_FORCE);
+
+    next.velX = current.velX + accX;
+    next.velY = current.velY + accY;
+    limitSimd<W, Fast>(next.velX, next.velY, MAX_SPEED);
+
+    const typename V::Float posX = current.posX + next.velX;
+    const typename V::Float posY = current.posY + next.velY;
+    next.posX = V::select(posX < -margin, V::broadcast(WIDTH + margin),
+                          V::select(posX > WIDTH + margin, V::broadcast(-margin), posX));
+    next.posY = V::select(posY < -margin, V::broadcast(HEIGHT + margin),
+                          V::select(posY > HEIGHT + margin, V::broadcast(-margin), posY));
+}
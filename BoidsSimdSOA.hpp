@@ -0,0 +1,207 @@
+//BoidsSimdSOA.hpp
+#pragma once
+#include "BoidsSOA.hpp"
+#include "BoidsSimd.hpp"
+#include <immintrin.h>
+
+/**
+ * Kernel espliciti AVX2 / AVX-512 per la passata fusa del brute force SoA
+ * (stessa semantica di accumulateRangeSoA): 8 o 16 sorgenti per iterazione,
+ * test dei raggi sulle distanze al quadrato con maschere, somme mascherate
+ * e riduzione orizzontale finale. Sono compilati con __attribute__((target)),
+ * quindi non servono flag -m: la scelta avviene all'avvio in base a CPUID
+ * (vedi selectRangeKernelSoA). Sono più rapidi della stessa passata scritta
+ * con Simd<W> (accumulateRangeSimd, usata per SSE): le maschere restano nei
+ * registri k di AVX-512 e i load mascherati evitano il padding.
+ *
+ * Con Fast la distanza viene da rsqrt con un passo di Newton, altrimenti da
+ * sqrt e divisioni vere come nel kernel scalare. Le somme di ogni boid
+ * differiscono comunque di al più SIMD_TOLERANCE (altro ordine delle somme).
+ */
+
+__attribute__((target("avx2,fma"), always_inline))
+inline float horizontalSumAvx2(const __m256 v) {
+    const __m128 sum4 = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    const __m128 sum2 = _mm_add_ps(sum4, _mm_movehl_ps(sum4, sum4));
+    return _mm_cvtss_f32(_mm_add_ss(sum2, _mm_shuffle_ps(sum2, sum2, 1)));
+}
+
+__attribute__((target("avx2,fma"), always_inline))
+inline int horizontalSumAvx2(const __m256i v) {
+    const __m128i sum4 = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    const __m128i sum2 = _mm_add_epi32(sum4, _mm_shuffle_epi32(sum4, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtsi128_si32(_mm_add_epi32(sum2, _mm_shuffle_epi32(sum2, _MM_SHUFFLE(2, 3, 0, 1))));
+}
+
+template<bool Fast = false>
+__attribute__((target("avx2,fma")))
+void accumulateRangeAvx2(const int i,
+                         const BoidSoA& current,
+                         const int begin,
+                         const int end,
+                         FlockSums& sums)
+{
+    const __m256 selfX = _mm256_set1_ps(current.posX[i]);
+    const __m256 selfY = _mm256_set1_ps(current.posY[i]);
+    const __m256 viewRadius = _mm256_set1_ps(VIEW_RADIUS);
+    const __m256 viewRadius2 = _mm256_set1_ps(VIEW_RADIUS * VIEW_RADIUS);
+    const __m256 separationRadius2 = _mm256_set1_ps(SEPARATION_RADIUS * SEPARATION_RADIUS);
+    const __m256 minDistance2 = _mm256_set1_ps(0.0001f * 0.0001f);
+    const __m256 tiny = _mm256_set1_ps(1e-30f);
+    const __m256 invViewRadius = _mm256_set1_ps(1.0f / VIEW_RADIUS);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 threeHalves = _mm256_set1_ps(1.5f);
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i self = _mm256_set1_epi32(i);
+    const __m256i last = _mm256_set1_epi32(end - 1);
+
+    __m256 sepX = _mm256_setzero_ps(), sepY = _mm256_setzero_ps();
+    __m256 aliX = _mm256_setzero_ps(), aliY = _mm256_setzero_ps();
+    __m256 cohX = _mm256_setzero_ps(), cohY = _mm256_setzero_ps();
+    __m256i sepCount = _mm256_setzero_si256();
+    __m256i viewCount = _mm256_setzero_si256();
+
+    for (int j = begin; j < end; j += 8) {
+        // Corsie valide: dentro [begin, end) e diverse da i
+        const __m256i index = _mm256_add_epi32(_mm256_set1_epi32(j), lane);
+        const __m256i valid = _mm256_andnot_si256(
+            _mm256_or_si256(_mm256_cmpgt_epi32(index, last), _mm256_cmpeq_epi32(index, self)),
+            _mm256_set1_epi32(-1));
+
+        const __m256 posX = _mm256_maskload_ps(current.posX.data() + j, valid);
+        const __m256 posY = _mm256_maskload_ps(current.posY.data() + j, valid);
+        const __m256 velX = _mm256_maskload_ps(current.velX.data() + j, valid);
+        const __m256 velY = _mm256_maskload_ps(current.velY.data() + j, valid);
+
+        const __m256 dx = _mm256_sub_ps(selfX, posX);
+        const __m256 dy = _mm256_sub_ps(selfY, posY);
+        const __m256 dist2 = _mm256_fmadd_ps(dx, dx, _mm256_mul_ps(dy, dy));
+
+        const __m256 inView = _mm256_and_ps(_mm256_castsi256_ps(valid), _mm256_cmp_ps(dist2, viewRadius2, _CMP_LT_OQ));
+        if (_mm256_testz_ps(inView, inView)) continue;
+
+        // dist2 = 0 dà dist = 0; factor = 1 / dist^3, infinito solo sotto minDistance2
+        __m256 dist, weight, factor;
+        if constexpr (Fast) {
+            // 1 / dist con rsqrt (12 bit) e un passo di Newton
+            const __m256 clamped = _mm256_max_ps(dist2, tiny);
+            __m256 invDist = _mm256_rsqrt_ps(clamped);
+            invDist = _mm256_mul_ps(invDist, _mm256_fnmadd_ps(_mm256_mul_ps(half, clamped),
+                                                              _mm256_mul_ps(invDist, invDist), threeHalves));
+            dist = _mm256_mul_ps(dist2, invDist);
+            weight = _mm256_fnmadd_ps(dist, invViewRadius, one);
+            factor = _mm256_mul_ps(invDist, _mm256_mul_ps(invDist, invDist));
+        } else {
+            dist = _mm256_sqrt_ps(dist2);
+            weight = _mm256_div_ps(_mm256_sub_ps(viewRadius, dist), viewRadius);
+            factor = _mm256_div_ps(one, _mm256_mul_ps(dist2, dist));
+        }
+
+        weight = _mm256_and_ps(inView, weight);
+        aliX = _mm256_fmadd_ps(velX, weight, aliX);
+        aliY = _mm256_fmadd_ps(velY, weight, aliY);
+        cohX = _mm256_add_ps(cohX, _mm256_and_ps(inView, posX));
+        cohY = _mm256_add_ps(cohY, _mm256_and_ps(inView, posY));
+        viewCount = _mm256_sub_epi32(viewCount, _mm256_castps_si256(inView));
+
+        const __m256 inSeparation = _mm256_and_ps(inView, _mm256_and_ps(
+            _mm256_cmp_ps(dist2, separationRadius2, _CMP_LT_OQ),
+            _mm256_cmp_ps(dist2, minDistance2, _CMP_GT_OQ)));
+        // (dx, dy) / dist / dist^2
+        factor = _mm256_and_ps(inSeparation, factor);
+        sepX = _mm256_fmadd_ps(dx, factor, sepX);
+        sepY = _mm256_fmadd_ps(dy, factor, sepY);
+        sepCount = _mm256_sub_epi32(sepCount, _mm256_castps_si256(inSeparation));
+    }
+
+    sums.separation = sums.separation + Vector2{horizontalSumAvx2(sepX), horizontalSumAvx2(sepY)};
+    sums.separationCount += horizontalSumAvx2(sepCount);
+    sums.alignment = sums.alignment + Vector2{horizontalSumAvx2(aliX), horizontalSumAvx2(aliY)};
+    sums.cohesion = sums.cohesion + Vector2{horizontalSumAvx2(cohX), horizontalSumAvx2(cohY)};
+    sums.viewCount += horizontalSumAvx2(viewCount);
+}
+
+template<bool Fast = false>
+__attribute__((target("avx512f")))
+void accumulateRangeAvx512(const int i,
+                           const BoidSoA& current,
+                           const int begin,
+                           const int end,
+                           FlockSums& sums)
+{
+    const __m512 selfX = _mm512_set1_ps(current.posX[i]);
+    const __m512 selfY = _mm512_set1_ps(current.posY[i]);
+    const __m512 viewRadius = _mm512_set1_ps(VIEW_RADIUS);
+    const __m512 viewRadius2 = _mm512_set1_ps(VIEW_RADIUS * VIEW_RADIUS);
+    const __m512 separationRadius2 = _mm512_set1_ps(SEPARATION_RADIUS * SEPARATION_RADIUS);
+    const __m512 minDistance2 = _mm512_set1_ps(0.0001f * 0.0001f);
+    const __m512 tiny = _mm512_set1_ps(1e-30f);
+    const __m512 invViewRadius = _mm512_set1_ps(1.0f / VIEW_RADIUS);
+    const __m512 one = _mm512_set1_ps(1.0f);
+    const __m512 half = _mm512_set1_ps(0.5f);
+    const __m512 threeHalves = _mm512_set1_ps(1.5f);
+
+    __m512 sepX = _mm512_setzero_ps(), sepY = _mm512_setzero_ps();
+    __m512 aliX = _mm512_setzero_ps(), aliY = _mm512_setzero_ps();
+    __m512 cohX = _mm512_setzero_ps(), cohY = _mm512_setzero_ps();
+    int sepCount = 0;
+    int viewCount = 0;
+
+    for (int j = begin; j < end; j += 16) {
+        // Corsie valide: dentro [begin, end) e diverse da i
+        __mmask16 valid = end - j >= 16 ? static_cast<__mmask16>(0xFFFF)
+                                        : static_cast<__mmask16>((1u << (end - j)) - 1);
+        if (i >= j && i < j + 16) valid &= static_cast<__mmask16>(~(1u << (i - j)));
+
+        const __m512 posX = _mm512_maskz_loadu_ps(valid, current.posX.data() + j);
+        const __m512 posY = _mm512_maskz_loadu_ps(valid, current.posY.data() + j);
+
+        const __m512 dx = _mm512_sub_ps(selfX, posX);
+        const __m512 dy = _mm512_sub_ps(selfY, posY);
+        const __m512 dist2 = _mm512_fmadd_ps(dx, dx, _mm512_mul_ps(dy, dy));
+
+        const __mmask16 inView = _mm512_mask_cmp_ps_mask(valid, dist2, viewRadius2, _CMP_LT_OQ);
+        if (inView == 0) continue;
+
+        const __m512 velX = _mm512_maskz_loadu_ps(inView, current.velX.data() + j);
+        const __m512 velY = _mm512_maskz_loadu_ps(inView, current.velY.data() + j);
+
+        // dist2 = 0 dà dist = 0; factor = 1 / dist^3, infinito solo sotto minDistance2
+        __m512 dist, weight, factor;
+        if constexpr (Fast) {
+            // 1 / dist con rsqrt14 e un passo di Newton
+            const __m512 clamped = _mm512_max_ps(dist2, tiny);
+            __m512 invDist = _mm512_rsqrt14_ps(clamped);
+            invDist = _mm512_mul_ps(invDist, _mm512_fnmadd_ps(_mm512_mul_ps(half, clamped),
+                                                              _mm512_mul_ps(invDist, invDist), threeHalves));
+            dist = _mm512_mul_ps(dist2, invDist);
+            weight = _mm512_fnmadd_ps(dist, invViewRadius, one);
+            factor = _mm512_mul_ps(invDist, _mm512_mul_ps(invDist, invDist));
+        } else {
+            dist = _mm512_sqrt_ps(dist2);
+            weight = _mm512_div_ps(_mm512_sub_ps(viewRadius, dist), viewRadius);
+            factor = _mm512_div_ps(one, _mm512_mul_ps(dist2, dist));
+        }
+
+        aliX = _mm512_mask3_fmadd_ps(velX, weight, aliX, inView);
+        aliY = _mm512_mask3_fmadd_ps(velY, weight, aliY, inView);
+        cohX = _mm512_mask_add_ps(cohX, inView, cohX, posX);
+        cohY = _mm512_mask_add_ps(cohY, inView, cohY, posY);
+        viewCount += __builtin_popcount(inView);
+
+        const __mmask16 inSeparation = _mm512_mask_cmp_ps_mask(
+            _mm512_mask_cmp_ps_mask(inView, dist2, separationRadius2, _CMP_LT_OQ),
+            dist2, minDistance2, _CMP_GT_OQ);
+        // (dx, dy) / dist / dist^2
+        sepX = _mm512_mask3_fmadd_ps(dx, factor, sepX, inSeparation);
+        sepY = _mm512_mask3_fmadd_ps(dy, factor, sepY, inSeparation);
+        sepCount += __builtin_popcount(inSeparation);
+    }
+
+    sums.separation = sums.separation + Vector2{_mm512_reduce_add_ps(sepX), _mm512_reduce_add_ps(sepY)};
+    sums.separationCount += sepCount;
+    sums.alignment = sums.alignment + Vector2{_mm512_reduce_add_ps(aliX), _mm512_reduce_add_ps(aliY)};
+    sums.cohesion = sums.cohesion + Vector2{_mm512_reduce_add_ps(cohX), _mm512_reduce_add_ps(cohY)};
+    sums.viewCount += viewCount;
+}
@@ -0,0 +1,159 @@
+//BoidsTeam.hpp
+#pragma once
+
+#include "BoidsNuma.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * Squadra di thread persistente, alternativa alle regioni OpenMP per i
+ * passi brevi (pochi boid): i thread nascono una volta, si fissano a una
+ * CPU (vedi pinCurrentThread) e si sincronizzano con una barriera a spin
+ * a inversione di senso, senza passare dal runtime. Ogni thread tiene i
+ * propri puntatori ai buffer e li scambia da sé dopo la barriera, quindi
+ * un passo costa un solo punto di sincronizzazione (niente single).
+ */
+
+/**
+ * Attesa sulla barriera:
+ * - Spin:  pause esponenziali (fino a SPIN_MAX_PAUSES per controllo), senza
+ *          mai cedere la CPU; la latenza minima con un thread per core
+ * - Yield: come Spin per SPIN_YIELD_AFTER controlli, poi sched_yield a ogni
+ *          controllo; necessario con più thread che core (default)
+ */
+enum class SpinBackoff { Spin, Yield };
+
+constexpr int SPIN_MAX_PAUSES = 64;
+constexpr int SPIN_YIELD_AFTER = 64;
+
+inline bool parseSpinBackoff(const char* name, SpinBackoff& backoff) {
+    if (std::strcmp(name, "spin") == 0) backoff = SpinBackoff::Spin;
+    else if (std::strcmp(name, "yield") == 0) backoff = SpinBackoff::Yield;
+    else return false;
+    return true;
+}
+
+inline const char* spinBackoffName(const SpinBackoff backoff) {
+    return backoff == SpinBackoff::Spin ? "spin" : "yield";
+}
+
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/**
+ * Barriera a inversione di senso: l'ultimo thread che arriva azzera il
+ * contatore e inverte il senso globale, gli altri attendono che il senso
+ * globale diventi il loro. Contatore, senso e sensi locali stanno su linee
+ * di cache separate.
+ */
+class SpinBarrier {
+public:
+    SpinBarrier(const int threads, const SpinBackoff backoff)
+        : threads{threads}, backoff{backoff}, localSense(threads), remaining{threads} {}
+
+    void wait(const int thread) {
+        const bool sense = localSense[thread].value = !localSense[thread].value;
+        if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            remaining.store(threads, std::memory_order_relaxed);
+            globalSense.store(sense, std::memory_order_release);
+            return;
+        }
+
+        int pauses = 1;
+        for (int polls = 0; globalSense.load(std::memory_order_acquire) != sense; ++polls) {
+            if (backoff == SpinBackoff::Yield && polls >= SPIN_YIELD_AFTER) {
+                std::this_thread::yield();
+                continue;
+            }
+            for (int p = 0; p < pauses; ++p) cpuRelax();
+            pauses = std::min(2 * pauses, SPIN_MAX_PAUSES);
+        }
+    }
+
+private:
+    struct alignas(64) PaddedSense {
+        bool value = false;
+    };
+
+    const int threads;
+    const SpinBackoff backoff;
+    std::vector<PaddedSense> localSense;
+    alignas(64) std::atomic<int> remaining;
+    alignas(64) std::atomic<bool> globalSense{false};
+};
+
+/**
+ * I thread 1 .. threads-1 attendono un lavoro sulla barriera; run(body)
+ * esegue body(thread) su tutti, il chiamante come thread 0, e ritorna
+ * quando tutti hanno finito (due passaggi di barriera per run, nessuno
+ * per passo oltre a quelli di body).
+ */
+class ThreadTeam {
+public:
+    ThreadTeam(const int threads, const SpinBackoff backoff)
+        : threads{threads}, barrier_{threads, backoff}, pinnedThreads{0}
+    {
+        // Il thread 0 si fissa per ultimo: i nuovi thread ereditano la sua affinità
+        for (int t = 1; t < threads; ++t) {
+            workers.emplace_back([this, t] {
+                if (pinCurrentThread(t)) pinnedThreads++;
+                barrier_.wait(t);
+                while (true) {
+                    barrier_.wait(t);
+                    if (stopping) break;
+                    job(context, t);
+                    barrier_.wait(t);
+                }
+            });
+        }
+        if (pinCurrentThread(0)) pinnedThreads++;
+        barrier_.wait(0); // tutti fissati prima del primo run
+    }
+
+    ~ThreadTeam() {
+        stopping = true;
+        barrier_.wait(0);
+        for (std::thread& worker : workers) worker.join();
+    }
+
+    ThreadTeam(const ThreadTeam&) = delete;
+    ThreadTeam& operator=(const ThreadTeam&) = delete;
+
+    [[nodiscard]] int size() const { return threads; }
+    [[nodiscard]] bool pinned() const { return pinnedThreads == threads; }
+
+    // Barriera per body: wait(thread) con l'indice ricevuto da run
+    void wait(const int thread) { barrier_.wait(thread); }
+
+    // Intervallo [begin, end) del thread su n elementi, come schedule(static)
+    [[nodiscard]] std::pair<int, int> range(const int thread, const int n) const {
+        return {static_cast<int>(static_cast<long long>(n) * thread / threads),
+                static_cast<int>(static_cast<long long>(n) * (thread + 1) / threads)};
+    }
+
+    template<typename Body>
+    void run(Body& body) {
+        context = &body;
+        job = [](void* ctx, const int thread) { (*static_cast<Body*>(ctx))(thread); };
+        barrier_.wait(0);
+        body(0);
+        barrier_.wait(0);
+    }
+
+private:
+    const int threads;
+    SpinBarrier barrier_;
+    std::atomic<int> pinnedThreads;
+    std::vector<std::thread> workers;
+    // Scritti dal thread 0 prima della barriera di partenza
+    void (*job)(void*, int) = nullptr;
+    void* context = nullptr;
+    bool stopping = false;
+};
@@ -1,174 +1,204 @@
 //BoidsUpdateSOA.hpp
 #pragma once
 #include "BoidsSOA.hpp"
+#include "BoidsSimd.hpp"
+#include "BoidsSimdSOA.hpp"
+#include <algorithm>
+#include <utility>
+#include <vector>
 #include <omp.h>
 
-// Calcolo separazione con SIMD e riduzioni esplicite
-inline Vector2 separation(const int i,
-                          const BoidSoA& current,
-                          const int numBoids)
-{
-    const float selfX = current.posX[i];
-    const float selfY = current.posY[i];
-    const float velX = current.velX[i];
-    const float velY = current.velY[i];
-
-    float steerX = 0.0f;
-    float steerY = 0.0f;
-    int count = 0;
-
-    #pragma omp simd reduction(+:steerX, steerY, count)
-    for (int j = 0; j < numBoids; ++j) {
-        if (i == j) continue;
-
-        const float dx = selfX - current.posX[j];
-        const float dy = selfY - current.posY[j];
-
-        if (const float dist = std::sqrt(dx * dx + dy * dy); dist < SEPARATION_RADIUS && dist > 0.0001f) {
-            const float factor = 1.0f / (dist * dist);
-            steerX += dx / dist * factor;
-            steerY += (dy / dist) * factor;
-            count++;
+// Porta (x, y) a MAX_SPEED, sottrae la velocità e limita a MAX_FORCE.
+// Un vettore nullo resta nullo (stessa convenzione delle regole SoA separate).
+// Con Fast le norme usano fastInvSqrt (vedi Precision).
+template<bool Fast = false>
+inline Vector2 steerSoA(float x, float y, const float velX, const float velY) {
+    if constexpr (Fast) {
+        if (const float length2 = x * x + y * y; length2 > 0.0f) {
+            Vector2 steer = Vector2{x, y} * (MAX_SPEED * fastInvSqrt(length2)) - Vector2{velX, velY};
+            fastLimit(steer, MAX_FORCE);
+            return steer;
         }
+        return {x, y};
     }
 
-    if (count > 0) {
-        steerX /= static_cast<float>(count);
-        steerY /= static_cast<float>(count);
+    if (const float mag = std::sqrt(x * x + y * y); mag > 0.0f) {
+        x = x / mag * MAX_SPEED - velX;
+        y = y / mag * MAX_SPEED - velY;
 
-        if (const float mag = std::sqrt(steerX * steerX + steerY * steerY); mag > 0.0f) {
-            steerX = steerX / mag * MAX_SPEED - velX;
-            steerY = steerY / mag * MAX_SPEED - velY;
-
-            if (const float finalMag = std::sqrt(steerX * steerX + steerY * steerY); finalMag > MAX_FORCE) {
-                steerX = steerX / finalMag * MAX_FORCE;
-                steerY = steerY / finalMag * MAX_FORCE;
-            }
+        if (const float finalMag = std::sqrt(x * x + y * y); finalMag > MAX_FORCE) {
+            x = x / finalMag * MAX_FORCE;
+            y = y / finalMag * MAX_FORCE;
         }
     }
-
-    return {steerX, steerY};
+    return {x, y};
 }
 
-// Calcolo allineamento con SIMD e riduzioni
-inline Vector2 alignment(const int i,
-                         const BoidSoA& current,
-                         const int numBoids)
+// Chiude le tre regole a partire dalle somme (medie, steering, pesi)
+template<bool Fast = false>
+inline Vector2 flockAccelerationFromSumsSoA(const FlockSums& sums,
+                                            const float selfX, const float selfY,
+                                            const float velX, const float velY)
 {
-    const float selfX = current.posX[i];
-    const float selfY = current.posY[i];
-    const float velX = current.velX[i];
-    const float velY = current.velY[i];
-
-    float sumX = 0.0f;
-    float sumY = 0.0f;
-    int count = 0;
+    Vector2 sep{0.0f, 0.0f};
+    Vector2 ali{0.0f, 0.0f};
+    Vector2 coh{0.0f, 0.0f};
 
-    #pragma omp simd reduction(+:sumX, sumY, count)
-    for (int j = 0; j < numBoids; ++j) {
-        if (i == j) continue;
-
-        const float dx = selfX - current.posX[j];
-        const float dy = selfY - current.posY[j];
-
-        if (const float dist = std::sqrt(dx * dx + dy * dy); dist < VIEW_RADIUS) {
-            const float weight = (VIEW_RADIUS - dist) / VIEW_RADIUS;
-            sumX += current.velX[j] * weight;
-            sumY += current.velY[j] * weight;
-            count++;
-        }
+    if (sums.separationCount > 0) {
+        const auto count = static_cast<float>(sums.separationCount);
+        sep = steerSoA<Fast>(sums.separation.x / count, sums.separation.y / count, velX, velY);
     }
-
-    if (count > 0) {
-        sumX /= static_cast<float>(count);
-        sumY /= static_cast<float>(count);
-
-        if (const float mag = std::sqrt(sumX * sumX + sumY * sumY); mag > 0.0f) {
-            sumX = sumX / mag * MAX_SPEED - velX;
-            sumY = sumY / mag * MAX_SPEED - velY;
-
-            if (const float finalMag = std::sqrt(sumX * sumX + sumY * sumY); finalMag > MAX_FORCE) {
-                sumX = sumX / finalMag * MAX_FORCE;
-                sumY = sumY / finalMag * MAX_FORCE;
-            }
-        }
-        return {sumX, sumY};
+    if (sums.viewCount > 0) {
+        const auto count = static_cast<float>(sums.viewCount);
+        ali = steerSoA<Fast>(sums.alignment.x / count, sums.alignment.y / count, velX, velY);
+        coh = steerSoA<Fast>(sums.cohesion.x / count - selfX, sums.cohesion.y / count - selfY, velX, velY);
     }
 
-    return {0.0f, 0.0f};
+    Vector2 acceleration = sep * SEPARATION_WEIGHT + ali * ALIGNMENT_WEIGHT + coh * COHESION_WEIGHT;
+    if constexpr (Fast) fastLimit(acceleration, MAX_FORCE);
+    else acceleration.limit(MAX_FORCE);
+    return acceleration;
 }
 
-// Calcolo coesione con SIMD e riduzioni
-inline Vector2 cohesion(const int i,
-                        const BoidSoA& current,
-                        const int numBoids)
+// Separazione, allineamento e coesione in un'unica passata SIMD sulle
+// sorgenti [begin, end): una sola distanza (e un solo sqrt) per coppia.
+// Le somme vengono aggiunte a sums, così le sorgenti si possono dividere a blocchi.
+// Con Fast i raggi si confrontano su dist^2 e la radice è fastInvSqrt.
+template<bool Fast = false>
+inline void accumulateRangeSoA(const int i,
+                               const BoidSoA& current,
+                               const int begin,
+                               const int end,
+                               FlockSums& sums)
 {
     const float selfX = current.posX[i];
     const float selfY = current.posY[i];
-    const float velX = current.velX[i];
-    const float velY = current.velY[i];
 
-    float centerX = 0.0f;
-    float centerY = 0.0f;
-    int count = 0;
+    float sepX = 0.0f, sepY = 0.0f;
+    float aliX = 0.0f, aliY = 0.0f;
+    float cohX = 0.0f, cohY = 0.0f;
+    int sepCount = 0;
+    int viewCount = 0;
 
-    #pragma omp simd reduction(+:centerX, centerY, count)
-    for (int j = 0; j < numBoids; ++j) {
+    #pragma omp simd reduction(+:sepX, sepY, aliX, aliY, cohX, cohY, sepCount, viewCount)
+    for (int j = begin; j < end; ++j) {
         if (i == j) continue;
 
         const float dx = selfX - current.posX[j];
         const float dy = selfY - current.posY[j];
 
-        if (const float dist = std::sqrt(dx * dx + dy * dy); dist < VIEW_RADIUS) {
-            centerX += current.posX[j];
-            centerY += current.posY[j];
-            count++;
+        if constexpr (Fast) {
+            const float dist2 = dx * dx + dy * dy;
+            if (dist2 < VIEW_RADIUS * VIEW_RADIUS) {
+                const float invDist = fastInvSqrt(std::max(dist2, 1e-30f));
+                const float weight = 1.0f - dist2 * invDist * (1.0f / VIEW_RADIUS);
+                aliX += current.velX[j] * weight;
+                aliY += current.velY[j] * weight;
+                cohX += current.posX[j];
+                cohY += current.posY[j];
+                viewCount++;
+
+                if (dist2 < SEPARATION_RADIUS * SEPARATION_RADIUS && dist2 > 0.0001f * 0.0001f) {
+                    const float factor = invDist * invDist * invDist;
+                    sepX += dx * factor;
+                    sepY += dy * factor;
+                    sepCount++;
+                }
+            }
+        } else if (const float dist = std::sqrt(dx * dx + dy * dy); dist < VIEW_RADIUS) {
+            const float weight = (VIEW_RADIUS - dist) / VIEW_RADIUS;
+            aliX += current.velX[j] * weight;
+            aliY += current.velY[j] * weight;
+            cohX += current.posX[j];
+            cohY += current.posY[j];
+            viewCount++;
+
+            if (dist < SEPARATION_RADIUS && dist > 0.0001f) {
+                const float factor = 1.0f / (dist * dist);
+                sepX += dx / dist * factor;
+                sepY += (dy / dist) * factor;
+                sepCount++;
+            }
         }
     }
 
-    if (count > 0) {
-        centerX /= static_cast<float>(count);
-        centerY /= static_cast<float>(count);
-
-        float desiredX = centerX - selfX;
-        float desiredY = centerY - selfY;
-
-        if (const float mag = std::sqrt(desiredX * desiredX + desiredY * desiredY); mag > 0.0f) {
-            desiredX = desiredX / mag * MAX_SPEED - velX;
-            desiredY = desiredY / mag * MAX_SPEED - velY;
+    sums.separation = sums.separation + Vector2{sepX, sepY};
+    sums.separationCount += sepCount;
+    sums.alignment = sums.alignment + Vector2{aliX, aliY};
+    sums.cohesion = sums.cohesion + Vector2{cohX, cohY};
+    sums.viewCount += viewCount;
+}
 
-            if (const float finalMag = std::sqrt(desiredX * desiredX + desiredY * desiredY); finalMag > MAX_FORCE) {
-                desiredX = desiredX / finalMag * MAX_FORCE;
-                desiredY = desiredY / finalMag * MAX_FORCE;
-            }
-        }
-        return {desiredX, desiredY};
+// Stessa passata con il tipo SIMD portabile, per l'ISA sse (avx2 e avx512
+// usano i kernel di BoidsSimdSOA.hpp): W sorgenti per iterazione con load
+// allineati. begin è multiplo di W ed end è multiplo di W oppure size():
+// l'ultimo vettore legge i boid sentinella del padding, senza maschera di coda
+template<int W, bool Fast = false>
+[[gnu::always_inline]] inline void accumulateRangeSimd(const int i,
+                                const BoidSoA& current,
+                                const int begin,
+                                const int end,
+                                FlockSums& sums)
+{
+    using V = Simd<W>;
+    BOIDS_DEBUG_ASSERT(begin % W == 0 && (end % W == 0 || end == current.size()));
+    const typename V::Float selfX = V::broadcast(current.posX[i]);
+    const typename V::Float selfY = V::broadcast(current.posY[i]);
+    const typename V::Mask lanes = V::lanes();
+
+    FlockSumsSimd<W> acc;
+    for (int j = begin; j < end; j += W) {
+        accumulateNeighborsSimd<W, Fast>(acc, selfX, selfY,
+            V::loadAligned(current.posX.data() + j), V::loadAligned(current.posY.data() + j),
+            V::loadAligned(current.velX.data() + j), V::loadAligned(current.velY.data() + j), lanes + j != i);
+    }
+    acc.reduceInto(sums);
+}
+// Kernel della passata fusa, scelto all'avvio in base all'ISA e alla precisione
+using RangeKernelSoA = void (*)(int, const BoidSoA&, int, int, FlockSums&);
+
+template<bool Fast>
+inline RangeKernelSoA selectRangeKernelSoA(const SimdIsa isa) {
+    switch (isa) {
+        case SimdIsa::Avx512: return accumulateRangeAvx512<Fast>;
+        case SimdIsa::Avx2:   return accumulateRangeAvx2<Fast>;
+        case SimdIsa::Sse:    return SimdTargets<accumulateRangeSimd<4, Fast>>::generic;
+        default:              return accumulateRangeSoA<Fast>;
     }
+}
 
-    return {0.0f, 0.0f};
+inline RangeKernelSoA selectRangeKernelSoA(const SimdIsa isa, const Precision precision = Precision::Exact) {
+    return precision == Precision::Fast ? selectRangeKernelSoA<true>(isa) : selectRangeKernelSoA<false>(isa);
 }
 
-// Funzione principale per aggiornare un boid
-inline void computeNextBoidSoA(const int i,
-                            const BoidSoA& oldState,
-                            BoidSoA& newState,
-                            const int numBoids)
+// Fast deve essere la precisione con cui è stato scelto kernel
+template<bool Fast = false>
+inline Vector2 flockAccelerationSoA(const int i,
+                                    const BoidSoA& current,
+                                    const int numBoids,
+                                    const RangeKernelSoA kernel = accumulateRangeSoA)
 {
-    const Vector2 sep = separation(i, oldState, numBoids) * SEPARATION_WEIGHT;
-    const Vector2 ali = alignment(i, oldState, numBoids) * ALIGNMENT_WEIGHT;
-    const Vector2 coh = cohesion(i, oldState, numBoids) * COHESION_WEIGHT;
-
-    Vector2 acceleration = sep + ali + coh;
-    acceleration.limit(MAX_FORCE);
+    FlockSums sums;
+    kernel(i, current, 0, numBoids, sums);
+    return flockAccelerationFromSumsSoA<Fast>(sums, current.posX[i], current.posY[i], current.velX[i], current.velY[i]);
+}
 
+// Integrazione e wrap-around del boid i, comuni a tutte le varianti SoA
+template<bool Fast = false>
+inline void integrateBoidSoA(const int i,
+                             const Vector2& acceleration,
+                             const BoidSoA& oldState,
+                             BoidSoA& newState)
+{
     Vector2 velocity{oldState.velX[i], oldState.velY[i]};
     velocity = velocity + acceleration;
-    velocity.limit(MAX_SPEED);
+    if constexpr (Fast) fastLimit(velocity, MAX_SPEED);
+    else velocity.limit(MAX_SPEED);
 
     Vector2 position{oldState.posX[i], oldState.posY[i]};
     position = position + velocity;
 
-    constexpr float margin = 5.0f;
+    constexpr float margin = WRAP_MARGIN;
     if (position.x < -margin) position.x = WIDTH + margin;
     else if (position.x > WIDTH + margin) position.x = -margin;
 
@@ -181,3 +211,339 @@ inline void computeNextBoidSoA(const int i,
     newState.velX[i] = velocity.x;
     newState.velY[i] = velocity.y;
 }
+
+// Funzione principale per aggiornare un boid
+template<bool Fast = false>
+inline void computeNextBoidSoA(const int i,
+                            const BoidSoA& oldState,
+                            BoidSoA& newState,
+                            const int numBoids,
+                            const RangeKernelSoA kernel = accumulateRangeSoA)
+{
+    const Vector2 acceleration = flockAccelerationSoA<Fast>(i, oldState, numBoids, kernel);
+    integrateBoidSoA<Fast>(i, acceleration, oldState, newState);
+}
+
+/**
+ * Vettorizzazione sul loop esterno: ogni corsia è un boid bersaglio
+ * (targetBegin + lane), ogni sorgente j viene trasmessa a tutte le corsie.
+ * Le somme restano per corsia, senza riduzione orizzontale, e chiusura,
+ * integrazione e wrap sono anch'esse vettoriali (integrateBoidsSimd): conta
+ * quando i vicini per boid sono pochi e l'epilogo scalare pesa.
+ * Il padding di BoidSoA permette un load intero da qualsiasi targetBegin;
+ * le corsie oltre count (sentinelle o boid di un'altra cella) vengono
+ * spostate in SENTINEL_POSITION, così non tengono vivi i vicini che
+ * accumulateNeighborsSimd scarterebbe, e non vengono scritte.
+ */
+template<int W>
+[[gnu::always_inline]] inline BoidLanes<W> loadTargetsSoA(const int targetBegin, const BoidSoA& state, const int count) {
+    using V = Simd<W>;
+    BoidLanes<W> targets{V::load(state.posX.data() + targetBegin), V::load(state.posY.data() + targetBegin),
+                         V::load(state.velX.data() + targetBegin), V::load(state.velY.data() + targetBegin)};
+    if (count < W) {
+        const typename V::Mask active = V::lanes() < count;
+        targets.posX = V::select(active, targets.posX, V::broadcast(SENTINEL_POSITION));
+        targets.posY = V::select(active, targets.posY, V::broadcast(SENTINEL_POSITION));
+    }
+    return targets;
+}
+
+// Scrive le prime count corsie nello stato a partire da targetBegin
+template<int W>
+[[gnu::always_inline]] inline void storeTargetsSoA(const int targetBegin, BoidSoA& state, const BoidLanes<W>& lanes, const int count) {
+    using V = Simd<W>;
+    if (count >= W) {
+        V::store(state.posX.data() + targetBegin, lanes.posX);
+        V::store(state.posY.data() + targetBegin, lanes.posY);
+        V::store(state.velX.data() + targetBegin, lanes.velX);
+        V::store(state.velY.data() + targetBegin, lanes.velY);
+    } else {
+        V::storePartial(state.posX.data() + targetBegin, lanes.posX, count);
+        V::storePartial(state.posY.data() + targetBegin, lanes.posY, count);
+        V::storePartial(state.velX.data() + targetBegin, lanes.velX, count);
+        V::storePartial(state.velY.data() + targetBegin, lanes.velY, count);
+    }
+}
+
+// Sorgenti [begin, end) traslate di (shiftX, shiftY) sulle corsie dei bersagli
+// [targetBegin, targetBegin + W). Solo le sorgenti dentro quel blocco possono
+// essere il bersaglio stesso: fuori la maschera è costante, senza confronti
+// per coppia
+template<int W, bool Fast = false>
+[[gnu::always_inline]] inline void accumulateTargetsSoA(FlockSumsSimd<W>& acc,
+                                                       const BoidLanes<W>& targets,
+                                                       const int targetBegin,
+                                                       const BoidSoA& source,
+                                                       const int begin,
+                                                       const int end,
+                                                       const float shiftX = 0.0f,
+                                                       const float shiftY = 0.0f)
+{
+    using V = Simd<W>;
+    const typename V::Mask allValid = ~typename V::Mask{};
+    const typename V::Mask targetIndex = V::lanes() + targetBegin;
+
+    const auto visit = [&](const int from, const int to, const bool selfPossible) __attribute__((always_inline)) {
+        for (int j = from; j < to; ++j) {
+            accumulateNeighborsSimd<W, Fast>(acc, targets.posX, targets.posY,
+                V::broadcast(source.posX[j] + shiftX), V::broadcast(source.posY[j] + shiftY),
+                V::broadcast(source.velX[j]), V::broadcast(source.velY[j]),
+                selfPossible ? targetIndex != j : allValid);
+        }
+    };
+
+    const int blockBegin = std::clamp(targetBegin, begin, end);
+    const int blockEnd = std::clamp(targetBegin + W, begin, end);
+    visit(begin, blockBegin, false);
+    visit(blockBegin, blockEnd, true);
+    visit(blockEnd, end, false);
+}
+
+// Somme dei bersagli [targetBegin, targetBegin + W) contro tutti i boid (per il controllo)
+template<int W, bool Fast = false>
+[[gnu::always_inline]] inline void accumulateTargetsAllSoA(const int targetBegin,
+                                                          const BoidSoA& current,
+                                                          const int numBoids,
+                                                          FlockSums* sums)
+{
+    const int count = std::min(W, numBoids - targetBegin);
+    FlockSumsSimd<W> acc;
+    accumulateTargetsSoA<W, Fast>(acc, loadTargetsSoA<W>(targetBegin, current, count), targetBegin, current, 0, numBoids);
+    for (int lane = 0; lane < count; ++lane) acc.laneInto(lane, sums[lane]);
+}
+
+// Passo completo per i bersagli [targetBegin, targetBegin + W)
+template<int W, bool Fast = false>
+[[gnu::always_inline]] inline void computeTargetsOuterSoA(const int targetBegin,
+                                                         const BoidSoA& oldState,
+                                                         BoidSoA& newState,
+                                                         const int numBoids)
+{
+    const int count = std::min(W, numBoids - targetBegin);
+    const BoidLanes<W> targets = loadTargetsSoA<W>(targetBegin, oldState, count);
+
+    FlockSumsSimd<W> acc;
+    accumulateTargetsSoA<W, Fast>(acc, targets, targetBegin, oldState, 0, numBoids);
+
+    BoidLanes<W> next;
+    integrateBoidsSimd<W, Fast>(acc, targets, next);
+    storeTargetsSoA<W>(targetBegin, newState, next, count);
+}
+
+// Kernel della variante outer, a blocchi di simdIsaWidth(isa) bersagli
+using OuterStepKernelSoA = void (*)(int, const BoidSoA&, BoidSoA&, int);
+using OuterSumsKernelSoA = void (*)(int, const BoidSoA&, int, FlockSums*);
+
+template<bool Fast>
+inline OuterStepKernelSoA selectOuterStepKernelSoA(const SimdIsa isa) {
+    switch (isa) {
+        case SimdIsa::Avx512: return SimdTargets<computeTargetsOuterSoA<16, Fast>>::avx512;
+        case SimdIsa::Avx2:   return SimdTargets<computeTargetsOuterSoA<8, Fast>>::avx2;
+        default:              return SimdTargets<computeTargetsOuterSoA<4, Fast>>::generic;
+    }
+}
+
+inline OuterStepKernelSoA selectOuterStepKernelSoA(const SimdIsa isa, const Precision precision = Precision::Exact) {
+    return precision == Precision::Fast ? selectOuterStepKernelSoA<true>(isa) : selectOuterStepKernelSoA<false>(isa);
+}
+
+template<bool Fast>
+inline OuterSumsKernelSoA selectOuterSumsKernelSoA(const SimdIsa isa) {
+    switch (isa) {
+        case SimdIsa::Avx512: return SimdTargets<accumulateTargetsAllSoA<16, Fast>>::avx512;
+        case SimdIsa::Avx2:   return SimdTargets<accumulateTargetsAllSoA<8, Fast>>::avx2;
+        default:              return SimdTargets<accumulateTargetsAllSoA<4, Fast>>::generic;
+    }
+}
+
+inline OuterSumsKernelSoA selectOuterSumsKernelSoA(const SimdIsa isa, const Precision precision = Precision::Exact) {
+    return precision == Precision::Fast ? selectOuterSumsKernelSoA<true>(isa) : selectOuterSumsKernelSoA<false>(isa);
+}
+
+/**
+ * Variante triangolare: ogni coppia (i, j) si valuta una volta sola e i
+ * contributi vanno a entrambi i boid, dimezzando le distanze. I boid sono
+ * divisi in 2T blocchi e le coppie di blocchi si visitano come un torneo
+ * all'italiana (pairBlocksSoA): a ogni turno i thread trattano coppie di
+ * blocchi disgiunte, quindi scrivono da soli negli accumulatori condivisi
+ * dei propri due blocchi. Gli accumulatori sono N (non T x N), in layout
+ * SoA come lo stato, e la riduzione per boid è una sola lettura.
+ */
+struct PairSumsSoA {
+    StateArray sepX, sepY, aliX, aliY, cohX, cohY;
+    IndexArray sepCount, viewCount;
+
+    // Non inizializzati: le pagine restano al first-touch di clear
+    explicit PairSumsSoA(const int n) {
+        for (StateArray* array : {&sepX, &sepY, &aliX, &aliY, &cohX, &cohY}) resizeUninitialized(*array, n);
+        resizeUninitialized(sepCount, n);
+        resizeUninitialized(viewCount, n);
+    }
+
+    void clear(const int i) {
+        sepX[i] = sepY[i] = aliX[i] = aliY[i] = cohX[i] = cohY[i] = 0.0f;
+        sepCount[i] = viewCount[i] = 0;
+    }
+
+    // Legge le somme del boid i e le azzera per il passo successivo
+    void drainInto(const int i, FlockSums& sums) {
+        sums.separation = sums.separation + Vector2{sepX[i], sepY[i]};
+        sums.separationCount += sepCount[i];
+        sums.alignment = sums.alignment + Vector2{aliX[i], aliY[i]};
+        sums.cohesion = sums.cohesion + Vector2{cohX[i], cohY[i]};
+        sums.viewCount += viewCount[i];
+        clear(i);
+    }
+};
+
+// Primo boid del blocco block su numBlocks (numBoids per block == numBlocks)
+inline int pairBlockBegin(const int block, const int numBlocks, const int numBoids) {
+    return static_cast<int>(static_cast<long long>(numBoids) * block / numBlocks);
+}
+
+/**
+ * Turno round (0 .. numBlocks - 2) del torneo tra numBlocks blocchi (pari),
+ * con il metodo del cerchio: il blocco numBlocks - 1 resta fermo e gli altri
+ * ruotano. Restituisce la coppia di blocchi del thread (0 .. numBlocks / 2 - 1);
+ * in numBlocks - 1 turni ogni coppia di blocchi diversi esce una volta sola.
+ */
+inline std::pair<int, int> pairBlocksSoA(const int round, const int thread, const int numBlocks) {
+    const int cycle = numBlocks - 1;
+    if (thread == 0) return {cycle, round};
+    return {(round + thread) % cycle, (round - thread + cycle) % cycle};
+}
+
+// Coppie (i, j) della riga i con j in [jBegin, jEnd), i escluso;
+// restituisce il numero di distanze calcolate
+template<bool Fast = false>
+inline int accumulateRowPairsSoA(const int i,
+                                 const int jBegin,
+                                 const int jEnd,
+                                 const BoidSoA& current,
+                                 PairSumsSoA& acc)
+{
+    const float selfX = current.posX[i];
+    const float selfY = current.posY[i];
+    const float selfVelX = current.velX[i];
+    const float selfVelY = current.velY[i];
+
+    float sepX = 0.0f, sepY = 0.0f;
+    float aliX = 0.0f, aliY = 0.0f;
+    float cohX = 0.0f, cohY = 0.0f;
+    int sepCount = 0;
+    int viewCount = 0;
+
+    float* const accSepX = acc.sepX.data();
+    float* const accSepY = acc.sepY.data();
+    float* const accAliX = acc.aliX.data();
+    float* const accAliY = acc.aliY.data();
+    float* const accCohX = acc.cohX.data();
+    float* const accCohY = acc.cohY.data();
+    int* const accSepCount = acc.sepCount.data();
+    int* const accViewCount = acc.viewCount.data();
+
+    #pragma omp simd reduction(+:sepX, sepY, aliX, aliY, cohX, cohY, sepCount, viewCount)
+    for (int j = jBegin; j < jEnd; ++j) {
+        const float dx = selfX - current.posX[j];
+        const float dy = selfY - current.posY[j];
+        const float dist2 = dx * dx + dy * dy;
+        const float invDist = Fast ? fastInvSqrt(std::max(dist2, 1e-30f)) : 0.0f;
+        const float dist = Fast ? dist2 * invDist : std::sqrt(dist2);
+
+        if (Fast ? dist2 < VIEW_RADIUS * VIEW_RADIUS : dist < VIEW_RADIUS) {
+            const float weight = (VIEW_RADIUS - dist) / VIEW_RADIUS;
+            aliX += current.velX[j] * weight;
+            aliY += current.velY[j] * weight;
+            accAliX[j] += selfVelX * weight;
+            accAliY[j] += selfVelY * weight;
+
+            cohX += current.posX[j];
+            cohY += current.posY[j];
+            accCohX[j] += selfX;
+            accCohY[j] += selfY;
+            viewCount++;
+            accViewCount[j]++;
+
+            // Separazione antisimmetrica
+            if (dist < SEPARATION_RADIUS && dist > 0.0001f) {
+                const float factor = Fast ? invDist * invDist * invDist : 1.0f / (dist * dist);
+                const float pushX = Fast ? dx * factor : dx / dist * factor;
+                const float pushY = Fast ? dy * factor : dy / dist * factor;
+                sepX += pushX;
+                sepY += pushY;
+                accSepX[j] -= pushX;
+                accSepY[j] -= pushY;
+                sepCount++;
+                accSepCount[j]++;
+            }
+        }
+    }
+
+    accSepX[i] += sepX;
+    accSepY[i] += sepY;
+    accAliX[i] += aliX;
+    accAliY[i] += aliY;
+    accCohX[i] += cohX;
+    accCohY[i] += cohY;
+    accSepCount[i] += sepCount;
+    accViewCount[i] += viewCount;
+    return jEnd - jBegin;
+}
+
+// Legge (e azzera per il passo successivo) le somme del boid i, poi chiude e integra
+template<bool Fast>
+inline void finishBoidPairsSoA(const int i,
+                               const BoidSoA& oldState,
+                               BoidSoA& newState,
+                               PairSumsSoA& pairSums)
+{
+    FlockSums sums;
+    pairSums.drainInto(i, sums);
+
+    const Vector2 acceleration = flockAccelerationFromSumsSoA<Fast>(sums,
+        oldState.posX[i], oldState.posY[i], oldState.velX[i], oldState.velY[i]);
+    integrateBoidSoA<Fast>(i, acceleration, oldState, newState);
+}
+
+/**
+ * Variante a blocchi del brute force: un blocco di boid bersaglio
+ * [targetBegin, targetEnd) viene confrontato con un tile di sorgenti alla
+ * volta (sourceTile boid, 16 byte ciascuno), che resta in cache per tutti i
+ * bersagli del blocco invece di essere riletto da L3/DRAM per ogni i.
+ * blockSums (almeno targetEnd - targetBegin elementi, privato del thread)
+ * tiene le somme parziali; lo steering si chiude dopo l'ultimo tile.
+ * sourceTile va arrotondato a SOA_PADDING (sourceTileSoA): i kernel SIMD
+ * leggono vettori interi fino al bordo del tile.
+ */
+constexpr int DEFAULT_TARGET_TILE = 256;
+constexpr int DEFAULT_SOURCE_TILE = 2048;
+
+inline int sourceTileSoA(const int requested) {
+    return (requested + SOA_PADDING - 1) / SOA_PADDING * SOA_PADDING;
+}
+
+template<bool Fast>
+inline void computeBlockTiledSoA(const int targetBegin,
+                                 const int targetEnd,
+                                 const BoidSoA& oldState,
+                                 BoidSoA& newState,
+                                 const int numBoids,
+                                 const int sourceTile,
+                                 std::vector<FlockSums>& blockSums,
+                                 const RangeKernelSoA kernel = accumulateRangeSoA)
+{
+    std::fill(blockSums.begin(), blockSums.begin() + (targetEnd - targetBegin), FlockSums{});
+
+    for (int sourceBegin = 0; sourceBegin < numBoids; sourceBegin += sourceTile) {
+        const int sourceEnd = std::min(numBoids, sourceBegin + sourceTile);
+        for (int i = targetBegin; i < targetEnd; ++i) {
+            kernel(i, oldState, sourceBegin, sourceEnd, blockSums[i - targetBegin]);
+        }
+    }
+
+    for (int i = targetBegin; i < targetEnd; ++i) {
+        const Vector2 acceleration = flockAccelerationFromSumsSoA<Fast>(blockSums[i - targetBegin],
+            oldState.posX[i], oldState.posY[i], oldState.velX[i], oldState.velY[i]);
+        integrateBoidSoA<Fast>(i, acceleration, oldState, newState);
+    }
+}
@@ -0,0 +1,146 @@
+//BoidsVerlet.hpp
+#pragma once
+
+#include "BoidsGrid.hpp"
+#include <vector>
+
+/**
+ * Liste di vicini di Verlet: per ogni boid i candidati entro VIEW_RADIUS + skin,
+ * in formato CSR (neighbors[offsets[i] .. offsets[i + 1])). Le liste restano
+ * valide finché nessun boid si è spostato più di skin / 2 dall'ultima
+ * costruzione: due boid ora entro VIEW_RADIUS distavano al più VIEW_RADIUS + skin.
+ * Candidati e spostamenti si misurano sempre sul toro (immagine minima),
+ * anche senza periodicità: un boid che attraversa il bordo (wrap-around)
+ * si sposta di poco sul toro, e i vicini che trova dall'altra parte erano
+ * già nelle liste. Senza periodicità le forze restano sulle distanze dirette,
+ * che scartano i candidati oltre il bordo.
+ */
+struct VerletLists {
+    float skin;
+    std::vector<int> offsets;
+    std::vector<int> neighbors;
+    std::vector<Vector2> positionAtBuild;
+
+    VerletLists(const int numBoids, const float skin) : skin{skin} {
+        offsets.resize(numBoids + 1);
+        positionAtBuild.resize(numBoids);
+    }
+
+    [[nodiscard]] float listRadius() const { return VIEW_RADIUS + skin; }
+
+    [[nodiscard]] size_t memoryBytes() const {
+        return neighbors.capacity() * sizeof(int)
+             + offsets.capacity() * sizeof(int)
+             + positionAtBuild.capacity() * sizeof(Vector2);
+    }
+};
+
+// Immagine minima di uno spostamento sul toro [-WRAP_MARGIN, size + WRAP_MARGIN)
+inline Vector2 minimumImage(Vector2 d) {
+    constexpr float periodX = WIDTH + 2 * WRAP_MARGIN;
+    constexpr float periodY = HEIGHT + 2 * WRAP_MARGIN;
+    if (d.x > periodX / 2) d.x -= periodX;
+    else if (d.x < -periodX / 2) d.x += periodX;
+    if (d.y > periodY / 2) d.y -= periodY;
+    else if (d.y < -periodY / 2) d.y += periodY;
+    return d;
+}
+
+/**
+ * Visita i candidati di i entro listRadius sulla griglia periodica (celle
+ * grandi almeno listRadius, stencil 3x3). Con Collect = false conta soltanto,
+ * altrimenti scrive gli indici a partire da out. Restituisce il numero
+ * di candidati accettati; scanned accumula quelli esaminati.
+ */
+template<bool Collect>
+inline int collectVerletNeighbors(const int i,
+                                  const BoidArray& state,
+                                  const UniformGrid& grid,
+                                  const float listRadius,
+                                  int* out,
+                                  long long& scanned)
+{
+    const Vector2& self = state[i].position;
+    auto [cellX, cellY] = getCellCoords(self, grid);
+    const float radius2 = listRadius * listRadius;
+    int accepted = 0;
+
+    forEachNeighborBoid<1, false, true>(self, cellX, cellY, grid,
+        [&](const int otherIdx, const Vector2& shift) {
+            scanned++;
+            if (otherIdx == i) return;
+            const Vector2 d = self - (state[otherIdx].position + shift);
+            if (d.x * d.x + d.y * d.y < radius2) {
+                if constexpr (Collect) out[accepted] = otherIdx;
+                accepted++;
+            }
+        });
+    return accepted;
+}
+
+/**
+ * Ricostruzione parallela delle liste, da chiamare da tutti i thread della
+ * regione: griglia condivisa (periodica), conteggio per boid, prefix sum,
+ * riempimento. Restituisce (via scanned) i candidati esaminati dal thread
+ * chiamante.
+ */
+inline void parallelBuildVerletLists(const BoidArray& state,
+                                     UniformGrid& grid,
+                                     VerletLists& lists,
+                                     long long& scanned)
+{
+    const int N = static_cast<int>(state.size());
+    const float listRadius = lists.listRadius();
+
+    parallelBuildGrid(state, grid);
+
+    #pragma omp for schedule(static)
+    for (int i = 0; i < N; ++i) {
+        lists.offsets[i + 1] = collectVerletNeighbors<false>(i, state, grid, listRadius, nullptr, scanned);
+        lists.positionAtBuild[i] = state[i].position;
+    }
+
+    #pragma omp single
+    {
+        lists.offsets[0] = 0;
+        for (int i = 0; i < N; ++i) lists.offsets[i + 1] += lists.offsets[i];
+        lists.neighbors.resize(lists.offsets[N]);
+    }
+
+    #pragma omp for schedule(static)
+    for (int i = 0; i < N; ++i) {
+        long long ignored = 0;
+        collectVerletNeighbors<true>(i, state, grid, listRadius,
+            lists.neighbors.data() + lists.offsets[i], ignored);
+    }
+}
+
+/**
+ * Aggiorna il boid i usando solo la sua lista; restituisce il quadrato dello
+ * spostamento sul toro della nuova posizione rispetto a quella dell'ultima
+ * costruzione.
+ */
+template<bool Periodic, bool Fast>
+inline float computeNextBoidVerlet(const int i,
+                                   const BoidArray& oldState,
+                                   BoidArray& newState,
+                                   const VerletLists& lists)
+{
+    const Boid& b = oldState[i];
+
+    FlockSums sums;
+    const int end = lists.offsets[i + 1];
+    for (int k = lists.offsets[i]; k < end; ++k) {
+        const auto&[position, velocity] = oldState[lists.neighbors[k]];
+        if constexpr (Periodic) {
+            accumulateNeighbor<Fast>(sums, b.position, b.position - minimumImage(b.position - position), velocity);
+        } else {
+            accumulateNeighbor<Fast>(sums, b.position, position, velocity);
+        }
+    }
+
+    integrateBoid<Fast>(b, flockAcceleration<Fast>(sums, b), newState[i]);
+
+    const Vector2 moved = minimumImage(newState[i].position - lists.positionAtBuild[i]);
+    return moved.x * moved.x + moved.y * moved.y;
+}
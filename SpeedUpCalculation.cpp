@@ -73,7 +73,14 @@ int main() {
     std::ofstream outNoGrid("speedup_data_nogrid.txt", std::ios::trunc);
     std::ofstream outGrid("speedup_data_grid.txt",  std::ios::trunc);
     std::ofstream outSoA("speedup_data_soa.txt", std::ios::trunc);
-    if (!outNoGrid.is_open() || !outGrid.is_open() || !outSoA.is_open()) {
+    std::ofstream outGridSorted("speedup_data_grid_sorted.txt", std::ios::trunc);
+    std::ofstream outGridSoA("speedup_data_grid_soa.txt", std::ios::trunc);
+    std::ofstream outAoSoA("speedup_data_aosoa.txt", std::ios::trunc);
+    std::ofstream outGridAoSoA("speedup_data_grid_aosoa.txt", std::ios::trunc);
+    std::ofstream outCompact("speedup_data_compact.txt", std::ios::trunc);
+    std::ofstream outGridCompact("speedup_data_grid_compact.txt", std::ios::trunc);
+    if (!outNoGrid.is_open() || !outGrid.is_open() || !outSoA.is_open() || !outGridSorted.is_open() || !outGridSoA.is_open()
+        || !outAoSoA.is_open() || !outGridAoSoA.is_open() || !outCompact.is_open() || !outGridCompact.is_open()) {
         std::cerr << "Errore: impossibile aprire i file di output.\n";
         return 1;
     }
@@ -86,6 +93,12 @@ int main() {
         std::string parCmd     = "./ParHeadless "     + std::to_string(numBoids);
         std::string parGridCmd = "./ParallelGrid "    + std::to_string(numBoids);
         std::string parSoACmd  = "./ParSOAHeadless "  + std::to_string(numBoids);
+        std::string parGridSortedCmd = "./ParallelGridSorted " + std::to_string(numBoids);
+        std::string parGridSoACmd = "./ParallelGridSoA " + std::to_string(numBoids);
+        std::string parAoSoACmd = "./ParAoSoA " + std::to_string(numBoids);
+        std::string parGridAoSoACmd = "./ParAoSoA " + std::to_string(numBoids) + " grid";
+        std::string parCompactCmd = "./ParCompact " + std::to_string(numBoids);
+        std::string parGridCompactCmd = "./ParCompact " + std::to_string(numBoids) + " grid";
 
         double seqTotalNoGrid = 0.0;
         for (int i = 0; i < TRIALS; ++i) seqTotalNoGrid += measureExecutionTime(seqCmd);
@@ -126,11 +139,111 @@ int main() {
         } else {
             std::cerr << " Errore: parAvgSoA = 0.0?\n";
         }
+
+        double parTotalGridSorted = 0.0;
+        for (int i = 0; i < TRIALS; ++i) parTotalGridSorted += measureExecutionTime(parGridSortedCmd);
+        double parAvgGridSorted = parTotalGridSorted / TRIALS;
+        std::cout << "[GridSorted] Tempo medio par: " << parAvgGridSorted << " s\n";
+
+        if (double speedupGridSorted = parAvgGridSorted > 0.0 ? seqAvgNoGrid / parAvgGridSorted : -1.0; speedupGridSorted > 0.0) {
+            std::cout << " Speedup (GridSorted) = " << speedupGridSorted << "\n";
+            if (parAvgGrid > 0.0) {
+                std::cout << " GridSorted vs Grid = " << parAvgGrid / parAvgGridSorted << "\n";
+            }
+            outGridSorted << numBoids << " " << speedupGridSorted << "\n";
+        } else {
+            std::cerr << " Errore: parAvgGridSorted = 0.0?\n";
+        }
+
+        double parTotalGridSoA = 0.0;
+        for (int i = 0; i < TRIALS; ++i) parTotalGridSoA += measureExecutionTime(parGridSoACmd);
+        double parAvgGridSoA = parTotalGridSoA / TRIALS;
+        std::cout << "[GridSoA] Tempo medio par: " << parAvgGridSoA << " s\n";
+
+        if (double speedupGridSoA = parAvgGridSoA > 0.0 ? seqAvgNoGrid / parAvgGridSoA : -1.0; speedupGridSoA > 0.0) {
+            std::cout << " Speedup (GridSoA) = " << speedupGridSoA << "\n";
+            if (parAvgGrid > 0.0) {
+                std::cout << " GridSoA vs Grid = " << parAvgGrid / parAvgGridSoA << "\n";
+            }
+            outGridSoA << numBoids << " " << speedupGridSoA << "\n";
+        } else {
+            std::cerr << " Errore: parAvgGridSoA = 0.0?\n";
+        }
+
+        // Stesso scenario brute force di NoGrid e SoA, con lo stato a blocchi
+        double parTotalAoSoA = 0.0;
+        for (int i = 0; i < TRIALS; ++i) parTotalAoSoA += measureExecutionTime(parAoSoACmd);
+        double parAvgAoSoA = parTotalAoSoA / TRIALS;
+        std::cout << "[AoSoA]  Tempo medio par: " << parAvgAoSoA << " s\n";
+
+        if (double speedupAoSoA = parAvgAoSoA > 0.0 ? seqAvgNoGrid / parAvgAoSoA : -1.0; speedupAoSoA > 0.0) {
+            std::cout << " Speedup (AoSoA) = " << speedupAoSoA << "\n";
+            if (parAvgSoA > 0.0) {
+                std::cout << " AoSoA vs SoA = " << parAvgSoA / parAvgAoSoA << "\n";
+            }
+            outAoSoA << numBoids << " " << speedupAoSoA << "\n";
+        } else {
+            std::cerr << " Errore: parAvgAoSoA = 0.0?\n";
+        }
+
+        // Stesso scenario di GridSoA (stato riordinato per cella)
+        double parTotalGridAoSoA = 0.0;
+        for (int i = 0; i < TRIALS; ++i) parTotalGridAoSoA += measureExecutionTime(parGridAoSoACmd);
+        double parAvgGridAoSoA = parTotalGridAoSoA / TRIALS;
+        std::cout << "[GridAoSoA] Tempo medio par: " << parAvgGridAoSoA << " s\n";
+
+        if (double speedupGridAoSoA = parAvgGridAoSoA > 0.0 ? seqAvgNoGrid / parAvgGridAoSoA : -1.0; speedupGridAoSoA > 0.0) {
+            std::cout << " Speedup (GridAoSoA) = " << speedupGridAoSoA << "\n";
+            if (parAvgGridSoA > 0.0) {
+                std::cout << " GridAoSoA vs GridSoA = " << parAvgGridSoA / parAvgGridAoSoA << "\n";
+            }
+            outGridAoSoA << numBoids << " " << speedupGridAoSoA << "\n";
+        } else {
+            std::cerr << " Errore: parAvgGridAoSoA = 0.0?\n";
+        }
+
+        // Brute force di SoA con lo stato compatto a 16 bit
+        double parTotalCompact = 0.0;
+        for (int i = 0; i < TRIALS; ++i) parTotalCompact += measureExecutionTime(parCompactCmd);
+        double parAvgCompact = parTotalCompact / TRIALS;
+        std::cout << "[Compact] Tempo medio par: " << parAvgCompact << " s\n";
+
+        if (double speedupCompact = parAvgCompact > 0.0 ? seqAvgNoGrid / parAvgCompact : -1.0; speedupCompact > 0.0) {
+            std::cout << " Speedup (Compact) = " << speedupCompact << "\n";
+            if (parAvgSoA > 0.0) {
+                std::cout << " Compact vs SoA = " << parAvgSoA / parAvgCompact << "\n";
+            }
+            outCompact << numBoids << " " << speedupCompact << "\n";
+        } else {
+            std::cerr << " Errore: parAvgCompact = 0.0?\n";
+        }
+
+        // Scenario di GridSoA con lo stato compatto
+        double parTotalGridCompact = 0.0;
+        for (int i = 0; i < TRIALS; ++i) parTotalGridCompact += measureExecutionTime(parGridCompactCmd);
+        double parAvgGridCompact = parTotalGridCompact / TRIALS;
+        std::cout << "[GridCompact] Tempo medio par: " << parAvgGridCompact << " s\n";
+
+        if (double speedupGridCompact = parAvgGridCompact > 0.0 ? seqAvgNoGrid / parAvgGridCompact : -1.0; speedupGridCompact > 0.0) {
+            std::cout << " Speedup (GridCompact) = " << speedupGridCompact << "\n";
+            if (parAvgGridSoA > 0.0) {
+                std::cout << " GridCompact vs GridSoA = " << parAvgGridSoA / parAvgGridCompact << "\n";
+            }
+            outGridCompact << numBoids << " " << speedupGridCompact << "\n";
+        } else {
+            std::cerr << " Errore: parAvgGridCompact = 0.0?\n";
+        }
     }
 
     outNoGrid.close();
     outGrid.close();
     outSoA.close();
+    outGridSorted.close();
+    outGridSoA.close();
+    outAoSoA.close();
+    outGridAoSoA.close();
+    outCompact.close();
+    outGridCompact.close();
 
     if (boidCounts.size() >= 3) {
         if (int ret = std::system("gnuplot plot_speedup_grid.gp"); ret != 0) {
@@ -3,6 +3,7 @@
 #include <sstream>
 #include <string>
 #include <chrono>
+#include <cstdio>
 #include <cstdlib>
 #include <fstream>
 #include <vector>
@@ -21,6 +22,40 @@ double measureExecutionTime(const std::string& command, const std::string& env =
     return std::chrono::duration<double>(end - start).count();
 }
 
+// STEP_US= stampato dal comando (ParTeam): il tempo per passo della sola
+// simulazione, senza avvio del processo, inizializzazione e creazione dei
+// thread; -1 se il comando fallisce o non lo stampa
+double measureStepMicros(const std::string& command, const std::string& env = "") {
+    FILE* pipe = popen((env + command).c_str(), "r");
+    if (pipe == nullptr) return -1.0;
+
+    double stepMicros = -1.0;
+    char line[512];
+    while (std::fgets(line, sizeof(line), pipe) != nullptr) {
+        std::istringstream tokens(line);
+        std::string token;
+        while (tokens >> token) {
+            if (token.rfind("STEP_US=", 0) == 0) stepMicros = std::atof(token.c_str() + 8);
+        }
+    }
+    if (const int ret = pclose(pipe); ret != 0) {
+        std::cerr << "Warning: comando \"" << command << "\" terminato con codice di ritorno " << ret << '\n';
+        return -1.0;
+    }
+    return stepMicros;
+}
+
+// Media di STEP_US su trials esecuzioni; -1 se una fallisce
+double averageStepMicros(const std::string& command, const std::string& env, const int trials) {
+    double total = 0.0;
+    for (int i = 0; i < trials; ++i) {
+        const double stepMicros = measureStepMicros(command, env);
+        if (stepMicros < 0.0) return -1.0;
+        total += stepMicros;
+    }
+    return total / trials;
+}
+
 int main() {
     constexpr int numBoids = 1600;
     constexpr int TRIALS = 5;
@@ -42,7 +77,9 @@ int main() {
     std::ofstream outNoGrid("threads_speedup_nogrid.txt");
     std::ofstream outGrid("threads_speedup_grid.txt");
     std::ofstream outSoA("threads_speedup_soa.txt");
-    if (!outNoGrid || !outGrid || !outSoA) {
+    std::ofstream outTeam("threads_speedup_team.txt");
+    std::ofstream outGridTeam("threads_speedup_grid_team.txt");
+    if (!outNoGrid || !outGrid || !outSoA || !outTeam || !outGridTeam) {
         std::cerr << "Errore apertura file di output\n";
         return 1;
     }
@@ -75,22 +112,39 @@ int main() {
             parSoA += measureExecutionTime("./ParSOAHeadless " + std::to_string(numBoids), env);
         parSoA /= TRIALS;
 
+        // Squadra persistente contro regione OpenMP: stesso eseguibile e
+        // stessi passi, confrontati su STEP_US (il tempo dei soli passi)
+        const std::string teamCmd = "./ParTeam " + std::to_string(numBoids);
+        const double stepTeam = averageStepMicros(teamCmd + " team", env, TRIALS);
+        const double stepOmp = averageStepMicros(teamCmd + " omp", env, TRIALS);
+        const double stepGridTeam = averageStepMicros(teamCmd + " team grid", env, TRIALS);
+        const double stepGridOmp = averageStepMicros(teamCmd + " omp grid", env, TRIALS);
+
         double speedupNoGrid = seqAvg / parNoGrid;
         double speedupGrid = seqAvg / parGrid;
         double speedupSoA = seqAvg / parSoA;
+        // Rapporto omp / team sul tempo per passo: > 1 se la squadra è più veloce
+        double speedupTeam = stepTeam > 0.0 && stepOmp > 0.0 ? stepOmp / stepTeam : -1.0;
+        double speedupGridTeam = stepGridTeam > 0.0 && stepGridOmp > 0.0 ? stepGridOmp / stepGridTeam : -1.0;
 
         std::cout << "[NoGrid] Speedup: " << speedupNoGrid << "\n";
         std::cout << "[Grid]   Speedup: " << speedupGrid << "\n";
         std::cout << "[SoA]    Speedup: " << speedupSoA << "\n";
+        std::cout << "[Team]   STEP_US team " << stepTeam << " omp " << stepOmp << " (omp/team " << speedupTeam << ")\n";
+        std::cout << "[GridTeam] STEP_US team " << stepGridTeam << " omp " << stepGridOmp << " (omp/team " << speedupGridTeam << ")\n";
 
         outNoGrid << threads << " " << speedupNoGrid << "\n";
         outGrid   << threads << " " << speedupGrid   << "\n";
         outSoA    << threads << " " << speedupSoA    << "\n";
+        outTeam   << threads << " " << speedupTeam   << "\n";
+        outGridTeam << threads << " " << speedupGridTeam << "\n";
     }
 
     outNoGrid.close();
     outGrid.close();
     outSoA.close();
+    outTeam.close();
+    outGridTeam.close();
 
     // Generazione automatica del grafico con gnuplot
     if (threadCounts.size() >= 3) {
@@ -0,0 +1,176 @@
+//boids_distributed.cpp
+#include "BoidsDistributed.hpp"
+#include "BoidsGrid.hpp"
+#include "BoidsCommon.hpp"
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <omp.h>
+
+// Motore a più processi (vedi BoidsDistributed.hpp): "procs N" lancia N
+// processi locali che si scambiano alone e migrazioni in memoria condivisa,
+// "mpi" usa i rank di mpirun (se compilato con MPI). "world <scala>"
+// moltiplica i lati del mondo, per tenere la densità di ParallelGrid con
+// molti più boid (scala ~224 per 100M boid). Ogni processo locale gira su
+// una fetta disgiunta delle CPU, con un thread OpenMP per CPU della fetta
+// salvo "threads T"; con mpi il binding resta a mpirun.
+
+constexpr int STEPS = 600;
+
+struct DistributedOptions {
+    long long numBoids = 0;
+    int procs = 1;
+    int threads = 0; // thread OpenMP per rank, 0 = automatico
+    bool useMpi = false;
+    float worldScale = 1.0f;
+    int steps = STEPS;
+    GridStencil stencil = DEFAULT_STENCIL;
+    bool periodic = false;
+};
+
+// Valore intero positivo dopo argv[a] (e avanza a); false se manca
+bool parsePositiveArg(const int argc, char* argv[], int& a, int& value) {
+    if (a + 1 >= argc) return false;
+    char* end;
+    const long val = std::strtol(argv[a + 1], &end, 10);
+    if (*end != '\0' || val <= 0) return false;
+    value = static_cast<int>(val);
+    ++a;
+    return true;
+}
+
+// Corpo di un rank: stato iniziale del proprio rettangolo, passi cronometrati
+// tra due barriere e report (dal rank 0) con i contatori sommati sui rank
+template<typename Transport>
+int runRank(Transport& transport, const DistributedOptions& options, const char* transportName) {
+    DistributedLayout layout;
+    makeDistributedLayout(transport.size(), WIDTH * options.worldScale, HEIGHT * options.worldScale,
+                          options.periodic, layout);
+
+    BoidArray owned;
+    initializeOwned(owned, layout, transport.rank(), options.numBoids);
+
+    // Griglia locale: il rettangolo più VIEW_RADIUS per lato, non periodica
+    // (le copie d'alone arrivano già traslate)
+    UniformGrid grid(layout.subWidth + 2.0f * VIEW_RADIUS, layout.subHeight + 2.0f * VIEW_RADIUS,
+                     stencilCellSize(options.stencil), false, stencilReach(options.stencil));
+    const Vector2 origin = layout.origin(transport.rank());
+    grid.originX = origin.x - VIEW_RADIUS;
+    grid.originY = origin.y - VIEW_RADIUS;
+
+    DistributedStats stats;
+    transport.barrier();
+    const auto start = std::chrono::high_resolution_clock::now();
+    dispatchGridStencil(options.stencil, false, [&](auto reach, auto) {
+        return dispatchPrecision([&](auto fastTag) {
+            simulateRank<decltype(reach)::value, decltype(fastTag)::value>(transport, layout, owned, grid, options.steps, stats);
+            return 0;
+        });
+    });
+    const double elapsed = transport.max(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+
+    const double candidates = transport.sum(stats.candidates);
+    const double haloBoids = transport.sum(stats.haloBoids);
+    const double migrations = transport.sum(stats.migrations);
+    const double finalBoids = transport.sum(static_cast<double>(owned.size()));
+    if (transport.rank() == 0) {
+        std::cout << "TIME=" << elapsed << " seconds" << std::endl;
+        printDistributedReport(transportName, layout, haloBoids, migrations, finalBoids, options.steps);
+        printStencilReport(options.stencil, options.periodic, static_cast<long long>(candidates),
+                           static_cast<int>(options.numBoids), options.steps, elapsed);
+        printPageReport(); // solo le pagine del rank 0
+    }
+    return finalBoids == static_cast<double>(options.numBoids) ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+    DistributedOptions options;
+
+    if (argc > 1) {
+        char* end;
+        if (const long val = std::strtol(argv[1], &end, 10); *end == '\0' && val > 0) {
+            options.numBoids = val;
+        } else {
+            std::cerr << "Argomento non valido. Uscita.\n";
+            return 1;
+        }
+    } else {
+        std::cerr << "Numero di boid non specificato. Uscita.\n";
+        return 1;
+    }
+
+    // Argomenti opzionali, in qualsiasi ordine: "procs N" o "mpi", "threads
+    // T" per rank, "world <scala>", "steps <passi>", lo stencil (wide, 3x3, 5x5), "periodic",
+    // l'ISA dei kernel, la precisione e le pagine degli stati
+    SimdIsa isa = detectSimdIsa();
+    bool validArgs = true;
+    for (int a = 2; validArgs && a < argc; ++a) {
+        int scale = 0;
+        if (std::strcmp(argv[a], "procs") == 0) {
+            validArgs = parsePositiveArg(argc, argv, a, options.procs) && options.procs <= SHM_MAX_RANKS;
+        } else if (std::strcmp(argv[a], "mpi") == 0) {
+            options.useMpi = true;
+        } else if (std::strcmp(argv[a], "world") == 0) {
+            validArgs = parsePositiveArg(argc, argv, a, scale);
+            options.worldScale = static_cast<float>(scale);
+        } else if (std::strcmp(argv[a], "threads") == 0) {
+            validArgs = parsePositiveArg(argc, argv, a, options.threads);
+        } else if (std::strcmp(argv[a], "steps") == 0) {
+            validArgs = parsePositiveArg(argc, argv, a, options.steps);
+        } else if (std::strcmp(argv[a], "periodic") == 0) {
+            options.periodic = true;
+        } else if (!parseGridStencil(argv[a], options.stencil) && !parseSimdIsa(argv[a], isa)
+                   && !parsePrecision(argv[a], activePrecision()) && !parsePagePolicy(argv[a], activePagePolicy())) {
+            validArgs = false;
+        }
+    }
+    if (!validArgs || (options.useMpi && options.procs > 1) || options.numBoids > std::numeric_limits<int>::max()) {
+        std::cerr << "Uso: " << argv[0] << " <boid> [procs N|mpi] [threads T] [world <scala>] [steps <passi>] [wide|3x3|5x5] [periodic] [scalar|sse|avx2|avx512] [exact|fast] [hugetlb|thp|smallpages]. Uscita.\n";
+        return 1;
+    }
+    if (!simdIsaSupported(isa)) {
+        std::cerr << "ISA " << simdIsaName(isa) << " non supportata da questa CPU. Uscita.\n";
+        return 1;
+    }
+    activeSimdIsa() = isa;
+
+    if (options.useMpi) {
+#ifdef BOIDS_WITH_MPI
+        MPI_Init(&argc, &argv);
+        if (options.threads > 0) omp_set_num_threads(options.threads);
+        int result = 1;
+        {
+            MpiTransport transport;
+            DistributedLayout layout;
+            if (makeDistributedLayout(transport.size(), WIDTH * options.worldScale, HEIGHT * options.worldScale, options.periodic, layout)) {
+                result = runRank(transport, options, "mpi");
+            } else if (transport.rank() == 0) {
+                std::cerr << "Troppi rank: i sottodomini scendono sotto VIEW_RADIUS, aumentare world. Uscita.\n";
+            }
+        }
+        MPI_Finalize();
+        return result;
+#else
+        std::cerr << "Eseguibile compilato senza MPI. Uscita.\n";
+        return 1;
+#endif
+    }
+
+    DistributedLayout layout;
+    if (!makeDistributedLayout(options.procs, WIDTH * options.worldScale, HEIGHT * options.worldScale, options.periodic, layout)) {
+        std::cerr << "Troppi processi: i sottodomini scendono sotto VIEW_RADIUS, aumentare world. Uscita.\n";
+        return 1;
+    }
+    // Nessuna regione OpenMP prima del fork
+    return launchLocalRanks(options.procs, [&options](ShmTransport& transport) {
+        // Senza fette (affinità non disponibile) le CPU si dividono in parti uguali
+        const int cpus = restrictToRankCpus(transport.rank(), transport.size());
+        omp_set_num_threads(options.threads > 0 ? options.threads
+                            : cpus > 0 ? cpus : std::max(1, omp_get_num_procs() / transport.size()));
+        return runRank(transport, options, "shm");
+    });
+}
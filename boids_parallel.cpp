@@ -1,13 +1,37 @@
 //Boids_parallel.cpp
 #include "BoidsCommon.hpp"
 #include "BoidsUpdate.hpp"
+#include "BoidsNuma.hpp"
 #include <iostream>
 #include <vector>
 #include <cmath>
 #include <chrono>
 #include <cstdlib>
+#include <cstring>
 #include <omp.h>
 
+constexpr int STEPS = 600;
+
+// Passi con una regione parallela globale; il risultato resta in oldState
+template<bool Fast>
+void simulate(BoidArray& oldState, BoidArray& newState, const int numBoids, const int steps) {
+    #pragma omp parallel default(none) shared(oldState, newState, numBoids, steps)
+    {
+        for (int step = 0; step < steps; ++step) {
+            // Calcolo parallelo del nuovo stato
+            #pragma omp for schedule(static)
+            for (int i = 0; i < numBoids; ++i) {
+                computeNextBoid<Fast>(i, oldState, newState);
+            }
+
+            // Swap sequenziale tra i due buffer
+            #pragma omp single
+            {
+                oldState.swap(newState);
+            }
+        }
+    }
+}
 
 int main(const int argc, char* argv[]) {
     // --- Parsing argomento da linea di comando ---
@@ -25,9 +49,36 @@ int main(const int argc, char* argv[]) {
         return 1;
     }
 
+    // Argomenti opzionali, in qualsiasi ordine: ISA del kernel (scalar, sse,
+    // avx2, avx512, di default la migliore), precisione (exact, fast), con
+    // fast "drift [passi]" per la deriva delle posizioni rispetto a exact, e
+    // pagine dei buffer grandi (hugetlb, thp, smallpages)
+    int driftSteps = 0;
+    for (int a = 2; a < argc; ++a) {
+        SimdIsa isa;
+        if (parsePrecision(argv[a], activePrecision())) continue;
+        if (parsePagePolicy(argv[a], activePagePolicy())) continue;
+        if (parseDriftArg(argc, argv, a, driftSteps)) {
+            continue;
+        } else if (parseSimdIsa(argv[a], isa) && simdIsaSupported(isa)) {
+            activeSimdIsa() = isa;
+        } else {
+            std::cerr << "Uso: " << argv[0] << " <boid> [scalar|sse|avx2|avx512] [exact|fast [drift [passi]]] [hugetlb|thp|smallpages]. Uscita.\n";
+            return 1;
+        }
+    }
+    if (driftSteps > 0 && activePrecision() != Precision::Fast) {
+        std::cerr << "Il report drift richiede la precisione fast. Uscita.\n";
+        return 1;
+    }
+
     // --- Allocazione stati ---
-    std::vector<Boid> oldState(numBoids);
-    std::vector<Boid> newState(numBoids);
+    BoidArray oldState = uninitializedArray<BoidArray>(numBoids);
+    BoidArray newState = uninitializedArray<BoidArray>(numBoids);
+
+    // Pagine sul nodo del thread che scorre ogni intervallo, prima del first-touch
+    bindToOwnerNodes(oldState);
+    bindToOwnerNodes(newState);
 
     // First-touch: inizializza newState in parallelo per mappare bene la memoria
     #pragma omp parallel for default(none) shared(oldState, newState, numBoids) schedule(static)
@@ -59,31 +110,43 @@ int main(const int argc, char* argv[]) {
             std::sin(angle) * MAX_SPEED };
     }
 
+    // Stato iniziale conservato per il report drift
+    const BoidArray initialState = driftSteps > 0 ? oldState : BoidArray{};
+
+    printPageReport();
+
     // --- Simulazione ---
     const auto start = std::chrono::high_resolution_clock::now();
 
-    // Regione parallela globale
-    #pragma omp parallel default(none) shared(oldState, newState, numBoids)
-    {
-        constexpr int STEPS = 600;
-        for (int step = 0; step < STEPS; ++step) {
-            // Calcolo parallelo del nuovo stato
-            #pragma omp for schedule(static)
-            for (int i = 0; i < numBoids; ++i) {
-                computeNextBoid(i, oldState, newState);
-            }
-
-            // Swap sequenziale tra i due buffer
-            #pragma omp single
-            {
-                oldState.swap(newState);
-            }
-        }
-    }
+    dispatchPrecision([&](auto fastTag) {
+        simulate<decltype(fastTag)::value>(oldState, newState, numBoids, STEPS);
+    });
 
     const auto end = std::chrono::high_resolution_clock::now();
     const double elapsed = std::chrono::duration<double>(end - start).count();
 
     std::cout << "TIME=" << elapsed << " seconds" << std::endl;
+    std::cout << "ISA=" << simdIsaName(activeSimdIsa()) << " PRECISION=" << precisionName(activePrecision()) << std::endl;
+
+    if (driftSteps > 0) {
+        // Non cronometrato: driftSteps passi in exact, in fast (stessa ISA) e
+        // in exact con le somme in un altro ordine, dallo stesso stato iniziale
+        const SimdIsa isa = activeSimdIsa();
+        const auto run = [&](const Precision precision, const SimdIsa runIsa) {
+            oldState = initialState;
+            activePrecision() = precision;
+            activeSimdIsa() = runIsa;
+            dispatchPrecision([&](auto fastTag) {
+                simulate<decltype(fastTag)::value>(oldState, newState, numBoids, driftSteps);
+            });
+            return boidPositions(oldState);
+        };
+        const std::vector<Vector2> exactPositions = run(Precision::Exact, isa);
+        const PositionDrift drift = positionDrift(exactPositions, run(Precision::Fast, isa));
+        const PositionDrift baseline = positionDrift(exactPositions, run(Precision::Exact, reorderedSumsIsa(isa)));
+        std::cout << "DRIFT_MAX=" << drift.max << " DRIFT_MEAN=" << drift.mean
+                  << " BASELINE_MAX=" << baseline.max << " BASELINE_MEAN=" << baseline.mean
+                  << " STEPS=" << driftSteps << std::endl;
+    }
     return 0;
 }
@@ -0,0 +1,192 @@
+//boids_parallel_AoSoA.cpp
+#include "BoidsAoSoA.hpp"
+#include "BoidsCommon.hpp"
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+#include <omp.h>
+
+// Stato in blocchi AoSoA (vedi BoidsAoSoA.hpp), con gli stessi scenari di
+// ParSOAHeadless (brute force) e di ParallelGridSoA ("grid": stato
+// riordinato per cella a ogni passo), per confrontare i tre layout.
+
+constexpr int STEPS = 600;
+
+// Brute force; restituisce le distanze calcolate
+template<int B>
+long long simulate(BoidAoSoA<B>& oldState, BoidAoSoA<B>& newState, const int numBoids) {
+    const StepKernelAoSoA<B> kernel = activePrecision() == Precision::Fast
+        ? selectStepKernelAoSoA<B, true>(activeSimdIsa())
+        : selectStepKernelAoSoA<B, false>(activeSimdIsa());
+
+    #pragma omp parallel default(none) shared(oldState, newState, kernel)
+    {
+        for (int step = 0; step < STEPS; ++step) {
+            #pragma omp for schedule(static)
+            for (int block = 0; block < newState.numBlocks(); ++block) {
+                for (int i = block * B; i < newState.blockEnd(block); ++i) {
+                    kernel(i, oldState, newState);
+                }
+            }
+
+            #pragma omp single
+            {
+                oldState.swap(newState);
+            }
+        }
+    }
+    return static_cast<long long>(numBoids) * (numBoids - 1) * STEPS;
+}
+
+// Griglia specializzata sullo stencil; restituisce i candidati visitati
+template<int B, int Reach, bool Periodic>
+long long simulateGrid(BoidAoSoA<B>& oldState,
+                       BoidAoSoA<B>& sortedState,
+                       UniformGrid& grid,
+                       const int numBoids)
+{
+    const GridKernelAoSoA<B> kernel = activePrecision() == Precision::Fast
+        ? selectGridKernelAoSoA<B, Reach, Periodic, true>(activeSimdIsa())
+        : selectGridKernelAoSoA<B, Reach, Periodic, false>(activeSimdIsa());
+    long long candidates = 0;
+
+    #pragma omp parallel default(none) shared(oldState, sortedState, grid, numBoids, kernel) reduction(+:candidates)
+    {
+        for (int step = 0; step < STEPS; ++step) {
+            parallelBuildGridFrom(numBoids, [&oldState](const int i) { return oldState.position(i); }, grid);
+            permuteByCellAoSoA(oldState, sortedState, grid);
+
+            // Lo stato nuovo va in oldState, già consumato dalla permutazione
+            #pragma omp for schedule(static)
+            for (int block = 0; block < oldState.numBlocks(); ++block) {
+                for (int k = block * B; k < oldState.blockEnd(block); ++k) {
+                    candidates += kernel(k, sortedState, oldState, grid);
+                }
+            }
+        }
+    }
+    return candidates;
+}
+
+// Inizializzazione deterministica su griglia regolare, come negli altri
+// motori; scrive per primo i blocchi di state e di other (first-touch),
+// divisi tra i thread come nei passi
+template<int B>
+void initializeState(BoidAoSoA<B>& state, BoidAoSoA<B>& other, const int numBoids) {
+    const int gridSize = static_cast<int>(std::ceil(std::sqrt(numBoids)));
+    const float spacingX = WIDTH / static_cast<float>(gridSize);
+    const float spacingY = HEIGHT / static_cast<float>(gridSize);
+    constexpr float centerX = WIDTH / 2.0f;
+    constexpr float centerY = HEIGHT / 2.0f;
+
+    #pragma omp parallel for default(none) shared(state, other, gridSize, spacingX, spacingY) firstprivate(centerX, centerY) schedule(static)
+    for (int block = 0; block < state.numBlocks(); ++block) {
+        other.blocks[block] = BoidBlock<B>{};
+        for (int i = block * B; i < state.blockEnd(block); ++i) {
+            const int row = i / gridSize;
+            const int col = i % gridSize;
+            const float posX = static_cast<float>(col) * spacingX + spacingX / 2.0f;
+            const float posY = static_cast<float>(row) * spacingY + spacingY / 2.0f;
+
+            const float angle = std::atan2(posY - centerY, posX - centerX);
+            state.set(i, {{posX, posY}, {std::cos(angle) * MAX_SPEED, std::sin(angle) * MAX_SPEED}});
+        }
+    }
+}
+
+int main(const int argc, char* argv[]) {
+    int numBoids = 0;
+
+    if (argc > 1) {
+        char* end;
+        if (const long val = std::strtol(argv[1], &end, 10); *end == '\0' && val > 0) {
+            numBoids = static_cast<int>(val);
+        } else {
+            std::cerr << "Argomento non valido. Uscita.\n";
+            return 1;
+        }
+    } else {
+        std::cerr << "Numero di boid non specificato. Uscita.\n";
+        return 1;
+    }
+
+    // Argomenti opzionali, in qualsiasi ordine: boid per blocco (8 o 16),
+    // "grid" con stencil (wide, 3x3, 5x5) e "periodic", l'ISA dei kernel
+    // (sse, avx2, avx512), la precisione (exact, fast) e le pagine degli
+    // stati (hugetlb, thp, smallpages)
+    int blockSize = 16;
+    bool useGrid = false;
+    GridStencil stencil = DEFAULT_STENCIL;
+    bool periodic = false;
+    bool gridOnlyArgs = false;
+    SimdIsa isa = detectSimdIsa();
+    bool validArgs = true;
+    for (int a = 2; validArgs && a < argc; ++a) {
+        if (std::strcmp(argv[a], "8") == 0 || std::strcmp(argv[a], "16") == 0) {
+            blockSize = std::atoi(argv[a]);
+        } else if (std::strcmp(argv[a], "grid") == 0) {
+            useGrid = true;
+        } else if (std::strcmp(argv[a], "periodic") == 0) {
+            periodic = gridOnlyArgs = true;
+        } else if (parseGridStencil(argv[a], stencil)) {
+            gridOnlyArgs = true;
+        } else if (!parseSimdIsa(argv[a], isa) && !parsePrecision(argv[a], activePrecision())
+                   && !parsePagePolicy(argv[a], activePagePolicy())) {
+            validArgs = false;
+        }
+    }
+    if (!validArgs || (gridOnlyArgs && !useGrid)) {
+        std::cerr << "Uso: " << argv[0] << " <boid> [8|16] [grid [wide|3x3|5x5] [periodic]] [sse|avx2|avx512] [exact|fast] [hugetlb|thp|smallpages]. Uscita.\n";
+        return 1;
+    }
+    if (isa == SimdIsa::Scalar || !simdIsaSupported(isa)) {
+        std::cerr << "Kernel " << simdIsaName(isa) << " non disponibile: servono sse, avx2 o avx512. Uscita.\n";
+        return 1;
+    }
+    activeSimdIsa() = isa;
+
+    const auto run = [&](auto blockTag) {
+        constexpr int B = decltype(blockTag)::value;
+        BoidAoSoA<B> oldState(numBoids), newState(numBoids);
+        bindToOwnerNodes(oldState);
+        bindToOwnerNodes(newState);
+        initializeState(oldState, newState, numBoids);
+
+        if (!useGrid) {
+            printPageReport();
+            const auto start = std::chrono::high_resolution_clock::now();
+            const long long distances = simulate(oldState, newState, numBoids);
+            const double elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+            std::cout << "TIME=" << elapsed << " seconds" << std::endl;
+            std::cout << "MODE=full LAYOUT=aosoa BLOCK=" << B << " ISA=" << simdIsaName(isa)
+                      << " PRECISION=" << precisionName(activePrecision())
+                      << " DISTANCES_PER_BOID=" << static_cast<double>(distances) / (static_cast<double>(numBoids) * STEPS)
+                      << std::endl;
+            return;
+        }
+
+        UniformGrid grid(WIDTH, HEIGHT, stencilCellSize(stencil), periodic, stencilReach(stencil));
+        grid.prepareParallelBuild(numBoids, omp_get_max_threads());
+        bindToOwnerNodes(grid);
+        printPageReport();
+
+        const auto start = std::chrono::high_resolution_clock::now();
+        const long long candidates = dispatchGridStencil(stencil, periodic, [&](auto reach, auto periodicTag) {
+            return simulateGrid<B, decltype(reach)::value, decltype(periodicTag)::value>(oldState, newState, grid, numBoids);
+        });
+        const double elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+        std::cout << "TIME=" << elapsed << " seconds" << std::endl;
+        std::cout << "LAYOUT=aosoa BLOCK=" << B << " ";
+        printStencilReport(stencil, periodic, candidates, numBoids, STEPS, elapsed);
+    };
+
+    if (blockSize == 8) run(std::integral_constant<int, 8>{});
+    else run(std::integral_constant<int, 16>{});
+    return 0;
+}
@@ -5,8 +5,189 @@
 #include <chrono>
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <vector>
 #include <omp.h>
 
+constexpr int STEPS = 600;
+
+// Differenza relativa tra le somme del kernel e quelle di riferimento (vedi SIMD_TOLERANCE)
+float relativeDifference(const Vector2& reference, const Vector2& value) {
+    return (reference - value).magnitude() / std::max(1.0f, reference.magnitude());
+}
+
+// Confronto delle somme di ogni boid (values) con accumulateRangeSoA;
+// restituisce la massima differenza relativa e conta i boid con conteggi diversi
+float maxSumsDifferenceSoA(const BoidSoA& state, const int numBoids, const std::vector<FlockSums>& values, int& countMismatches) {
+    float difference = 0.0f;
+    int mismatches = 0;
+
+    #pragma omp parallel for default(none) shared(state, numBoids, values) reduction(max:difference) reduction(+:mismatches) schedule(static)
+    for (int i = 0; i < numBoids; ++i) {
+        FlockSums reference;
+        accumulateRangeSoA(i, state, 0, numBoids, reference);
+        const FlockSums& value = values[i];
+        difference = std::max({difference,
+            relativeDifference(reference.separation, value.separation),
+            relativeDifference(reference.alignment, value.alignment),
+            relativeDifference(reference.cohesion, value.cohesion)});
+        if (reference.viewCount != value.viewCount || reference.separationCount != value.separationCount) mismatches++;
+    }
+    countMismatches = mismatches;
+    return difference;
+}
+
+// Confronto di un passo della variante outer (next, con chiusura e
+// integrazione vettoriali) con flockAcceleration e integrateBoid scalari
+// sulle somme dello stesso kernel (values): le somme si confrontano a parte,
+// e con vicini simmetrici una somma quasi nulla cambia direzione a ogni
+// riordino. Restituisce la massima differenza relativa tra posizioni e velocità
+float maxStepDifferenceSoA(const BoidSoA& state, const BoidSoA& next, const int numBoids, const std::vector<FlockSums>& values) {
+    float difference = 0.0f;
+
+    #pragma omp parallel for default(none) shared(state, next, numBoids, values) reduction(max:difference) schedule(static)
+    for (int i = 0; i < numBoids; ++i) {
+        const Boid b{{state.posX[i], state.posY[i]}, {state.velX[i], state.velY[i]}};
+        Boid reference;
+        integrateBoid<false>(b, flockAcceleration<false>(values[i], b), reference);
+        difference = std::max({difference,
+            relativeDifference(reference.position, {next.posX[i], next.posY[i]}),
+            relativeDifference(reference.velocity, {next.velX[i], next.velY[i]})});
+    }
+    return difference;
+}
+
+// Variante del passo scelta da riga di comando
+struct SimulationModeSoA {
+    bool half = false;
+    bool tiled = false;
+    bool outer = false;
+    int targetTile = DEFAULT_TARGET_TILE;
+    int sourceTile = DEFAULT_SOURCE_TILE;
+    SimdIsa isa = SimdIsa::Scalar;
+};
+
+// Passi nella variante scelta, con i kernel dell'ISA scelta e della
+// precisione Fast; restituisce le distanze calcolate
+template<bool Fast>
+long long simulate(BoidSoA& oldState, BoidSoA& newState, const int numBoids, const int steps, const SimulationModeSoA& mode) {
+    const RangeKernelSoA kernel = selectRangeKernelSoA<Fast>(mode.isa);
+    const OuterStepKernelSoA outerKernel = selectOuterStepKernelSoA<Fast>(mode.isa);
+    const int outerWidth = simdIsaWidth(mode.isa);
+    const int targetTile = mode.targetTile;
+    const int sourceTile = mode.sourceTile;
+    const auto rowPairs = accumulateRowPairsSoA<Fast>;
+    long long distances = 0;
+
+    if (mode.half) {
+        // Accumulatori condivisi, allocati una volta sola (vedi PairSumsSoA)
+        PairSumsSoA pairSums(numBoids);
+
+        #pragma omp parallel default(none) shared(oldState, newState, numBoids, steps, pairSums, rowPairs) reduction(+:distances)
+        {
+            const int thread = omp_get_thread_num();
+            const int numBlocks = 2 * omp_get_num_threads();
+
+            // First-touch con la stessa divisione del ciclo di chiusura
+            #pragma omp for schedule(static)
+            for (int i = 0; i < numBoids; ++i) {
+                pairSums.clear(i);
+            }
+
+            for (int step = 0; step < steps; ++step) {
+                // Coppie interne ai due blocchi del thread...
+                for (int block = 2 * thread; block < 2 * thread + 2; ++block) {
+                    const int blockEnd = pairBlockBegin(block + 1, numBlocks, numBoids);
+                    for (int i = pairBlockBegin(block, numBlocks, numBoids); i < blockEnd; ++i) {
+                        distances += rowPairs(i, i + 1, blockEnd, oldState, pairSums);
+                    }
+                }
+
+                // ...poi i turni del torneo, separati da una barriera
+                for (int round = 0; round < numBlocks - 1; ++round) {
+                    #pragma omp barrier
+
+                    const auto [first, second] = pairBlocksSoA(round, thread, numBlocks);
+                    const int firstEnd = pairBlockBegin(first + 1, numBlocks, numBoids);
+                    const int secondBegin = pairBlockBegin(second, numBlocks, numBoids);
+                    const int secondEnd = pairBlockBegin(second + 1, numBlocks, numBoids);
+                    for (int i = pairBlockBegin(first, numBlocks, numBoids); i < firstEnd; ++i) {
+                        distances += rowPairs(i, secondBegin, secondEnd, oldState, pairSums);
+                    }
+                }
+
+                #pragma omp barrier
+
+                #pragma omp for schedule(static)
+                for (int i = 0; i < numBoids; ++i) {
+                    finishBoidPairsSoA<Fast>(i, oldState, newState, pairSums);
+                }
+
+                #pragma omp single
+                {
+                    oldState.swap(newState);
+                }
+            }
+        }
+    } else if (mode.tiled) {
+        const int numBlocks = (numBoids + targetTile - 1) / targetTile;
+
+        #pragma omp parallel default(none) shared(oldState, newState, numBoids, steps, numBlocks, targetTile, sourceTile, kernel)
+        {
+            std::vector<FlockSums> blockSums(targetTile);
+            for (int step = 0; step < steps; ++step) {
+                #pragma omp for schedule(static)
+                for (int block = 0; block < numBlocks; ++block) {
+                    const int targetBegin = block * targetTile;
+                    const int targetEnd = std::min(numBoids, targetBegin + targetTile);
+                    computeBlockTiledSoA<Fast>(targetBegin, targetEnd, oldState, newState, numBoids, sourceTile, blockSums, kernel);
+                }
+
+                #pragma omp single
+                {
+                    oldState.swap(newState);
+                }
+            }
+        }
+        distances = static_cast<long long>(numBoids) * (numBoids - 1) * steps;
+    } else if (mode.outer) {
+        #pragma omp parallel default(none) shared(oldState, newState, numBoids, steps, outerKernel, outerWidth)
+        {
+            for (int step = 0; step < steps; ++step) {
+                #pragma omp for schedule(static)
+                for (int targetBegin = 0; targetBegin < numBoids; targetBegin += outerWidth) {
+                    outerKernel(targetBegin, oldState, newState, numBoids);
+                }
+
+                #pragma omp single
+                {
+                    oldState.swap(newState);
+                }
+            }
+        }
+        distances = static_cast<long long>(numBoids) * (numBoids - 1) * steps;
+    } else {
+        #pragma omp parallel default(none) shared(oldState, newState, numBoids, steps, kernel)
+        {
+            for (int step = 0; step < steps; ++step) {
+                #pragma omp for schedule(static)
+                for (int i = 0; i < numBoids; ++i) {
+                    computeNextBoidSoA<Fast>(i, oldState, newState, numBoids, kernel);
+                }
+
+                #pragma omp single
+                {
+                    oldState.swap(newState);
+                }
+            }
+        }
+        distances = static_cast<long long>(numBoids) * (numBoids - 1) * steps;
+    }
+
+    return distances;
+}
+
 int main(const int argc, char* argv[]) {
     int numBoids = 0;
 
@@ -23,7 +204,73 @@ int main(const int argc, char* argv[]) {
         return 1;
     }
 
+    // Argomenti opzionali, in qualsiasi ordine: "half" valuta ogni coppia una
+    // volta sola (triangolo j > i), "tiled [bersagli] [sorgenti]" confronta
+    // blocchi di bersagli con tile di sorgenti in cache, "outer" vettorizza
+    // sui bersagli (una corsia per boid), "scalar", "sse", "avx2" o "avx512"
+    // forzano il kernel (di default il migliore per la CPU), "exact" o "fast"
+    // la precisione e, con fast, "drift [passi]" misura la deriva rispetto a
+    // exact; "hugetlb", "thp" o "smallpages" scelgono le pagine degli stati
+    SimulationModeSoA mode;
+    mode.isa = detectSimdIsa();
+    bool explicitIsa = false;
+    int driftSteps = 0;
+    bool validArgs = true;
+    for (int a = 2; validArgs && a < argc; ++a) {
+        if (std::strcmp(argv[a], "half") == 0) {
+            mode.half = true;
+        } else if (std::strcmp(argv[a], "outer") == 0) {
+            mode.outer = true;
+        } else if (parseDriftArg(argc, argv, a, driftSteps)) {
+            continue;
+        } else if (std::strcmp(argv[a], "tiled") == 0) {
+            mode.tiled = true;
+            int* const tileSizes[] = {&mode.targetTile, &mode.sourceTile};
+            for (int* size : tileSizes) {
+                char* end;
+                if (a + 1 >= argc) break;
+                if (const long val = std::strtol(argv[a + 1], &end, 10); *end == '\0' && val > 0) {
+                    *size = static_cast<int>(val);
+                    ++a;
+                } else {
+                    break;
+                }
+            }
+        } else if (parseSimdIsa(argv[a], mode.isa)) {
+            explicitIsa = true;
+        } else if (!parsePrecision(argv[a], activePrecision()) && !parsePagePolicy(argv[a], activePagePolicy())) {
+            validArgs = false;
+        }
+    }
+    const bool half = mode.half;
+    const bool tiled = mode.tiled;
+    const bool outer = mode.outer;
+    if (!validArgs || static_cast<int>(half) + static_cast<int>(tiled) + static_cast<int>(outer) > 1
+        || (driftSteps > 0 && activePrecision() != Precision::Fast)) {
+        std::cerr << "Uso: " << argv[0] << " <boid> [half | tiled [bersagli] [sorgenti] | outer] [scalar|sse|avx2|avx512] [exact|fast [drift [passi]]] [hugetlb|thp|smallpages]. Uscita.\n";
+        return 1;
+    }
+    // I kernel SIMD leggono vettori interi fino al bordo del tile di sorgenti
+    mode.sourceTile = sourceTileSoA(mode.sourceTile);
+    SimdIsa& isa = mode.isa;
+    // La variante triangolare distribuisce su due boid: solo col kernel scalare
+    if (half && explicitIsa && isa != SimdIsa::Scalar) {
+        std::cerr << "La variante half usa solo il kernel scalare (" << simdIsaName(isa) << " richiesto). Uscita.\n";
+        return 1;
+    }
+    if (outer && isa == SimdIsa::Scalar) {
+        std::cerr << "La variante outer richiede un kernel SIMD (sse, avx2, avx512). Uscita.\n";
+        return 1;
+    }
+    if (!simdIsaSupported(isa)) {
+        std::cerr << "Kernel " << simdIsaName(isa) << " non supportato da questa CPU. Uscita.\n";
+        return 1;
+    }
+    if (half) isa = SimdIsa::Scalar;
+
     BoidSoA oldState(numBoids), newState(numBoids);
+    bindToOwnerNodes(oldState);
+    bindToOwnerNodes(newState);
 
     // Inizializzazione deterministica su griglia regolare
     const int gridSize = static_cast<int>(std::ceil(std::sqrt(numBoids)));
@@ -56,27 +303,97 @@ int main(const int argc, char* argv[]) {
         newState.velY[i] = 0.0f;
     }
 
-    const auto start = std::chrono::high_resolution_clock::now();
+    printPageReport();
 
-    #pragma omp parallel default(none) shared(oldState, newState, numBoids)
-    {
-        constexpr int STEPS = 600;
-        for (int step = 0; step < STEPS; ++step) {
-            #pragma omp for schedule(static)
+    // Controllo del kernel (in precisione exact) contro quello di riferimento
+    // sullo stato iniziale; l'errore di fast si legge nel report drift
+    if (!half && isa != SimdIsa::Scalar) {
+        std::vector<FlockSums> values(numBoids);
+        const int outerWidth = simdIsaWidth(isa);
+        if (outer) {
+            const OuterSumsKernelSoA sumsKernel = selectOuterSumsKernelSoA(isa);
+            #pragma omp parallel for default(none) shared(oldState, numBoids, values, sumsKernel, outerWidth) schedule(static)
+            for (int targetBegin = 0; targetBegin < numBoids; targetBegin += outerWidth) {
+                sumsKernel(targetBegin, oldState, numBoids, values.data() + targetBegin);
+            }
+        } else {
+            const RangeKernelSoA kernel = selectRangeKernelSoA(isa);
+            #pragma omp parallel for default(none) shared(oldState, numBoids, values, kernel) schedule(static)
             for (int i = 0; i < numBoids; ++i) {
-                computeNextBoidSoA(i, oldState, newState, numBoids);
+                kernel(i, oldState, 0, numBoids, values[i]);
             }
+        }
+
+        int countMismatches = 0;
+        const float difference = maxSumsDifferenceSoA(oldState, numBoids, values, countMismatches);
+        std::cout << "ISA=" << simdIsaName(isa) << " SUMS_DIFF_VS_REFERENCE=" << difference
+                  << (difference <= SIMD_TOLERANCE ? " (entro " : " (OLTRE ") << SIMD_TOLERANCE << ")"
+                  << " COUNT_MISMATCHES=" << countMismatches;
 
-            #pragma omp single
-            {
-                oldState.swap(newState);
+        // La variante outer chiude e integra in SIMD: si confronta anche lo
+        // stato dopo un passo (posizioni e velocità finali)
+        if (outer) {
+            const OuterStepKernelSoA stepKernel = selectOuterStepKernelSoA<false>(isa);
+            #pragma omp parallel for default(none) shared(oldState, newState, numBoids, stepKernel, outerWidth) schedule(static)
+            for (int targetBegin = 0; targetBegin < numBoids; targetBegin += outerWidth) {
+                stepKernel(targetBegin, oldState, newState, numBoids);
             }
+
+            const float stepDifference = maxStepDifferenceSoA(oldState, newState, numBoids, values);
+            std::cout << " STATE_DIFF_VS_REFERENCE=" << stepDifference
+                      << (stepDifference <= SIMD_TOLERANCE ? " (entro " : " (OLTRE ") << SIMD_TOLERANCE << ")";
         }
+        std::cout << std::endl;
     }
 
+    // Stato iniziale conservato per il report drift
+    BoidSoA initialState(0);
+    if (driftSteps > 0) initialState = oldState;
+
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    const long long distances = dispatchPrecision([&](auto fastTag) {
+        return simulate<decltype(fastTag)::value>(oldState, newState, numBoids, STEPS, mode);
+    });
+
     const auto end = std::chrono::high_resolution_clock::now();
     const double elapsed = std::chrono::duration<double>(end - start).count();
 
     std::cout << "TIME=" << elapsed << " seconds" << std::endl;
+    std::cout << "MODE=" << (half ? "half" : tiled ? "tiled" : outer ? "outer" : "full") << " ISA=" << simdIsaName(isa)
+              << " PRECISION=" << precisionName(activePrecision());
+    if (tiled) std::cout << " TILE=" << mode.targetTile << "x" << mode.sourceTile;
+    std::cout << " DISTANCES_PER_BOID=" << static_cast<double>(distances) / (static_cast<double>(numBoids) * STEPS)
+              << std::endl;
+
+    if (driftSteps > 0) {
+        // Non cronometrato: driftSteps passi in fast e in exact (stessa
+        // variante e ISA) dallo stesso stato iniziale, poi la base: exact
+        // con le somme in un altro ordine (un'altra ISA, o la variante full
+        // per half), la differenza con cui confrontare quella di fast
+        SimulationModeSoA baselineMode = mode;
+        if (half) {
+            baselineMode.half = false;
+        } else if (outer) {
+            baselineMode.isa = isa == SimdIsa::Sse ? detectSimdIsa() : SimdIsa::Sse;
+        } else {
+            baselineMode.isa = reorderedSumsIsa(isa);
+        }
+        const auto run = [&](const bool fast, const SimulationModeSoA& runMode) {
+            oldState = initialState;
+            if (fast) simulate<true>(oldState, newState, numBoids, driftSteps, runMode);
+            else simulate<false>(oldState, newState, numBoids, driftSteps, runMode);
+
+            std::vector<Vector2> positions(numBoids);
+            for (int i = 0; i < numBoids; ++i) positions[i] = {oldState.posX[i], oldState.posY[i]};
+            return positions;
+        };
+        const std::vector<Vector2> exactPositions = run(false, mode);
+        const PositionDrift drift = positionDrift(exactPositions, run(true, mode));
+        const PositionDrift baseline = positionDrift(exactPositions, run(false, baselineMode));
+        std::cout << "DRIFT_MAX=" << drift.max << " DRIFT_MEAN=" << drift.mean
+                  << " BASELINE_MAX=" << baseline.max << " BASELINE_MEAN=" << baseline.mean
+                  << " STEPS=" << driftSteps << std::endl;
+    }
     return 0;
 }
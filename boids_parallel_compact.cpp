@@ -0,0 +1,248 @@
+//boids_parallel_compact.cpp
+#include "BoidsCompact.hpp"
+#include "BoidsUpdate.hpp"
+#include "BoidsCommon.hpp"
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <omp.h>
+
+// Stato compatto a 16 bit (vedi BoidsCompact.hpp), con gli stessi scenari di
+// ParSOAHeadless (brute force) e di ParallelGridSoA ("grid": stato
+// riordinato per cella a ogni passo). Con "drift [passi]" confronta le
+// posizioni con il motore float (BoidArray) dallo stesso stato iniziale.
+
+constexpr int STEPS = 600;
+
+// Brute force; restituisce le distanze calcolate
+long long simulate(BoidCompact& oldState, BoidCompact& newState, const int numBoids, const int steps) {
+    const StepKernelCompact kernel = selectStepKernelCompact(activeSimdIsa(), activePrecision());
+
+    #pragma omp parallel default(none) shared(oldState, newState, numBoids, steps, kernel)
+    {
+        for (int step = 0; step < steps; ++step) {
+            #pragma omp for schedule(static)
+            for (int i = 0; i < numBoids; ++i) {
+                kernel(i, oldState, newState);
+            }
+
+            #pragma omp single
+            {
+                oldState.swap(newState);
+            }
+        }
+    }
+    return static_cast<long long>(numBoids) * (numBoids - 1) * steps;
+}
+
+// Id stabili degli slot dello stato riordinato, solo per il report drift
+struct StableIds {
+    std::vector<int> current, sorted;
+};
+
+// Griglia specializzata sullo stencil; restituisce i candidati visitati.
+// Con ids (non nullo) gli id stabili seguono la permutazione di ogni passo
+template<int Reach, bool Periodic>
+long long simulateGrid(BoidCompact& oldState,
+                       BoidCompact& sortedState,
+                       UniformGrid& grid,
+                       StableIds* ids,
+                       const int numBoids,
+                       const int steps)
+{
+    const CellKernelCompact kernel = selectCellKernelCompact<Reach, Periodic>(activeSimdIsa(), activePrecision());
+    long long candidates = 0;
+
+    #pragma omp parallel default(none) shared(oldState, sortedState, grid, ids, numBoids, steps, kernel) reduction(+:candidates)
+    {
+        for (int step = 0; step < steps; ++step) {
+            parallelBuildGridFrom(numBoids, CompactPosition{oldState}, grid);
+            permuteByCellCompact(oldState, sortedState, grid, numBoids);
+            if (ids) {
+                #pragma omp for schedule(static)
+                for (int k = 0; k < numBoids; ++k) ids->sorted[k] = ids->current[grid.cellIndices[k]];
+
+                #pragma omp single
+                {
+                    ids->current.swap(ids->sorted);
+                }
+            }
+
+            // Lo stato nuovo va in oldState, già consumato dalla permutazione;
+            // le celle dense costano molto più di quelle vuote
+            #pragma omp for schedule(dynamic, 16)
+            for (int c = 0; c < grid.numCells(); ++c) {
+                candidates += kernel(c, sortedState, oldState, grid);
+            }
+        }
+    }
+    return candidates;
+}
+
+// Riferimento float per il report drift: computeNextBoid o computeNextBoidGrid
+// sullo stato AoS, con la stessa ISA e precisione
+template<int Reach, bool Periodic, bool Fast>
+void simulateReference(BoidArray& oldState, BoidArray& newState, UniformGrid* grid, const int numBoids, const int steps) {
+    #pragma omp parallel default(none) shared(oldState, newState, grid, numBoids, steps)
+    {
+        for (int step = 0; step < steps; ++step) {
+            if (grid) parallelBuildGrid(oldState, *grid);
+
+            #pragma omp for schedule(static)
+            for (int i = 0; i < numBoids; ++i) {
+                if (grid) computeNextBoidGrid<Reach, false, Periodic, Fast>(i, oldState, newState, *grid);
+                else computeNextBoid<Fast>(i, oldState, newState);
+            }
+
+            #pragma omp single
+            {
+                oldState.swap(newState);
+            }
+        }
+    }
+}
+
+// Inizializzazione deterministica su griglia regolare, come negli altri motori
+void initializeState(BoidArray& state, const int numBoids) {
+    const int gridSize = static_cast<int>(std::ceil(std::sqrt(numBoids)));
+    const float spacingX = WIDTH / static_cast<float>(gridSize);
+    const float spacingY = HEIGHT / static_cast<float>(gridSize);
+    constexpr float centerX = WIDTH / 2.0f;
+    constexpr float centerY = HEIGHT / 2.0f;
+
+    #pragma omp parallel for default(none) shared(state, numBoids, gridSize, spacingX, spacingY) firstprivate(centerX, centerY) schedule(static)
+    for (int i = 0; i < numBoids; ++i) {
+        const int row = i / gridSize;
+        const int col = i % gridSize;
+        const float posX = static_cast<float>(col) * spacingX + spacingX / 2.0f;
+        const float posY = static_cast<float>(row) * spacingY + spacingY / 2.0f;
+
+        const float angle = std::atan2(posY - centerY, posX - centerX);
+        state[i] = {{posX, posY}, {std::cos(angle) * MAX_SPEED, std::sin(angle) * MAX_SPEED}};
+    }
+}
+
+int main(const int argc, char* argv[]) {
+    int numBoids = 0;
+
+    if (argc > 1) {
+        char* end;
+        if (const long val = std::strtol(argv[1], &end, 10); *end == '\0' && val > 0) {
+            numBoids = static_cast<int>(val);
+        } else {
+            std::cerr << "Argomento non valido. Uscita.\n";
+            return 1;
+        }
+    } else {
+        std::cerr << "Numero di boid non specificato. Uscita.\n";
+        return 1;
+    }
+
+    // Argomenti opzionali, in qualsiasi ordine: "grid" con stencil (wide,
+    // 3x3, 5x5) e "periodic", l'ISA dei kernel (sse, avx2, avx512), la
+    // precisione (exact, fast), "drift [passi]" per la deriva rispetto al
+    // motore float e le pagine degli stati (hugetlb, thp, smallpages)
+    bool useGrid = false;
+    GridStencil stencil = DEFAULT_STENCIL;
+    bool periodic = false;
+    bool gridOnlyArgs = false;
+    int driftSteps = 0;
+    SimdIsa isa = detectSimdIsa();
+    bool validArgs = true;
+    for (int a = 2; validArgs && a < argc; ++a) {
+        if (std::strcmp(argv[a], "grid") == 0) {
+            useGrid = true;
+        } else if (std::strcmp(argv[a], "periodic") == 0) {
+            periodic = gridOnlyArgs = true;
+        } else if (parseGridStencil(argv[a], stencil)) {
+            gridOnlyArgs = true;
+        } else if (parseDriftArg(argc, argv, a, driftSteps)) {
+            continue;
+        } else if (!parseSimdIsa(argv[a], isa) && !parsePrecision(argv[a], activePrecision())
+                   && !parsePagePolicy(argv[a], activePagePolicy())) {
+            validArgs = false;
+        }
+    }
+    if (!validArgs || (gridOnlyArgs && !useGrid)) {
+        std::cerr << "Uso: " << argv[0] << " <boid> [grid [wide|3x3|5x5] [periodic]] [sse|avx2|avx512] [exact|fast] [drift [passi]] [hugetlb|thp|smallpages]. Uscita.\n";
+        return 1;
+    }
+    if (isa == SimdIsa::Scalar || !simdIsaSupported(isa)) {
+        std::cerr << "Kernel " << simdIsaName(isa) << " non disponibile: servono sse, avx2 o avx512. Uscita.\n";
+        return 1;
+    }
+    activeSimdIsa() = isa;
+
+    BoidArray initialState(numBoids);
+    initializeState(initialState, numBoids);
+
+    BoidCompact oldState(numBoids), newState(numBoids);
+    bindToOwnerNodes(oldState);
+    bindToOwnerNodes(newState);
+    #pragma omp parallel for default(none) shared(oldState, initialState, numBoids) schedule(static)
+    for (int i = 0; i < numBoids; ++i) {
+        oldState.set(i, initialState[i]);
+    }
+
+    UniformGrid grid(WIDTH, HEIGHT, stencilCellSize(stencil), periodic, stencilReach(stencil));
+    if (useGrid) {
+        grid.prepareParallelBuild(numBoids, omp_get_max_threads());
+        bindToOwnerNodes(grid);
+    }
+    printPageReport();
+
+    // Simulazione compatta di steps passi dallo stato iniziale in oldState
+    const auto run = [&](const int steps, StableIds* ids) {
+        if (!useGrid) return simulate(oldState, newState, numBoids, steps);
+        return dispatchGridStencil(stencil, periodic, [&](auto reach, auto periodicTag) {
+            return simulateGrid<decltype(reach)::value, decltype(periodicTag)::value>(oldState, newState, grid, ids, numBoids, steps);
+        });
+    };
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    const long long work = run(STEPS, nullptr);
+    const double elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+    constexpr int bytesPerBoid = 2 * sizeof(std::uint16_t) + 2 * sizeof(std::int16_t);
+    std::cout << "TIME=" << elapsed << " seconds" << std::endl;
+    if (!useGrid) {
+        std::cout << "MODE=full LAYOUT=compact BYTES_PER_BOID=" << bytesPerBoid << " ISA=" << simdIsaName(isa)
+                  << " PRECISION=" << precisionName(activePrecision())
+                  << " DISTANCES_PER_BOID=" << static_cast<double>(work) / (static_cast<double>(numBoids) * STEPS)
+                  << std::endl;
+    } else {
+        std::cout << "LAYOUT=compact BYTES_PER_BOID=" << bytesPerBoid << " ";
+        printStencilReport(stencil, periodic, work, numBoids, STEPS, elapsed);
+    }
+
+    if (driftSteps > 0) {
+        // Non cronometrato: driftSteps passi compatti e poi float (stessa ISA,
+        // precisione e scenario) dallo stesso stato iniziale float; con la
+        // griglia le posizioni compatte tornano nell'ordine degli id stabili
+        StableIds ids{std::vector<int>(numBoids), std::vector<int>(numBoids)};
+        for (int i = 0; i < numBoids; ++i) {
+            oldState.set(i, initialState[i]);
+            ids.current[i] = i;
+        }
+        run(driftSteps, &ids);
+
+        std::vector<Vector2> compactPositions(numBoids);
+        for (int k = 0; k < numBoids; ++k) compactPositions[ids.current[k]] = oldState.position(k);
+
+        BoidArray referenceState = initialState, referenceNext(numBoids);
+        dispatchGridStencil(stencil, periodic, [&](auto reach, auto periodicTag) {
+            return dispatchPrecision([&](auto fastTag) {
+                simulateReference<decltype(reach)::value, decltype(periodicTag)::value, decltype(fastTag)::value>(
+                    referenceState, referenceNext, useGrid ? &grid : nullptr, numBoids, driftSteps);
+                return 0LL;
+            });
+        });
+
+        const PositionDrift drift = positionDrift(boidPositions(referenceState), compactPositions);
+        std::cout << "DRIFT_MAX=" << drift.max << " DRIFT_MEAN=" << drift.mean << " STEPS=" << driftSteps << std::endl;
+    }
+    return 0;
+}
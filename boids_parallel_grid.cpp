@@ -1,4 +1,5 @@
 //boids_parallel_grid.cpp
+#include "BoidsDomains.hpp"
 #include "BoidsGrid.hpp"
 #include "BoidsCommon.hpp"
 #include <iostream>
@@ -7,55 +8,330 @@
 #include <cmath>
 #include <random>
 #include <cstdlib>
+#include <stdexcept>
 #include <omp.h>
 
-// Versione parallela di buildGrid su griglia piatta (ottimizzata)
-void parallelBuildGrid(const std::vector<Boid>& oldState,
-                        UniformGrid& grid,
-                        const float cellSize)
-{
-    const int N = static_cast<int>(oldState.size());
-    const int numCells = grid.cellCountX * grid.cellCountY;
+constexpr int STEPS = 600;
 
-    // Svuota solo le celle usate
-    #pragma omp parallel for default(none) shared(grid) schedule(static)
-    for (int i = 0; i < static_cast<int>(grid.usedCells.size()); ++i) {
-        grid.cells[grid.usedCells[i]].clear();
-    }
-    grid.usedCells.clear();
+// Manutenzione della griglia in modalità incrementale: migrazioni applicate
+// e tempi (lato master) di ricostruzioni complete e aggiornamenti incrementali.
+// Il rilevamento delle migrazioni avviene nel loop delle forze e non è incluso.
+struct GridMaintenanceStats {
+    long long migrations = 0;
+    int fullBuilds = 0;
+    int incrementalUpdates = 0;
+    double fullBuildTime = 0.0;
+    double incrementalTime = 0.0;
+};
 
-    // Prepara storage per ogni thread
-    const int maxThreads = omp_get_max_threads();
-    std::vector threadLocalCells(maxThreads, std::vector<std::vector<int>>(numCells));
+// Ciclo di simulazione specializzato sullo stencil; restituisce i candidati visitati.
+// Con le ripartizioni cost e steal i boid si dividono per costo stimato,
+// ricalcolato a ogni passo sulla griglia aggiornata (vedi partitionByCost)
+template<int Reach, bool Periodic, bool Fast>
+long long simulate(BoidArray& oldState,
+                   BoidArray& newState,
+                   UniformGrid& grid,
+                   const int numBoids,
+                   const int steps,
+                   std::vector<std::vector<GridMigration>>& migrations,
+                   GridMaintenanceStats& stats,
+                   const GridSchedule schedule,
+                   GridCostPartition& partition,
+                   ThreadBalanceStats& balance)
+{
+    long long candidates = 0;
+    bool needFullBuild = true;
 
-    // Inserisce boid nelle celle in parallelo (senza lock)
-    #pragma omp parallel default(none) shared(oldState, grid, threadLocalCells, cellSize, numCells, N)
+    #pragma omp parallel default(none) shared(oldState, newState, grid, numBoids, steps, migrations, stats, needFullBuild, schedule, partition, balance) reduction(+:candidates)
     {
         const int threadId = omp_get_thread_num();
-        auto& localCells = threadLocalCells[threadId];
-
-        #pragma omp for schedule(static)
-        for (int i = 0; i < N; ++i) {
-            auto [cellX, cellY] = getCellCoords(oldState[i].position,
-                cellSize, grid.cellCountX, grid.cellCountY);
-            const int cellIndex = grid.getCellIndex(cellX, cellY);
-            localCells[cellIndex].push_back(i);
+        const int numThreads = omp_get_num_threads();
+
+        // Buffer di migrazione privato del thread: nessuna contesa nel rilevamento
+        std::vector<GridMigration>& localMigrations = migrations[threadId];
+
+        const auto computeBoid = [&](const int i) {
+            candidates += computeNextBoidGrid<Reach, false, Periodic, Fast>(i, oldState, newState, grid);
+
+            if (grid.incremental) {
+                auto [cellX, cellY] = getCellCoords(newState[i].position, grid);
+                if (const int cell = grid.getCellIndex(cellX, cellY); cell != grid.boidCell[i]) {
+                    localMigrations.push_back({i, cell});
+                }
+            }
+        };
+
+        for (int step = 0; step < steps; ++step) {
+            if (!grid.incremental || needFullBuild) {
+                // Costruzione della griglia condivisa da tutto il team
+                const double buildStart = omp_get_wtime();
+                parallelBuildGrid(oldState, grid);
+
+                #pragma omp single nowait
+                {
+                    stats.fullBuilds++;
+                    stats.fullBuildTime += omp_get_wtime() - buildStart;
+                }
+            }
+
+            if (schedule != GridSchedule::Static) {
+                #pragma omp single
+                {
+                    partitionByCost<Reach>(grid, schedule == GridSchedule::Cost ? numThreads : numThreads * GRID_TASKS_PER_THREAD, partition);
+                }
+            }
+
+            // Lavoro del thread fino all'ultimo boid, poi attesa degli altri
+            const double forceStart = omp_get_wtime();
+            if (schedule == GridSchedule::Static) {
+                #pragma omp for schedule(static) nowait
+                for (int i = 0; i < numBoids; ++i) computeBoid(i);
+            } else if (schedule == GridSchedule::Cost) {
+                forEachBoidInPart(grid, partition, threadId, computeBoid);
+            } else {
+                #pragma omp for schedule(dynamic, 1) nowait
+                for (int part = 0; part < partition.parts; ++part) forEachBoidInPart(grid, partition, part, computeBoid);
+            }
+            const double forceEnd = omp_get_wtime();
+
+            #pragma omp barrier
+
+            balance.busy[threadId] += forceEnd - forceStart;
+            balance.idle[threadId] += omp_get_wtime() - forceEnd;
+
+            #pragma omp single
+            {
+                oldState.swap(newState);
+
+                if (grid.incremental) {
+                    const double updateStart = omp_get_wtime();
+                    for (const auto& threadMigrations : migrations) stats.migrations += threadMigrations.size();
+
+                    // Ricostruzione completa periodica, oppure se una cella è piena
+                    needFullBuild = (step + 1) % INCREMENTAL_REBUILD_PERIOD == 0
+                                 || !applyGridMigrations(grid, migrations);
+                    for (auto& threadMigrations : migrations) threadMigrations.clear();
+
+                    if (!needFullBuild) {
+                        stats.incrementalUpdates++;
+                        stats.incrementalTime += omp_get_wtime() - updateStart;
+                    }
+                }
+            }
         }
     }
+    return candidates;
+}
+
+/**
+ * Decomposizione in domini (vedi BoidsDomains.hpp): ogni thread, fissato su
+ * una CPU, possiede i boid del suo dominio. Un passo:
+ * 1) copia dell'alone dagli altri domini e griglia locale su propri + alone
+ * 2) forze dei boid propri; quelli usciti dal dominio vanno nell'outbox
+ *    del nuovo proprietario
+ * 3) dopo una barriera, owned si ricostruisce (ordinato per cella) con i
+ *    boid rimasti e quelli arrivati dagli altri domini
+ * Con Orb i domini partono dalla bisezione sul costo stimato iniziale e,
+ * ogni ORB_CHECK_PERIOD passi, se lo sbilanciamento del lavoro misurato
+ * nella finestra supera threshold si ricalcolano sulla griglia attuale e i
+ * boid delle celle cambiate di proprietario passano al nuovo dominio.
+ * Alla fine i boid tornano in oldState, in ordine di dominio.
+ * Restituisce i candidati visitati; lancia std::runtime_error se OpenMP
+ * non concede un thread per dominio.
+ */
+template<int Reach, bool Periodic, bool Fast>
+long long simulateDomains(BoidArray& oldState,
+                          const UniformGrid& geometry,
+                          const int numBoids,
+                          const int steps,
+                          const GridSchedule schedule,
+                          const double threshold,
+                          DomainDecomposition& decomposition,
+                          std::vector<DomainState>& states,
+                          ThreadBalanceStats& balance,
+                          RebalanceStats& rebalances,
+                          bool& pinned)
+{
+    const int numDomains = static_cast<int>(states.size());
+    const int numCells = geometry.numCells();
+    const bool orb = schedule == GridSchedule::Orb;
+    long long candidates = 0;
+    int pinnedThreads = 0;
+
+    const auto cellOf = [&geometry](const Boid& b) {
+        auto [cellX, cellY] = getCellCoords(b.position, geometry);
+        return geometry.getCellIndex(cellX, cellY);
+    };
+
+    std::vector<double> weights;
+    std::vector<CellRect> domains;
+    if (orb) {
+        std::vector<int> counts(numCells, 0);
+        for (int i = 0; i < numBoids; ++i) counts[cellOf(oldState[i])]++;
+        cellWeights<Reach>(geometry, [&counts](const int cell) { return counts[cell]; }, weights);
+        orbDomains(geometry, weights, numDomains, decomposition.domains);
+        assignDomains(geometry, Reach, decomposition);
+    }
+
+    // Decisione di ripartire, condivisa dal team
+    bool repartition = false;
+    double imbalance = 0.0;
+    double repartitionStart = 0.0;
+    bool fullTeam = true;
+
+    #pragma omp parallel num_threads(numDomains) default(none) shared(oldState, geometry, numBoids, steps, threshold, orb, decomposition, states, balance, rebalances, numDomains, numCells, cellOf, weights, domains, repartition, imbalance, repartitionStart, fullTeam) firstprivate(WIDTH, HEIGHT) reduction(+:candidates, pinnedThreads)
+    {
+        // Con meno thread (OMP_THREAD_LIMIT, OMP_DYNAMIC) i domini senza
+        // thread perderebbero i loro boid: nessuno lavora e si lancia dopo
+        if (omp_get_num_threads() != numDomains) {
+            #pragma omp atomic write
+            fullTeam = false;
+        } else {
+            const int d = omp_get_thread_num();
+            DomainState& state = states[d];
+            const std::vector<int>& cellOwner = decomposition.cellOwner;
+
+            // Fissato prima di creare la griglia e i buffer, che il thread tocca per primo
+            if (omp_get_proc_bind() != omp_proc_bind_false || pinCurrentThread(d)) pinnedThreads++;
+            state.grid.emplace(WIDTH, HEIGHT, geometry.cellSize, Periodic, Reach);
+
+            rebuildOwned(state, numCells, [&](auto&& callback) {
+                for (int i = 0; i < numBoids; ++i) {
+                    if (const int cell = cellOf(oldState[i]); cellOwner[cell] == d) callback(oldState[i], cell);
+                }
+            });
+            state.minOwned = state.maxOwned = static_cast<int>(state.owned.size());
+
+            #pragma omp barrier
+
+            // Barriera con il tempo di lavoro e di attesa del thread; il lavoro è
+            // aggiornato prima, così dopo la barriera è visibile a tutti
+            double mark = omp_get_wtime();
+            const auto waitAll = [&] {
+                const double arrive = omp_get_wtime();
+                balance.busy[d] += arrive - mark;
+                #pragma omp barrier
+                const double leave = omp_get_wtime();
+                balance.idle[d] += leave - arrive;
+                mark = leave;
+            };
 
-    // Merge delle celle in parallelo + tracciamento usedCells
-    #pragma omp parallel for default(none) shared(grid, threadLocalCells, numCells) schedule(static)
-    for (int i = 0; i < numCells; ++i) {
-        for (const auto& local : threadLocalCells) {
-            if (!local[i].empty()) {
-                grid.cells[i].insert(grid.cells[i].end(), local[i].begin(), local[i].end());
+            // next[0, count) con le celle in nextCell: i boid delle celle di un
+            // altro dominio sono già nei suoi outbox; owned si ricostruisce con
+            // gli altri e con quelli arrivati
+            const auto exchange = [&](const int count) {
+                // Alone letto da tutti e outbox pronti
+                waitAll();
+
+                rebuildOwned(state, numCells, [&](auto&& callback) {
+                    for (int i = 0; i < count; ++i) {
+                        if (cellOwner[state.nextCell[i]] == d) callback(state.next[i], state.nextCell[i]);
+                    }
+                    for (const DomainState& other : states) {
+                        for (const Boid& b : other.outbox[d]) callback(b, cellOf(b));
+                    }
+                });
+                state.minOwned = std::min(state.minOwned, static_cast<int>(state.owned.size()));
+                state.maxOwned = std::max(state.maxOwned, static_cast<int>(state.owned.size()));
+
+                // owned pronti per l'alone del passo successivo
+                waitAll();
+            };
+
+            for (int step = 0; step < steps; ++step) {
+                const int ownedCount = gatherHalo(state, states, decomposition.haloCells[d], cellOwner);
+                buildGrid(state.local, *state.grid);
+
+                resizeUninitialized(state.next, ownedCount);
+                state.nextCell.resize(ownedCount);
+                for (BoidArray& box : state.outbox) box.clear();
+                for (int i = 0; i < ownedCount; ++i) {
+                    candidates += computeNextBoidGrid<Reach, false, Periodic, Fast>(i, state.local, state.next, *state.grid);
+
+                    const int cell = cellOf(state.next[i]);
+                    state.nextCell[i] = cell;
+                    if (const int owner = cellOwner[cell]; owner != d) {
+                        state.outbox[owner].push_back(state.next[i]);
+                        state.migrations++;
+                    }
+                }
+
+                exchange(ownedCount);
+
+                if (!orb || (step + 1) % ORB_CHECK_PERIOD != 0) continue;
+
+                // Sbilanciamento della finestra; nessuno modifica gli stati finché
+                // tutti non escono dalla single
+                #pragma omp single
+                {
+                    repartitionStart = omp_get_wtime();
+                    double maxBusy = 0.0, sumBusy = 0.0;
+                    for (int t = 0; t < numDomains; ++t) {
+                        const double busy = balance.busy[t] - states[t].windowStart;
+                        states[t].windowStart = balance.busy[t];
+                        maxBusy = std::max(maxBusy, busy);
+                        sumBusy += busy;
+                    }
+                    imbalance = sumBusy > 0.0 ? maxBusy * numDomains / sumBusy : 1.0;
+
+                    repartition = false;
+                    if (imbalance > threshold) {
+                        cellWeights<Reach>(geometry, [&](const int cell) {
+                            const DomainState& owner = states[decomposition.cellOwner[cell]];
+                            return owner.cellEnd[cell] - owner.cellBegin[cell];
+                        }, weights);
+                        orbDomains(geometry, weights, numDomains, domains);
+
+                        const auto sameRect = [](const CellRect& a, const CellRect& b) {
+                            return a.x0 == b.x0 && a.x1 == b.x1 && a.y0 == b.y0 && a.y1 == b.y1;
+                        };
+                        repartition = !std::equal(domains.begin(), domains.end(), decomposition.domains.begin(), sameRect);
+                        if (repartition) {
+                            decomposition.domains = domains;
+                            assignDomains(geometry, Reach, decomposition);
+                        }
+                    }
+                }
+                if (!repartition) continue;
+
+                // I boid propri restano in ordine di cella; quelli delle celle
+                // passate a un altro dominio vanno nel suo outbox
+                const int count = static_cast<int>(state.owned.size());
+                resizeUninitialized(state.next, count);
+                state.nextCell.resize(count);
+                for (BoidArray& box : state.outbox) box.clear();
+                for (int cell = 0; cell < numCells; ++cell) {
+                    for (int k = state.cellBegin[cell]; k < state.cellEnd[cell]; ++k) {
+                        state.next[k] = state.owned[k];
+                        state.nextCell[k] = cell;
+                        if (const int owner = cellOwner[cell]; owner != d) {
+                            state.outbox[owner].push_back(state.owned[k]);
+                            state.rebalanceMoves++;
+                        }
+                    }
+                }
+                exchange(count);
+
+                if (d == 0) {
+                    long long moved = 0;
+                    for (const DomainState& other : states) moved += other.rebalanceMoves;
+                    const double cost = omp_get_wtime() - repartitionStart;
+                    printRebalanceLog(step + 1, imbalance, moved - rebalances.moved, cost);
+                    rebalances.count++;
+                    rebalances.time += cost;
+                    rebalances.moved = moved;
+                }
             }
-        }
-        if (!grid.cells[i].empty()) {
-            #pragma omp critical
-            grid.usedCells.push_back(i);
+
+            int offset = 0;
+            for (int other = 0; other < d; ++other) offset += static_cast<int>(states[other].owned.size());
+            std::copy(state.owned.begin(), state.owned.end(), oldState.begin() + offset);
         }
     }
+
+    if (!fullTeam) throw std::runtime_error("OpenMP non concede un thread per dominio");
+    pinned = pinnedThreads == numDomains;
+    return candidates;
 }
 
 int main(const int argc, char* argv[]) {
@@ -74,9 +350,31 @@ int main(const int argc, char* argv[]) {
         return 1;
     }
 
-    constexpr float cellSize = CELL_SIZE;
+    // Argomenti opzionali: stencil della griglia (wide, 3x3, 5x5), "periodic",
+    // "incremental", la ripartizione del loop delle forze (static, cost,
+    // steal) oppure i domini di proprietà dei thread (strips, oppure
+    // "orb [soglia]" con ripartizione dinamica; senza incremental né drift),
+    // l'ISA dei kernel (scalar, sse, avx2, avx512), la precisione (exact,
+    // fast), con fast "drift [passi]" e le pagine degli stati (hugetlb, thp,
+    // smallpages)
+    GridOptions options;
+    const bool validArgs = parseGridArgs(argc, argv, options);
+    const bool domains = options.schedule == GridSchedule::Strips || options.schedule == GridSchedule::Orb;
+    if (!validArgs || (domains && (options.incremental || options.driftSteps > 0))) {
+        std::cerr << "Uso: " << argv[0] << " <boid> [wide|3x3|5x5] [periodic] [incremental] [static|cost|steal|strips|orb [soglia]] [scalar|sse|avx2|avx512] [exact|fast [drift [passi]]] [hugetlb|thp|smallpages]. Uscita.\n";
+        return 1;
+    }
+    activeSimdIsa() = options.isa;
+    activePrecision() = options.precision;
+    activePagePolicy() = options.pages;
+    const GridStencil stencil = options.stencil;
+    const bool periodic = options.periodic;
+    const float cellSize = stencilCellSize(stencil);
 
-    std::vector<Boid> oldState(numBoids), newState(numBoids);
+    BoidArray oldState = uninitializedArray<BoidArray>(numBoids);
+    BoidArray newState = uninitializedArray<BoidArray>(numBoids);
+    bindToOwnerNodes(oldState);
+    bindToOwnerNodes(newState);
 
     const int gridSize = static_cast<int>(std::ceil(std::sqrt(numBoids)));
     const float spacingX = WIDTH / static_cast<float>(gridSize);
@@ -102,38 +400,111 @@ int main(const int argc, char* argv[]) {
         newState[i] = Boid{};
     }
 
-    UniformGrid grid(WIDTH, HEIGHT, cellSize);
-    for (auto& cell : grid.cells) cell.reserve(64);  // Prealloca spazio medio
+    // Con i domini la griglia globale serve solo come geometria: i buffer
+    // per boid stanno nelle griglie locali
+    UniformGrid grid(WIDTH, HEIGHT, cellSize, periodic, stencilReach(stencil));
+    if (!domains) {
+        grid.prepareParallelBuild(numBoids, omp_get_max_threads(), options.incremental);
+        bindToOwnerNodes(grid);
+    }
 
-    const auto start = std::chrono::high_resolution_clock::now();
+    std::vector<std::vector<GridMigration>> migrations(omp_get_max_threads());
+    GridMaintenanceStats stats;
+    GridCostPartition partition;
+    ThreadBalanceStats balance(omp_get_max_threads());
 
-    #pragma omp parallel default(none) shared(oldState, newState, grid, cellSize, numBoids)
-    {
-        constexpr int STEPS = 600;
-        for (int step = 0; step < STEPS; ++step) {
-            #pragma omp single
-            {
-                parallelBuildGrid(oldState, grid, cellSize);
-            }
+    // Un dominio per thread, con i buffer creati dentro la simulazione; Orb
+    // riparte dalla bisezione sullo stato iniziale
+    DomainDecomposition decomposition;
+    std::vector<DomainState> domainStates;
+    RebalanceStats rebalances;
+    bool pinned = false;
+    if (domains) {
+        splitIntoStrips(grid, omp_get_max_threads(), decomposition.domains);
+        assignDomains(grid, stencilReach(stencil), decomposition);
+        domainStates.reserve(decomposition.domains.size());
+        for (size_t d = 0; d < decomposition.domains.size(); ++d) domainStates.emplace_back(static_cast<int>(decomposition.domains.size()));
+    }
 
-            #pragma omp barrier
+    // Stato iniziale conservato per il report drift
+    const BoidArray initialState = options.driftSteps > 0 ? oldState : BoidArray{};
 
-            #pragma omp for schedule(static)
-            for (int i = 0; i < numBoids; ++i) {
-                computeNextBoidGrid(i, oldState, newState, grid, cellSize);
-            }
+    printPageReport();
 
-            #pragma omp single
-            {
-                oldState.swap(newState);
-            }
-        }
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    long long candidates = 0;
+    try {
+        candidates = dispatchGridStencil(stencil, periodic, [&](auto reach, auto periodicTag) {
+            return dispatchPrecision([&](auto fastTag) {
+                constexpr int R = decltype(reach)::value;
+                constexpr bool P = decltype(periodicTag)::value;
+                constexpr bool F = decltype(fastTag)::value;
+                if (domains) {
+                    return simulateDomains<R, P, F>(oldState, grid, numBoids, STEPS, options.schedule,
+                                                    options.imbalanceThreshold, decomposition,
+                                                    domainStates, balance, rebalances, pinned);
+                }
+                return simulate<R, P, F>(oldState, newState, grid, numBoids, STEPS, migrations, stats,
+                                         options.schedule, partition, balance);
+            });
+        });
+    } catch (const std::runtime_error& error) {
+        std::cerr << error.what() << " (OMP_THREAD_LIMIT, OMP_DYNAMIC?). Uscita.\n";
+        return 1;
     }
 
     const auto end = std::chrono::high_resolution_clock::now();
     const double elapsed = std::chrono::duration<double>(end - start).count();
 
     std::cout << "TIME=" << elapsed << " seconds" << std::endl;
+    printStencilReport(stencil, periodic, candidates, numBoids, STEPS, elapsed);
+    printBalanceReport(options.schedule, balance, STEPS);
+    if (domains) printDomainReport(gridScheduleName(options.schedule), domainStates, pinned, STEPS);
+    if (options.schedule == GridSchedule::Orb) {
+        std::cout << "ORB THRESHOLD=" << options.imbalanceThreshold
+                  << " REBALANCES=" << rebalances.count
+                  << " REBALANCE_MS=" << 1000.0 * rebalances.time
+                  << " MOVED_BOIDS=" << rebalances.moved << std::endl;
+    }
+
+    if (options.incremental) {
+        const double fullBuildMs = stats.fullBuilds > 0 ? 1000.0 * stats.fullBuildTime / stats.fullBuilds : 0.0;
+        const double incrementalMs = stats.incrementalUpdates > 0 ? 1000.0 * stats.incrementalTime / stats.incrementalUpdates : 0.0;
+        std::cout << "INCREMENTAL MIGRATION_RATE=" << 100.0 * static_cast<double>(stats.migrations) / (static_cast<double>(numBoids) * STEPS) << "%"
+                  << " FULL_BUILDS=" << stats.fullBuilds
+                  << " INCREMENTAL_UPDATES=" << stats.incrementalUpdates
+                  << " FULL_BUILD_MS=" << fullBuildMs
+                  << " INCREMENTAL_MS=" << incrementalMs
+                  << " SAVED_MS_PER_STEP=" << fullBuildMs - incrementalMs << std::endl;
+    }
+
+    if (options.driftSteps > 0) {
+        // Non cronometrato: driftSteps passi in exact, in fast (stessa ISA) e
+        // in exact con le somme in un altro ordine, dallo stesso stato iniziale
+        const SimdIsa isa = activeSimdIsa();
+        const auto run = [&](const Precision precision, const SimdIsa runIsa) {
+            oldState = initialState;
+            activePrecision() = precision;
+            activeSimdIsa() = runIsa;
+            GridMaintenanceStats driftStats;
+            ThreadBalanceStats driftBalance(omp_get_max_threads());
+            dispatchGridStencil(stencil, periodic, [&](auto reach, auto periodicTag) {
+                return dispatchPrecision([&](auto fastTag) {
+                    return simulate<decltype(reach)::value, decltype(periodicTag)::value, decltype(fastTag)::value>(
+                        oldState, newState, grid, numBoids, options.driftSteps, migrations, driftStats,
+                        options.schedule, partition, driftBalance);
+                });
+            });
+            return boidPositions(oldState);
+        };
+        const std::vector<Vector2> exactPositions = run(Precision::Exact, isa);
+        const PositionDrift drift = positionDrift(exactPositions, run(Precision::Fast, isa));
+        const PositionDrift baseline = positionDrift(exactPositions, run(Precision::Exact, reorderedSumsIsa(isa)));
+        std::cout << "DRIFT_MAX=" << drift.max << " DRIFT_MEAN=" << drift.mean
+                  << " BASELINE_MAX=" << baseline.max << " BASELINE_MEAN=" << baseline.mean
+                  << " STEPS=" << options.driftSteps << std::endl;
+    }
     return 0;
 }
 
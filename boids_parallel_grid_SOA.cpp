@@ -0,0 +1,134 @@
+//boids_parallel_grid_SOA.cpp
+#include "BoidsGridSOA.hpp"
+#include "BoidsCommon.hpp"
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <omp.h>
+
+// Griglia e layout SoA insieme: stato in array separati riordinati per
+// cella a ogni passo (come ParallelGridSorted) e regole vettoriali con una
+// corsia per boid bersaglio (come la variante outer di ParSOAHeadless), così
+// SIMD e lavoro O(N·k) si sommano.
+
+constexpr int STEPS = 600;
+
+// Ciclo di simulazione specializzato sullo stencil; restituisce i candidati visitati
+template<int Reach, bool Periodic>
+long long simulate(BoidSoA& oldState,
+                   BoidSoA& sortedState,
+                   UniformGrid& grid,
+                   const int numBoids)
+{
+    const CellKernelSoA kernel = selectCellKernelSoA<Reach, Periodic>(activeSimdIsa(), activePrecision());
+    long long candidates = 0;
+
+    #pragma omp parallel default(none) shared(oldState, sortedState, grid, numBoids, kernel) reduction(+:candidates)
+    {
+        for (int step = 0; step < STEPS; ++step) {
+            parallelBuildGridFrom(numBoids, SoAPosition{oldState}, grid);
+            permuteByCellSoA(oldState, sortedState, grid, numBoids);
+
+            // Lo stato nuovo va in oldState, già consumato dalla permutazione;
+            // le celle dense costano molto più di quelle vuote
+            #pragma omp for schedule(dynamic, 16)
+            for (int c = 0; c < grid.numCells(); ++c) {
+                candidates += kernel(c, sortedState, oldState, grid);
+            }
+        }
+    }
+    return candidates;
+}
+
+int main(const int argc, char* argv[]) {
+    int numBoids = 0;
+
+    if (argc > 1) {
+        char* end;
+        if (const long val = std::strtol(argv[1], &end, 10); *end == '\0' && val > 0) {
+            numBoids = static_cast<int>(val);
+        } else {
+            std::cerr << "Argomento non valido. Uscita.\n";
+            return 1;
+        }
+    } else {
+        std::cerr << "Numero di boid non specificato. Uscita.\n";
+        return 1;
+    }
+
+    // Argomenti opzionali: stencil della griglia (wide, 3x3, 5x5), "periodic",
+    // l'ISA dei kernel (sse, avx2, avx512), la precisione (exact, fast) e le
+    // pagine degli stati (hugetlb, thp, smallpages)
+    GridOptions options;
+    if (!parseGridArgs(argc, argv, options) || options.incremental || options.driftSteps > 0
+        || options.schedule != GridSchedule::Static) {
+        std::cerr << "Uso: " << argv[0] << " <boid> [wide|3x3|5x5] [periodic] [sse|avx2|avx512] [exact|fast] [hugetlb|thp|smallpages]. Uscita.\n";
+        return 1;
+    }
+    if (options.isa == SimdIsa::Scalar) {
+        std::cerr << "ParallelGridSoA richiede un kernel SIMD (sse, avx2, avx512). Uscita.\n";
+        return 1;
+    }
+    activeSimdIsa() = options.isa;
+    activePrecision() = options.precision;
+    activePagePolicy() = options.pages;
+    const GridStencil stencil = options.stencil;
+    const bool periodic = options.periodic;
+    const float cellSize = stencilCellSize(stencil);
+
+    // oldState: stato corrente (ordine qualsiasi), sortedState: copia ordinata per cella
+    BoidSoA oldState(numBoids), sortedState(numBoids);
+    bindToOwnerNodes(oldState);
+    bindToOwnerNodes(sortedState);
+
+    const int gridSize = static_cast<int>(std::ceil(std::sqrt(numBoids)));
+    const float spacingX = WIDTH / static_cast<float>(gridSize);
+    const float spacingY = HEIGHT / static_cast<float>(gridSize);
+    constexpr float centerX = WIDTH / 2.0f;
+    constexpr float centerY = HEIGHT / 2.0f;
+
+    #pragma omp parallel for default(none) shared(oldState, numBoids, gridSize, spacingX, spacingY) firstprivate(centerX, centerY) schedule(static)
+    for (int i = 0; i < numBoids; ++i) {
+        const int row = i / gridSize;
+        const int col = i % gridSize;
+        const float posX = static_cast<float>(col) * spacingX + spacingX / 2.0f;
+        const float posY = static_cast<float>(row) * spacingY + spacingY / 2.0f;
+
+        oldState.posX[i] = posX;
+        oldState.posY[i] = posY;
+
+        const float angle = std::atan2(posY - centerY, posX - centerX);
+        oldState.velX[i] = std::cos(angle) * MAX_SPEED;
+        oldState.velY[i] = std::sin(angle) * MAX_SPEED;
+    }
+
+    // First-touch della copia ordinata
+    #pragma omp parallel for default(none) shared(sortedState, numBoids) schedule(static)
+    for (int i = 0; i < numBoids; ++i) {
+        sortedState.posX[i] = 0.0f;
+        sortedState.posY[i] = 0.0f;
+        sortedState.velX[i] = 0.0f;
+        sortedState.velY[i] = 0.0f;
+    }
+
+    UniformGrid grid(WIDTH, HEIGHT, cellSize, periodic, stencilReach(stencil));
+    grid.prepareParallelBuild(numBoids, omp_get_max_threads());
+    bindToOwnerNodes(grid);
+
+    printPageReport();
+
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    const long long candidates = dispatchGridStencil(stencil, periodic, [&](auto reach, auto periodicTag) {
+        return simulate<decltype(reach)::value, decltype(periodicTag)::value>(oldState, sortedState, grid, numBoids);
+    });
+
+    const auto end = std::chrono::high_resolution_clock::now();
+    const double elapsed = std::chrono::duration<double>(end - start).count();
+
+    std::cout << "TIME=" << elapsed << " seconds" << std::endl;
+    printStencilReport(stencil, periodic, candidates, numBoids, STEPS, elapsed);
+    return 0;
+}
@@ -0,0 +1,148 @@
+//boids_parallel_grid_half.cpp
+#include "BoidsGridHalf.hpp"
+#include "BoidsCommon.hpp"
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <omp.h>
+
+// Variante di ParallelGrid che valuta ogni coppia una sola volta (metà
+// stencil) e distribuisce i contributi a entrambi i boid tramite
+// accumulatori privati dei thread, limitati alla fascia di righe del thread
+// e al suo alone (vedi BoidsGridHalf.hpp) e ridotti dal proprietario.
+// Le fasce sono statiche e bilanciate sul numero di boid.
+
+constexpr int STEPS = 600;
+
+// Ciclo di simulazione specializzato sullo stencil; restituisce le coppie valutate
+template<int Reach, bool Periodic, bool Fast>
+long long simulate(BoidArray& oldState,
+                   BoidArray& newState,
+                   UniformGrid& grid,
+                   HalfPairAccumulators& accumulators,
+                   const int numBoids)
+{
+    long long pairs = 0;
+
+    #pragma omp parallel default(none) shared(oldState, newState, grid, accumulators, numBoids) reduction(+:pairs)
+    {
+        const int thread = omp_get_thread_num();
+        const int numThreads = omp_get_num_threads();
+        HalfPairBand& band = accumulators.bands[thread];
+
+        for (int step = 0; step < STEPS; ++step) {
+            parallelBuildGrid(oldState, grid);
+
+            // Accumulatori allocati e azzerati dal proprietario (first-touch)
+            assignHalfPairBand<Reach, Periodic>(grid, numBoids, thread, numThreads, band);
+            const int cellEnd = band.rowEnd * grid.cellCountX;
+            for (int c = band.rowBegin * grid.cellCountX; c < cellEnd; ++c) {
+                pairs += accumulateCellPairs<Reach, Periodic, Fast>(c, oldState, grid, band);
+            }
+
+            #pragma omp barrier
+
+            collectHalfPairContributors(accumulators, thread, numThreads);
+            finishBandHalfPair<Fast>(thread, oldState, newState, grid, accumulators);
+
+            #pragma omp barrier
+
+            #pragma omp single
+            {
+                oldState.swap(newState);
+            }
+        }
+    }
+    return pairs;
+}
+
+int main(const int argc, char* argv[]) {
+    int numBoids = 0;
+
+    if (argc > 1) {
+        char* end;
+        if (const long val = std::strtol(argv[1], &end, 10); *end == '\0' && val > 0) {
+            numBoids = static_cast<int>(val);
+        } else {
+            std::cerr << "Argomento non valido. Uscita.\n";
+            return 1;
+        }
+    } else {
+        std::cerr << "Numero di boid non specificato. Uscita.\n";
+        return 1;
+    }
+
+    // Argomenti opzionali: stencil della griglia (wide, 3x3, 5x5), "periodic",
+    // l'ISA (solo scalar), la precisione (exact, fast) e le pagine degli stati
+    // (hugetlb, thp, smallpages)
+    GridOptions options;
+    if (!parseGridArgs(argc, argv, options) || options.incremental || options.driftSteps > 0
+        || options.schedule != GridSchedule::Static || (options.explicitIsa && options.isa != SimdIsa::Scalar)) {
+        std::cerr << "Uso: " << argv[0] << " <boid> [wide|3x3|5x5] [periodic] [scalar] [exact|fast] [hugetlb|thp|smallpages]. Uscita.\n";
+        return 1;
+    }
+    activePrecision() = options.precision;
+    activePagePolicy() = options.pages;
+    // Le coppie simmetriche usano accumulatePair, scalare: un'ISA vettoriale
+    // esplicita è rifiutata sopra, il report dichiara scalar
+    activeSimdIsa() = SimdIsa::Scalar;
+    const GridStencil stencil = options.stencil;
+    const bool periodic = options.periodic;
+    const float cellSize = stencilCellSize(stencil);
+
+    BoidArray oldState = uninitializedArray<BoidArray>(numBoids);
+    BoidArray newState = uninitializedArray<BoidArray>(numBoids);
+    bindToOwnerNodes(oldState);
+    bindToOwnerNodes(newState);
+
+    const int gridSize = static_cast<int>(std::ceil(std::sqrt(numBoids)));
+    const float spacingX = WIDTH / static_cast<float>(gridSize);
+    const float spacingY = HEIGHT / static_cast<float>(gridSize);
+    constexpr float centerX = WIDTH / 2.0f;
+    constexpr float centerY = HEIGHT / 2.0f;
+
+    #pragma omp parallel for default(none) shared(oldState, numBoids, gridSize, spacingX, spacingY) firstprivate(centerX, centerY) schedule(static)
+    for (int i = 0; i < numBoids; ++i) {
+        const int row = i / gridSize;
+        const int col = i % gridSize;
+        const float posX = static_cast<float>(col) * spacingX + spacingX / 2.0f;
+        const float posY = static_cast<float>(row) * spacingY + spacingY / 2.0f;
+
+        oldState[i].position = { posX, posY };
+
+        const float angle = std::atan2(posY - centerY, posX - centerX);
+        oldState[i].velocity = { std::cos(angle) * MAX_SPEED, std::sin(angle) * MAX_SPEED };
+    }
+
+    #pragma omp parallel for default(none) shared(newState, numBoids) schedule(static)
+    for (int i = 0; i < numBoids; ++i) {
+        newState[i] = Boid{};
+    }
+
+    UniformGrid grid(WIDTH, HEIGHT, cellSize, periodic, stencilReach(stencil));
+    grid.prepareParallelBuild(numBoids, omp_get_max_threads());
+    bindToOwnerNodes(grid);
+
+    HalfPairAccumulators accumulators(omp_get_max_threads());
+
+    printPageReport();
+
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    const long long pairs = dispatchGridStencil(stencil, periodic, [&](auto reach, auto periodicTag) {
+        return dispatchPrecision([&](auto fastTag) {
+            return simulate<decltype(reach)::value, decltype(periodicTag)::value, decltype(fastTag)::value>(
+                oldState, newState, grid, accumulators, numBoids);
+        });
+    });
+
+    const auto end = std::chrono::high_resolution_clock::now();
+    const double elapsed = std::chrono::duration<double>(end - start).count();
+
+    std::cout << "TIME=" << elapsed << " seconds" << std::endl;
+    // Distanze calcolate per boid: circa la metà dei candidati di ParallelGrid
+    printStencilReport(stencil, periodic, pairs, numBoids, STEPS, elapsed);
+    return 0;
+}
@@ -0,0 +1,146 @@
+//boids_parallel_grid_sorted.cpp
+#include "BoidsGrid.hpp"
+#include "BoidsCommon.hpp"
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <omp.h>
+
+// Variante di ParallelGrid con lo stato riordinato fisicamente per cella:
+// a ogni passo oldState viene permutato nell'ordine di cellIndices, così i
+// boid di una cella sono contigui e il loop sui vicini legge memoria
+// consecutiva invece di saltare con current[otherIdx].
+// boidIds[k] conserva l'id stabile del boid che si trova nello slot k.
+
+constexpr int STEPS = 600;
+
+// Ciclo di simulazione specializzato sullo stencil; restituisce i candidati visitati
+template<int Reach, bool Periodic, bool Fast>
+long long simulate(BoidArray& oldState,
+                   BoidArray& sortedState,
+                   std::vector<int>& boidIds,
+                   std::vector<int>& sortedIds,
+                   UniformGrid& grid,
+                   const int numBoids)
+{
+    long long candidates = 0;
+
+    #pragma omp parallel default(none) shared(oldState, sortedState, boidIds, sortedIds, grid, numBoids) reduction(+:candidates)
+    {
+        for (int step = 0; step < STEPS; ++step) {
+            parallelBuildGrid(oldState, grid);
+
+            // Permutazione dello stato (e degli id) nell'ordine delle celle
+            #pragma omp for schedule(static)
+            for (int k = 0; k < numBoids; ++k) {
+                const int src = grid.cellIndices[k];
+                sortedState[k] = oldState[src];
+                sortedIds[k] = boidIds[src];
+            }
+
+            #pragma omp single
+            {
+                boidIds.swap(sortedIds);
+            }
+
+            // Lo stato nuovo viene scritto in oldState, già consumato dalla
+            // permutazione: nessuno swap, e resta quasi ordinato per il passo dopo
+            #pragma omp for schedule(static)
+            for (int k = 0; k < numBoids; ++k) {
+                candidates += computeNextBoidGrid<Reach, true, Periodic, Fast>(k, sortedState, oldState, grid);
+            }
+        }
+    }
+    return candidates;
+}
+
+int main(const int argc, char* argv[]) {
+    int numBoids = 0;
+
+    if (argc > 1) {
+        char* end;
+        if (const long val = std::strtol(argv[1], &end, 10); *end == '\0' && val > 0) {
+            numBoids = static_cast<int>(val);
+        } else {
+            std::cerr << "Argomento non valido. Uscita.\n";
+            return 1;
+        }
+    } else {
+        std::cerr << "Numero di boid non specificato. Uscita.\n";
+        return 1;
+    }
+
+    // Argomenti opzionali: stencil della griglia (wide, 3x3, 5x5), "periodic"
+    // l'ISA dei kernel (scalar, sse, avx2, avx512), la precisione (exact,
+    // fast) e le pagine degli stati (hugetlb, thp, smallpages)
+    GridOptions options;
+    if (!parseGridArgs(argc, argv, options) || options.incremental || options.driftSteps > 0
+        || options.schedule != GridSchedule::Static) {
+        std::cerr << "Uso: " << argv[0] << " <boid> [wide|3x3|5x5] [periodic] [scalar|sse|avx2|avx512] [exact|fast] [hugetlb|thp|smallpages]. Uscita.\n";
+        return 1;
+    }
+    activeSimdIsa() = options.isa;
+    activePrecision() = options.precision;
+    activePagePolicy() = options.pages;
+    const GridStencil stencil = options.stencil;
+    const bool periodic = options.periodic;
+    const float cellSize = stencilCellSize(stencil);
+
+    // oldState: stato corrente (ordine qualsiasi), sortedState: copia ordinata per cella
+    BoidArray oldState = uninitializedArray<BoidArray>(numBoids);
+    BoidArray sortedState = uninitializedArray<BoidArray>(numBoids);
+    bindToOwnerNodes(oldState);
+    bindToOwnerNodes(sortedState);
+    std::vector<int> boidIds(numBoids), sortedIds(numBoids);
+
+    const int gridSize = static_cast<int>(std::ceil(std::sqrt(numBoids)));
+    const float spacingX = WIDTH / static_cast<float>(gridSize);
+    const float spacingY = HEIGHT / static_cast<float>(gridSize);
+    constexpr float centerX = WIDTH / 2.0f;
+    constexpr float centerY = HEIGHT / 2.0f;
+
+    #pragma omp parallel for default(none) shared(oldState, boidIds, numBoids, gridSize, spacingX, spacingY) firstprivate(centerX, centerY) schedule(static)
+    for (int i = 0; i < numBoids; ++i) {
+        const int row = i / gridSize;
+        const int col = i % gridSize;
+        const float posX = static_cast<float>(col) * spacingX + spacingX / 2.0f;
+        const float posY = static_cast<float>(row) * spacingY + spacingY / 2.0f;
+
+        oldState[i].position = { posX, posY };
+
+        const float angle = std::atan2(posY - centerY, posX - centerX);
+        oldState[i].velocity = { std::cos(angle) * MAX_SPEED, std::sin(angle) * MAX_SPEED };
+        boidIds[i] = i;
+    }
+
+    // First-touch della copia ordinata
+    #pragma omp parallel for default(none) shared(sortedState, sortedIds, numBoids) schedule(static)
+    for (int i = 0; i < numBoids; ++i) {
+        sortedState[i] = Boid{};
+        sortedIds[i] = 0;
+    }
+
+    UniformGrid grid(WIDTH, HEIGHT, cellSize, periodic, stencilReach(stencil));
+    grid.prepareParallelBuild(numBoids, omp_get_max_threads());
+    bindToOwnerNodes(grid);
+
+    printPageReport();
+
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    const long long candidates = dispatchGridStencil(stencil, periodic, [&](auto reach, auto periodicTag) {
+        return dispatchPrecision([&](auto fastTag) {
+            return simulate<decltype(reach)::value, decltype(periodicTag)::value, decltype(fastTag)::value>(
+                oldState, sortedState, boidIds, sortedIds, grid, numBoids);
+        });
+    });
+
+    const auto end = std::chrono::high_resolution_clock::now();
+    const double elapsed = std::chrono::duration<double>(end - start).count();
+
+    std::cout << "TIME=" << elapsed << " seconds" << std::endl;
+    printStencilReport(stencil, periodic, candidates, numBoids, STEPS, elapsed);
+    return 0;
+}
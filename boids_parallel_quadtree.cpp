@@ -0,0 +1,136 @@
+//boids_parallel_quadtree.cpp
+#include "BoidsQuadtree.hpp"
+#include "BoidsCommon.hpp"
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <omp.h>
+
+// Variante di ParallelGrid con un quadtree adattivo sotto ogni cella:
+// il costo per boid resta vicino al numero di vicini reali anche quando
+// il flock collassa in pochi gruppi molto densi.
+
+constexpr int STEPS = 600;
+
+template<bool Periodic, bool Fast>
+long long simulate(BoidArray& oldState,
+                   BoidArray& newState,
+                   QuadtreeForest& forest,
+                   const int numBoids)
+{
+    long long candidates = 0;
+
+    #pragma omp parallel default(none) shared(oldState, newState, forest, numBoids) reduction(+:candidates)
+    {
+        for (int step = 0; step < STEPS; ++step) {
+            parallelBuildQuadtree(oldState, forest);
+
+            #pragma omp for schedule(static)
+            for (int i = 0; i < numBoids; ++i) {
+                candidates += computeNextBoidQuadtree<Periodic, Fast>(i, oldState, newState, forest);
+            }
+
+            #pragma omp single
+            {
+                oldState.swap(newState);
+            }
+        }
+    }
+    return candidates;
+}
+
+int main(const int argc, char* argv[]) {
+    int numBoids = 0;
+
+    if (argc > 1) {
+        char* end;
+        if (const long val = std::strtol(argv[1], &end, 10); *end == '\0' && val > 0) {
+            numBoids = static_cast<int>(val);
+        } else {
+            std::cerr << "Argomento non valido. Uscita.\n";
+            return 1;
+        }
+    } else {
+        std::cerr << "Numero di boid non specificato. Uscita.\n";
+        return 1;
+    }
+
+    // Argomenti opzionali, in qualsiasi ordine: la capacità delle foglie (un
+    // intero positivo), "periodic", la precisione e le pagine degli stati
+    int leafCapacity = DEFAULT_LEAF_CAPACITY;
+    bool periodic = false;
+    bool validArgs = true;
+    for (int a = 2; validArgs && a < argc; ++a) {
+        char* end;
+        if (const long val = std::strtol(argv[a], &end, 10); *end == '\0' && val > 0) {
+            leafCapacity = static_cast<int>(val);
+        } else if (std::strcmp(argv[a], "periodic") == 0) {
+            periodic = true;
+        } else if (!parsePrecision(argv[a], activePrecision()) && !parsePagePolicy(argv[a], activePagePolicy())) {
+            validArgs = false;
+        }
+    }
+    if (!validArgs) {
+        std::cerr << "Uso: " << argv[0] << " <boid> [leafCapacity] [periodic] [exact|fast] [hugetlb|thp|smallpages]. Uscita.\n";
+        return 1;
+    }
+
+    BoidArray oldState = uninitializedArray<BoidArray>(numBoids);
+    BoidArray newState = uninitializedArray<BoidArray>(numBoids);
+    bindToOwnerNodes(oldState);
+    bindToOwnerNodes(newState);
+
+    const int gridSize = static_cast<int>(std::ceil(std::sqrt(numBoids)));
+    const float spacingX = WIDTH / static_cast<float>(gridSize);
+    const float spacingY = HEIGHT / static_cast<float>(gridSize);
+    constexpr float centerX = WIDTH / 2.0f;
+    constexpr float centerY = HEIGHT / 2.0f;
+
+    #pragma omp parallel for default(none) shared(oldState, numBoids, gridSize, spacingX, spacingY) firstprivate(centerX, centerY) schedule(static)
+    for (int i = 0; i < numBoids; ++i) {
+        const int row = i / gridSize;
+        const int col = i % gridSize;
+        const float posX = static_cast<float>(col) * spacingX + spacingX / 2.0f;
+        const float posY = static_cast<float>(row) * spacingY + spacingY / 2.0f;
+
+        oldState[i].position = { posX, posY };
+
+        const float angle = std::atan2(posY - centerY, posX - centerX);
+        oldState[i].velocity = { std::cos(angle) * MAX_SPEED, std::sin(angle) * MAX_SPEED };
+    }
+
+    #pragma omp parallel for default(none) shared(newState, numBoids) schedule(static)
+    for (int i = 0; i < numBoids; ++i) {
+        newState[i] = Boid{};
+    }
+
+    QuadtreeForest forest(WIDTH, HEIGHT, leafCapacity, periodic);
+    forest.grid.prepareParallelBuild(numBoids, omp_get_max_threads());
+    bindToOwnerNodes(forest.grid);
+
+    printPageReport();
+
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    const long long candidates = dispatchPrecision([&](auto fastTag) {
+        constexpr bool Fast = decltype(fastTag)::value;
+        return periodic
+            ? simulate<true, Fast>(oldState, newState, forest, numBoids)
+            : simulate<false, Fast>(oldState, newState, forest, numBoids);
+    });
+
+    const auto end = std::chrono::high_resolution_clock::now();
+    const double elapsed = std::chrono::duration<double>(end - start).count();
+
+    const double boidSteps = static_cast<double>(numBoids) * STEPS;
+    std::cout << "TIME=" << elapsed << " seconds" << std::endl;
+    std::cout << "LEAF_CAPACITY=" << leafCapacity << (periodic ? " PERIODIC" : "")
+              << " PRECISION=" << precisionName(activePrecision())
+              << " NODES=" << forest.nodeCount()
+              << " CANDIDATES_PER_BOID=" << static_cast<double>(candidates) / boidSteps
+              << " THROUGHPUT=" << boidSteps / elapsed << " boid-steps/s" << std::endl;
+    return 0;
+}
@@ -0,0 +1,242 @@
+//boids_parallel_team.cpp
+#include "BoidsTeam.hpp"
+#include "BoidsGrid.hpp"
+#include "BoidsUpdate.hpp"
+#include "BoidsCommon.hpp"
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <omp.h>
+
+// Stessi passi di ParHeadless (brute force) e ParallelGrid ("grid") con due
+// esecutori: "team" (default) usa la squadra persistente di BoidsTeam.hpp,
+// un punto di sincronizzazione per passo; "omp" la regione OpenMP con
+// omp for e omp single degli altri motori. I thread sono OMP_NUM_THREADS
+// in entrambi i casi, per confrontare la latenza del passo a pochi boid.
+// Con la griglia entrambi ricostruiscono a ogni passo una griglia privata
+// per thread (buildGrid, vedi simulateTeam): cambia solo la sincronizzazione.
+
+constexpr int STEPS = 600;
+
+// Boid [begin, end) del reticolo iniziale, come negli altri motori
+void initializeRange(BoidArray& state, const int numBoids, const int begin, const int end) {
+    const int gridSize = static_cast<int>(std::ceil(std::sqrt(numBoids)));
+    const float spacingX = WIDTH / static_cast<float>(gridSize);
+    const float spacingY = HEIGHT / static_cast<float>(gridSize);
+    constexpr float centerX = WIDTH / 2.0f;
+    constexpr float centerY = HEIGHT / 2.0f;
+
+    for (int i = begin; i < end; ++i) {
+        const int row = i / gridSize;
+        const int col = i % gridSize;
+        const float posX = static_cast<float>(col) * spacingX + spacingX / 2.0f;
+        const float posY = static_cast<float>(row) * spacingY + spacingY / 2.0f;
+
+        const float angle = std::atan2(posY - centerY, posX - centerX);
+        state[i] = {{posX, posY}, {std::cos(angle) * MAX_SPEED, std::sin(angle) * MAX_SPEED}};
+    }
+}
+
+/**
+ * Squadra: ogni thread calcola il proprio intervallo, attende gli altri e
+ * scambia i propri puntatori ai buffer. Con la griglia ogni thread ne
+ * ricostruisce una privata dallo stato completo (buildGrid, O(N) senza
+ * sincronizzazione): a 1k-10k boid costa meno delle barriere della
+ * costruzione parallela. Il risultato resta in oldState; restituisce i
+ * candidati visitati (0 senza griglia).
+ */
+template<int Reach, bool Periodic, bool Fast>
+long long simulateTeam(ThreadTeam& team, BoidArray& oldState, BoidArray& newState,
+                       const bool useGrid, const GridStencil stencil, const int numBoids, const int steps)
+{
+    std::vector<long long> candidates(static_cast<size_t>(team.size()) * 8, 0); // una linea di cache per thread
+
+    auto body = [&](const int thread) {
+        const auto [begin, end] = team.range(thread, numBoids);
+        BoidArray* current = &oldState;
+        BoidArray* next = &newState;
+        UniformGrid grid(WIDTH, HEIGHT, stencilCellSize(stencil), Periodic, Reach);
+        long long visited = 0;
+
+        for (int step = 0; step < steps; ++step) {
+            if (useGrid) {
+                buildGrid(*current, grid);
+                for (int i = begin; i < end; ++i) {
+                    visited += computeNextBoidGrid<Reach, false, Periodic, Fast>(i, *current, *next, grid);
+                }
+            } else {
+                for (int i = begin; i < end; ++i) {
+                    computeNextBoid<Fast>(i, *current, *next);
+                }
+            }
+
+            team.wait(thread);
+            std::swap(current, next);
+        }
+        candidates[static_cast<size_t>(thread) * 8] = visited;
+    };
+    team.run(body);
+
+    if (steps % 2 != 0) oldState.swap(newState);
+    long long total = 0;
+    for (int t = 0; t < team.size(); ++t) total += candidates[static_cast<size_t>(t) * 8];
+    return total;
+}
+
+// OpenMP, come ParHeadless e ParallelGrid ma con la griglia privata di
+// simulateTeam: il risultato resta in oldState
+template<int Reach, bool Periodic, bool Fast>
+long long simulateOmp(BoidArray& oldState, BoidArray& newState,
+                      const bool useGrid, const GridStencil stencil, const int numBoids, const int steps)
+{
+    long long candidates = 0;
+
+    #pragma omp parallel default(none) shared(oldState, newState, useGrid, stencil, numBoids, steps) firstprivate(WIDTH, HEIGHT) reduction(+:candidates)
+    {
+        UniformGrid grid(WIDTH, HEIGHT, stencilCellSize(stencil), Periodic, Reach);
+        for (int step = 0; step < steps; ++step) {
+            if (useGrid) {
+                buildGrid(oldState, grid);
+
+                #pragma omp for schedule(static)
+                for (int i = 0; i < numBoids; ++i) {
+                    candidates += computeNextBoidGrid<Reach, false, Periodic, Fast>(i, oldState, newState, grid);
+                }
+            } else {
+                #pragma omp for schedule(static)
+                for (int i = 0; i < numBoids; ++i) {
+                    computeNextBoid<Fast>(i, oldState, newState);
+                }
+            }
+
+            #pragma omp single
+            {
+                oldState.swap(newState);
+            }
+        }
+    }
+    return candidates;
+}
+
+int main(const int argc, char* argv[]) {
+    int numBoids = 0;
+
+    if (argc > 1) {
+        char* end;
+        if (const long val = std::strtol(argv[1], &end, 10); *end == '\0' && val > 0) {
+            numBoids = static_cast<int>(val);
+        } else {
+            std::cerr << "Argomento non valido. Uscita.\n";
+            return 1;
+        }
+    } else {
+        std::cerr << "Numero di boid non specificato. Uscita.\n";
+        return 1;
+    }
+
+    // Argomenti opzionali, in qualsiasi ordine: l'esecutore (team, omp),
+    // l'attesa della barriera della squadra (spin, yield), "grid" con stencil
+    // (wide, 3x3, 5x5) e "periodic", l'ISA dei kernel, la precisione e le
+    // pagine degli stati
+    bool useTeam = true;
+    SpinBackoff backoff = SpinBackoff::Yield;
+    bool useGrid = false;
+    GridStencil stencil = DEFAULT_STENCIL;
+    bool periodic = false;
+    bool gridOnlyArgs = false;
+    SimdIsa isa = detectSimdIsa();
+    bool validArgs = true;
+    for (int a = 2; validArgs && a < argc; ++a) {
+        if (std::strcmp(argv[a], "team") == 0) {
+            useTeam = true;
+        } else if (std::strcmp(argv[a], "omp") == 0) {
+            useTeam = false;
+        } else if (std::strcmp(argv[a], "grid") == 0) {
+            useGrid = true;
+        } else if (std::strcmp(argv[a], "periodic") == 0) {
+            periodic = gridOnlyArgs = true;
+        } else if (parseGridStencil(argv[a], stencil)) {
+            gridOnlyArgs = true;
+        } else if (!parseSpinBackoff(argv[a], backoff) && !parseSimdIsa(argv[a], isa)
+                   && !parsePrecision(argv[a], activePrecision()) && !parsePagePolicy(argv[a], activePagePolicy())) {
+            validArgs = false;
+        }
+    }
+    if (!validArgs || (gridOnlyArgs && !useGrid)) {
+        std::cerr << "Uso: " << argv[0] << " <boid> [team|omp] [spin|yield] [grid [wide|3x3|5x5] [periodic]] [scalar|sse|avx2|avx512] [exact|fast] [hugetlb|thp|smallpages]. Uscita.\n";
+        return 1;
+    }
+    if (!simdIsaSupported(isa)) {
+        std::cerr << "ISA " << simdIsaName(isa) << " non supportata da questa CPU. Uscita.\n";
+        return 1;
+    }
+    activeSimdIsa() = isa;
+
+    const int threads = omp_get_max_threads();
+    BoidArray oldState = uninitializedArray<BoidArray>(numBoids);
+    BoidArray newState = uninitializedArray<BoidArray>(numBoids);
+    long long candidates = 0;
+    double elapsed = 0.0;
+    bool pinned = false;
+
+    if (useTeam) {
+        // First-touch e inizializzazione dai thread della squadra, sugli
+        // stessi intervalli dei passi
+        ThreadTeam team(threads, backoff);
+        pinned = team.pinned();
+        auto initialize = [&](const int thread) {
+            const auto [begin, end] = team.range(thread, numBoids);
+            initializeRange(oldState, numBoids, begin, end);
+            std::fill(newState.begin() + begin, newState.begin() + end, Boid{});
+        };
+        team.run(initialize);
+        printPageReport();
+
+        const auto start = std::chrono::high_resolution_clock::now();
+        candidates = dispatchGridStencil(stencil, periodic, [&](auto reach, auto periodicTag) {
+            return dispatchPrecision([&](auto fastTag) {
+                return simulateTeam<decltype(reach)::value, decltype(periodicTag)::value, decltype(fastTag)::value>(
+                    team, oldState, newState, useGrid, stencil, numBoids, STEPS);
+            });
+        });
+        elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    } else {
+        bindToOwnerNodes(oldState);
+        bindToOwnerNodes(newState);
+        #pragma omp parallel default(none) shared(oldState, newState, numBoids)
+        {
+            #pragma omp for schedule(static)
+            for (int i = 0; i < numBoids; ++i) newState[i] = Boid{};
+
+            const int thread = omp_get_thread_num();
+            const int numThreads = omp_get_num_threads();
+            initializeRange(oldState, numBoids, static_cast<int>(static_cast<long long>(numBoids) * thread / numThreads),
+                            static_cast<int>(static_cast<long long>(numBoids) * (thread + 1) / numThreads));
+        }
+
+        printPageReport();
+
+        const auto start = std::chrono::high_resolution_clock::now();
+        candidates = dispatchGridStencil(stencil, periodic, [&](auto reach, auto periodicTag) {
+            return dispatchPrecision([&](auto fastTag) {
+                return simulateOmp<decltype(reach)::value, decltype(periodicTag)::value, decltype(fastTag)::value>(
+                    oldState, newState, useGrid, stencil, numBoids, STEPS);
+            });
+        });
+        elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    std::cout << "TIME=" << elapsed << " seconds" << std::endl;
+    std::cout << "BACKEND=" << (useTeam ? "team" : "omp") << " THREADS=" << threads;
+    if (useTeam) std::cout << " BACKOFF=" << spinBackoffName(backoff) << " PINNED=" << (pinned ? "yes" : "no");
+    std::cout << " STEP_US=" << 1e6 * elapsed / STEPS << std::endl;
+    if (useGrid) {
+        printStencilReport(stencil, periodic, candidates, numBoids, STEPS, elapsed);
+    } else {
+        std::cout << "MODE=full ISA=" << simdIsaName(isa) << " PRECISION=" << precisionName(activePrecision()) << std::endl;
+    }
+    return 0;
+}
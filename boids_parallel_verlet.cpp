@@ -0,0 +1,172 @@
+//boids_parallel_verlet.cpp
+#include "BoidsVerlet.hpp"
+#include "BoidsCommon.hpp"
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <omp.h>
+
+// Variante di ParallelGrid con liste di Verlet: la griglia e le liste
+// (raggio VIEW_RADIUS + skin) vengono ricostruite solo quando qualche boid
+// si è spostato più di skin / 2 dall'ultima costruzione.
+
+constexpr int STEPS = 600;
+constexpr float DEFAULT_SKIN = 30.0f;
+
+struct VerletStats {
+    long long listCandidates = 0;  // coppie valutate dalle liste
+    long long buildCandidates = 0; // candidati esaminati nelle ricostruzioni
+    int rebuilds = 0;
+    size_t peakListBytes = 0;
+};
+
+template<bool Periodic, bool Fast>
+VerletStats simulate(BoidArray& oldState,
+                     BoidArray& newState,
+                     UniformGrid& grid,
+                     VerletLists& lists,
+                     const int numBoids)
+{
+    VerletStats stats;
+    long long listCandidates = 0;
+    long long buildCandidates = 0;
+    float maxDisplacement2 = 0.0f;
+    bool needRebuild = true;
+    const float rebuildThreshold2 = (lists.skin / 2) * (lists.skin / 2);
+
+    #pragma omp parallel default(none) shared(oldState, newState, grid, lists, numBoids, stats, maxDisplacement2, needRebuild, rebuildThreshold2) reduction(+:listCandidates, buildCandidates)
+    {
+        for (int step = 0; step < STEPS; ++step) {
+            if (needRebuild) {
+                parallelBuildVerletLists(oldState, grid, lists, buildCandidates);
+
+                #pragma omp single nowait
+                {
+                    stats.rebuilds++;
+                    stats.peakListBytes = std::max(stats.peakListBytes, lists.memoryBytes());
+                }
+            }
+
+            #pragma omp for schedule(static) reduction(max:maxDisplacement2)
+            for (int i = 0; i < numBoids; ++i) {
+                maxDisplacement2 = std::max(maxDisplacement2,
+                    computeNextBoidVerlet<Periodic, Fast>(i, oldState, newState, lists));
+                listCandidates += lists.offsets[i + 1] - lists.offsets[i];
+            }
+
+            #pragma omp single
+            {
+                oldState.swap(newState);
+                needRebuild = maxDisplacement2 >= rebuildThreshold2;
+                maxDisplacement2 = 0.0f;
+            }
+        }
+    }
+
+    stats.listCandidates = listCandidates;
+    stats.buildCandidates = buildCandidates;
+    return stats;
+}
+
+int main(const int argc, char* argv[]) {
+    int numBoids = 0;
+
+    if (argc > 1) {
+        char* end;
+        if (const long val = std::strtol(argv[1], &end, 10); *end == '\0' && val > 0) {
+            numBoids = static_cast<int>(val);
+        } else {
+            std::cerr << "Argomento non valido. Uscita.\n";
+            return 1;
+        }
+    } else {
+        std::cerr << "Numero di boid non specificato. Uscita.\n";
+        return 1;
+    }
+
+    // Argomenti opzionali, in qualsiasi ordine: lo spessore della skin (un
+    // numero positivo), "periodic", la precisione e le pagine degli stati
+    float skin = DEFAULT_SKIN;
+    bool periodic = false;
+    bool validArgs = true;
+    for (int a = 2; validArgs && a < argc; ++a) {
+        char* end;
+        if (const float val = std::strtof(argv[a], &end); *end == '\0' && val > 0.0f) {
+            skin = val;
+        } else if (std::strcmp(argv[a], "periodic") == 0) {
+            periodic = true;
+        } else if (!parsePrecision(argv[a], activePrecision()) && !parsePagePolicy(argv[a], activePagePolicy())) {
+            validArgs = false;
+        }
+    }
+    if (!validArgs) {
+        std::cerr << "Uso: " << argv[0] << " <boid> [skin] [periodic] [exact|fast] [hugetlb|thp|smallpages]. Uscita.\n";
+        return 1;
+    }
+
+    BoidArray oldState = uninitializedArray<BoidArray>(numBoids);
+    BoidArray newState = uninitializedArray<BoidArray>(numBoids);
+    bindToOwnerNodes(oldState);
+    bindToOwnerNodes(newState);
+
+    const int gridSize = static_cast<int>(std::ceil(std::sqrt(numBoids)));
+    const float spacingX = WIDTH / static_cast<float>(gridSize);
+    const float spacingY = HEIGHT / static_cast<float>(gridSize);
+    constexpr float centerX = WIDTH / 2.0f;
+    constexpr float centerY = HEIGHT / 2.0f;
+
+    #pragma omp parallel for default(none) shared(oldState, numBoids, gridSize, spacingX, spacingY) firstprivate(centerX, centerY) schedule(static)
+    for (int i = 0; i < numBoids; ++i) {
+        const int row = i / gridSize;
+        const int col = i % gridSize;
+        const float posX = static_cast<float>(col) * spacingX + spacingX / 2.0f;
+        const float posY = static_cast<float>(row) * spacingY + spacingY / 2.0f;
+
+        oldState[i].position = { posX, posY };
+
+        const float angle = std::atan2(posY - centerY, posX - centerX);
+        oldState[i].velocity = { std::cos(angle) * MAX_SPEED, std::sin(angle) * MAX_SPEED };
+    }
+
+    #pragma omp parallel for default(none) shared(newState, numBoids) schedule(static)
+    for (int i = 0; i < numBoids; ++i) {
+        newState[i] = Boid{};
+    }
+
+    // Griglia delle liste sempre periodica (vedi VerletLists)
+    VerletLists lists(numBoids, skin);
+    UniformGrid grid(WIDTH, HEIGHT, lists.listRadius(), true, 1);
+    grid.prepareParallelBuild(numBoids, omp_get_max_threads());
+    bindToOwnerNodes(grid);
+
+    printPageReport();
+
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    const VerletStats stats = dispatchPrecision([&](auto fastTag) {
+        constexpr bool Fast = decltype(fastTag)::value;
+        return periodic
+            ? simulate<true, Fast>(oldState, newState, grid, lists, numBoids)
+            : simulate<false, Fast>(oldState, newState, grid, lists, numBoids);
+    });
+
+    const auto end = std::chrono::high_resolution_clock::now();
+    const double elapsed = std::chrono::duration<double>(end - start).count();
+
+    const double boidSteps = static_cast<double>(numBoids) * STEPS;
+    std::cout << "TIME=" << elapsed << " seconds" << std::endl;
+    std::cout << "SKIN=" << skin << (periodic ? " PERIODIC" : "")
+              << " PRECISION=" << precisionName(activePrecision())
+              << " REBUILDS=" << stats.rebuilds << "/" << STEPS
+              << " (ogni " << static_cast<double>(STEPS) / stats.rebuilds << " passi)"
+              << " LIST_MEMORY=" << static_cast<double>(stats.peakListBytes) / (1024.0 * 1024.0) << " MB"
+              << std::endl;
+    std::cout << "CANDIDATES_PER_BOID=" << static_cast<double>(stats.listCandidates + stats.buildCandidates) / boidSteps
+              << " (liste " << static_cast<double>(stats.listCandidates) / boidSteps
+              << ", ricostruzioni " << static_cast<double>(stats.buildCandidates) / boidSteps << ")"
+              << " THROUGHPUT=" << boidSteps / elapsed << " boid-steps/s" << std::endl;
+    return 0;
+}
@@ -21,9 +21,21 @@ int main(const int argc, char* argv[]) {
         return 1;
     }
 
+    // Argomenti opzionali, in qualsiasi ordine: ISA del kernel (scalar, sse,
+    // avx2, avx512, di default la migliore) e precisione (exact, fast)
+    for (int a = 2; a < argc; ++a) {
+        SimdIsa isa;
+        if (parsePrecision(argv[a], activePrecision())) continue;
+        if (!parseSimdIsa(argv[a], isa) || !simdIsaSupported(isa)) {
+            std::cerr << "Uso: " << argv[0] << " <boid> [scalar|sse|avx2|avx512] [exact|fast]. Uscita.\n";
+            return 1;
+        }
+        activeSimdIsa() = isa;
+    }
+
     // --- Allocazione stati ---
-    std::vector<Boid> oldState(numBoids);
-    std::vector<Boid> newState(numBoids);
+    BoidArray oldState(numBoids);
+    BoidArray newState(numBoids);
 
     // --- Inizializzazione su griglia con velocità radiale ---
     const int gridSize = static_cast<int>(std::ceil(std::sqrt(numBoids)));
@@ -52,16 +64,19 @@ int main(const int argc, char* argv[]) {
     constexpr int STEPS = 600;
     const auto start = std::chrono::high_resolution_clock::now();
 
-    for (int step = 0; step < STEPS; ++step) {
-        for (int i = 0; i < numBoids; ++i) {
-            computeNextBoid(i, oldState, newState);
+    dispatchPrecision([&](auto fastTag) {
+        for (int step = 0; step < STEPS; ++step) {
+            for (int i = 0; i < numBoids; ++i) {
+                computeNextBoid<decltype(fastTag)::value>(i, oldState, newState);
+            }
+            oldState.swap(newState);
         }
-        oldState.swap(newState);
-    }
+    });
 
     const auto end = std::chrono::high_resolution_clock::now();
     const double elapsed = std::chrono::duration<double>(end - start).count();
 
     std::cout << "TIME=" << elapsed << " seconds" << std::endl;
+    std::cout << "ISA=" << simdIsaName(activeSimdIsa()) << " PRECISION=" << precisionName(activePrecision()) << std::endl;
     return 0;
 }
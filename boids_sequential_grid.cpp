@@ -5,6 +5,28 @@
 #include <random>
 #include <cstdlib>
 
+// Ciclo di simulazione specializzato sullo stencil; restituisce i candidati visitati
+template<int Reach, bool Periodic, bool Fast>
+long long simulate(BoidArray& oldState,
+                   BoidArray& newState,
+                   UniformGrid& grid,
+                   const int numBoids,
+                   const int steps)
+{
+    long long candidates = 0;
+
+    for (int step = 0; step < steps; ++step) {
+        buildGrid(oldState, grid);
+
+        for (int i = 0; i < numBoids; ++i) {
+            candidates += computeNextBoidGrid<Reach, false, Periodic, Fast>(i, oldState, newState, grid);
+        }
+
+        oldState.swap(newState);
+    }
+    return candidates;
+}
+
 int main(const int argc, char* argv[]) {
     int numBoids = 0;
 
@@ -22,9 +44,24 @@ int main(const int argc, char* argv[]) {
         return 1;
     }
 
+    // Argomenti opzionali: stencil della griglia (wide, 3x3, 5x5), "periodic"
+    // l'ISA dei kernel (scalar, sse, avx2, avx512), la precisione (exact,
+    // fast) e le pagine degli stati (hugetlb, thp, smallpages)
+    GridOptions options;
+    if (!parseGridArgs(argc, argv, options) || options.incremental || options.driftSteps > 0
+        || options.schedule != GridSchedule::Static) {
+        std::cerr << "Uso: " << argv[0] << " <boid> [wide|3x3|5x5] [periodic] [scalar|sse|avx2|avx512] [exact|fast] [hugetlb|thp|smallpages]. Uscita.\n";
+        return 1;
+    }
+    activeSimdIsa() = options.isa;
+    activePrecision() = options.precision;
+    activePagePolicy() = options.pages;
+    const GridStencil stencil = options.stencil;
+    const bool periodic = options.periodic;
+
     // Parametri:
     constexpr int STEPS = 500;
-    constexpr float cellSize = CELL_SIZE;
+    const float cellSize = stencilCellSize(stencil);
 
     // Inizializzazione boid
     std::random_device rd;
@@ -33,7 +70,7 @@ int main(const int argc, char* argv[]) {
     std::uniform_real_distribution distY(0.0f, HEIGHT);
     std::uniform_real_distribution distVel(-1.0f, 1.0f);
 
-    std::vector<Boid> oldState(numBoids), newState(numBoids);
+    BoidArray oldState(numBoids), newState(numBoids);
 
     for (int i = 0; i < numBoids; ++i) {
         oldState[i].position = Vector2(distX(gen), distY(gen));
@@ -43,23 +80,21 @@ int main(const int argc, char* argv[]) {
     }
 
     // Griglia
-    UniformGrid grid(WIDTH, HEIGHT, cellSize);
+    UniformGrid grid(WIDTH, HEIGHT, cellSize, periodic, stencilReach(stencil));
 
     const auto start = std::chrono::high_resolution_clock::now();
 
-    for (int step = 0; step < STEPS; ++step) {
-        buildGrid(oldState, grid, cellSize);
-
-        for (int i = 0; i < numBoids; ++i) {
-            computeNextBoidGrid(i, oldState, newState, grid, cellSize);
-        }
-
-        oldState.swap(newState);
-    }
+    const long long candidates = dispatchGridStencil(stencil, periodic, [&](auto reach, auto periodicTag) {
+        return dispatchPrecision([&](auto fastTag) {
+            return simulate<decltype(reach)::value, decltype(periodicTag)::value, decltype(fastTag)::value>(
+                oldState, newState, grid, numBoids, STEPS);
+        });
+    });
 
     const auto end = std::chrono::high_resolution_clock::now();
     const double elapsed = std::chrono::duration<double>(end - start).count();
 
     std::cout << "TIME=" << elapsed << std::endl;
+    printStencilReport(stencil, periodic, candidates, numBoids, STEPS, elapsed);
     return 0;
 }